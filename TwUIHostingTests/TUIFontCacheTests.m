@@ -0,0 +1,40 @@
+//
+//  TUIFontCacheTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+@interface TUIFontCacheTests : XCTestCase
+
+@end
+
+@implementation TUIFontCacheTests
+
+- (void)tearDown
+{
+    [TUIFont removeAllCachedFonts];
+}
+
+- (void)testFontsAreShared
+{
+    XCTAssertEqual([TUIFont systemFontOfSize:13], [TUIFont systemFontOfSize:13]);
+    XCTAssertNotEqual([TUIFont systemFontOfSize:13], [TUIFont boldSystemFontOfSize:13]);
+
+    // purging drops the shared instance but keeps the one already handed out usable
+    TUIFont *font = [TUIFont systemFontOfSize:13];
+    [TUIFont removeAllCachedFonts];
+    XCTAssertNotEqual([TUIFont systemFontOfSize:13], font);
+    XCTAssertEqual(font.pointSize, 13);
+}
+
+- (void)testDefaultMetrics
+{
+    TUIFontMetrics integral = TUIFontMetricsGetDefault(13);
+    XCTAssertTrue(TUIFontMetricsEqual(integral, TUIFontMetricsGetDefaultForPointSize(13.0)));
+    XCTAssertTrue(TUIFontMetricsEqual(integral, TUIFontMetricsMakeFromNSFont([NSFont systemFontOfSize:13])));
+    XCTAssertGreaterThan(TUIFontMetricsGetDefaultForPointSize(13.5).ascent, integral.ascent);
+}
+
+@end
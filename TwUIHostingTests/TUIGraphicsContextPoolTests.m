@@ -0,0 +1,140 @@
+//
+//  TUIGraphicsContextPoolTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+static const CGSize TUIGraphicsContextPoolTestsCellSize = {320, 44};
+static const NSUInteger TUIGraphicsContextPoolTestsCellCount = 20;
+static const NSUInteger TUIGraphicsContextPoolTestsRedraws = 10;
+
+@interface TUIGraphicsContextPoolTests : XCTestCase
+
+@property (nonatomic, strong) TUIColor *fillColor;
+
+@end
+
+@implementation TUIGraphicsContextPoolTests
+
+- (void)setUp
+{
+    [[TUIGraphicsContextPool sharedPool] removeAllBuffers];
+    [[TUIGraphicsContextPool sharedPool] resetStatistics];
+}
+
+- (TUIView *)filledView
+{
+    __weak TUIGraphicsContextPoolTests *weakSelf = self;
+    TUIView *view = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, TUIGraphicsContextPoolTestsCellSize.width, TUIGraphicsContextPoolTestsCellSize.height)];
+    view.opaque = NO;
+    view.layer.contentsScale = 1.0;
+    view.drawRect = ^(TUIView *v, CGRect rect) {
+        [weakSelf.fillColor set];
+        CGContextFillRect(TUIGraphicsGetCurrentContext(), v.bounds);
+    };
+    return view;
+}
+
+- (void)redrawView:(TUIView *)view
+{
+    [view setNeedsDisplay];
+    [view.layer displayIfNeeded];
+}
+
+// red, green, blue and alpha of the bottom left pixel
+- (NSArray *)pixelOfImage:(CGImageRef)image
+{
+    uint8_t pixel[4] = {0};
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(pixel, 1, 1, 8, 4, colorSpace, kCGImageAlphaPremultipliedLast);
+    CGColorSpaceRelease(colorSpace);
+    CGContextDrawImage(context, CGRectMake(0, 0, CGImageGetWidth(image), CGImageGetHeight(image)), image);
+    CGContextRelease(context);
+    return @[@(pixel[0] > 200), @(pixel[1] > 200), @(pixel[2] > 200), @(pixel[3] > 200)];
+}
+
+- (void)testDrawnImagesKeepTheirPixels
+{
+    self.fillColor = [TUIColor redColor];
+    TUIView *view = [self filledView];
+    [self redrawView:view];
+    id red = view.layer.contents;
+
+    // the next draw can't land in the bitmap the red image is still using
+    self.fillColor = [TUIColor blueColor];
+    [self redrawView:view];
+    id blue = view.layer.contents;
+    XCTAssertNotEqual(red, blue);
+
+    XCTAssertEqualObjects([self pixelOfImage:(__bridge CGImageRef)red], (@[@YES, @NO, @NO, @YES]));
+    XCTAssertEqualObjects([self pixelOfImage:(__bridge CGImageRef)blue], (@[@NO, @NO, @YES, @YES]));
+    XCTAssertGreaterThanOrEqual([TUIGraphicsContextPool sharedPool].lentBytes, 2 * (NSUInteger)(TUIGraphicsContextPoolTestsCellSize.width * TUIGraphicsContextPoolTestsCellSize.height * 4));
+
+    // a reused transparent bitmap starts out clear
+    red = nil;
+    blue = nil;
+    view.layer.contents = nil;
+    [CATransaction flush];
+    self.fillColor = [TUIColor clearColor];
+    [self redrawView:view];
+    XCTAssertGreaterThan([TUIGraphicsContextPool sharedPool].reuseCount, (NSUInteger)0);
+    XCTAssertEqualObjects([self pixelOfImage:(__bridge CGImageRef)view.layer.contents], (@[@NO, @NO, @NO, @NO]));
+}
+
+- (void)testRedrawingCellsReusesTheirBitmaps
+{
+    self.fillColor = [TUIColor whiteColor];
+    NSMutableArray *views = [NSMutableArray array];
+    for (NSUInteger i = 0; i < TUIGraphicsContextPoolTestsCellCount; i++) {
+        [views addObject:[self filledView]];
+    }
+
+    for (NSUInteger redraw = 0; redraw < TUIGraphicsContextPoolTestsRedraws; redraw++) {
+        for (TUIView *view in views) {
+            [self redrawView:view];
+        }
+        [CATransaction flush];
+    }
+
+    // each cell needs its shown bitmap plus the one it draws into next, then every draw is a reuse
+    TUIGraphicsContextPool *pool = [TUIGraphicsContextPool sharedPool];
+    NSUInteger bufferBytes = TUIGraphicsContextPoolTestsCellSize.width * TUIGraphicsContextPoolTestsCellSize.height * 4;
+    XCTAssertEqual(pool.reuseCount + pool.allocationCount, TUIGraphicsContextPoolTestsCellCount * TUIGraphicsContextPoolTestsRedraws);
+    XCTAssertLessThanOrEqual(pool.allocationCount, 2 * TUIGraphicsContextPoolTestsCellCount);
+    XCTAssertGreaterThanOrEqual(pool.reuseRate, 0.75);
+    XCTAssertLessThanOrEqual(pool.peakBytes, 2 * TUIGraphicsContextPoolTestsCellCount * bufferBytes);
+}
+
+- (void)testIdleBuffersStayUnderTheLimit
+{
+    TUIGraphicsContextPool *pool = [[TUIGraphicsContextPool alloc] init];
+    NSUInteger bufferBytes = 10 * 10 * 4;
+    pool.totalBytesLimit = bufferBytes;
+
+    NSMutableArray *images = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 3; i++) {
+        CGContextRef context = [pool copyGraphicsContextWithPixelSize:CGSizeMake(10, 10) opaque:YES];
+        [images addObject:CFBridgingRelease([pool copyImageFromGraphicsContext:context])];
+        CGContextRelease(context);
+    }
+    XCTAssertEqual(pool.lentBytes, 3 * bufferBytes);
+    XCTAssertEqual(pool.peakBytes, 3 * bufferBytes);
+
+    // only one of the three fits once they come back
+    [images removeAllObjects];
+    XCTAssertEqual(pool.lentBytes, (NSUInteger)0);
+    XCTAssertEqual(pool.totalBytes, bufferBytes);
+    XCTAssertEqual(pool.discardCount, (NSUInteger)2);
+
+    // and only a bitmap of the same kind is handed out again
+    CGContextRef transparent = [pool copyGraphicsContextWithPixelSize:CGSizeMake(10, 10) opaque:NO];
+    XCTAssertEqual(pool.reuseCount, (NSUInteger)0);
+    CGContextRef opaque = [pool copyGraphicsContextWithPixelSize:CGSizeMake(10, 10) opaque:YES];
+    XCTAssertEqual(pool.reuseCount, (NSUInteger)1);
+    CGContextRelease(transparent);
+    CGContextRelease(opaque);
+}
+
+@end
@@ -0,0 +1,119 @@
+//
+//  TUILayoutManagerTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+static const NSUInteger TUILayoutManagerTestsChainLength = 500;
+
+@interface TUILayoutManagerTests : XCTestCase
+
+@property (nonatomic, strong) TUIView *container;
+@property (nonatomic, strong) TUIView *anchor;
+
+@end
+
+@implementation TUILayoutManagerTests
+
+- (void)setUp
+{
+    self.container = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 400, 100)];
+    self.anchor = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 100, 20)];
+    self.anchor.layoutName = @"anchor";
+    [self.container addSubview:self.anchor];
+}
+
+- (void)tearDown
+{
+    for (TUIView *subview in [self.container.subviews copy]) {
+        [subview removeAllLayoutConstraints];
+    }
+    self.container = nil;
+    self.anchor = nil;
+}
+
+- (TUIView *)addSubviewNamed:(NSString *)name
+{
+    TUIView *view = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 50, 20)];
+    view.layoutName = name;
+    [self.container addSubview:view];
+    return view;
+}
+
+- (void)moveAnchorToWidth:(CGFloat)width
+{
+    self.anchor.frame = CGRectMake(0, 0, width, 20);
+    [[TUILayoutManager sharedLayoutManager] beginProcessingView:self.anchor];
+}
+
+- (void)testDependentReappliesAllConstraintsInOrder
+{
+    // follows the anchor, but the later constraint pins it to the right edge
+    TUIView *view = [self addSubviewNamed:@"view"];
+    [view addLayoutConstraint:[TUILayoutConstraint constraintWithAttribute:TUILayoutConstraintAttributeMinX relativeTo:@"anchor" attribute:TUILayoutConstraintAttributeMaxX]];
+    [view addLayoutConstraint:[TUILayoutConstraint constraintWithAttribute:TUILayoutConstraintAttributeMaxX relativeTo:@"superview" attribute:TUILayoutConstraintAttributeMaxX offset:-10]];
+    XCTAssertEqual(CGRectGetMaxX(view.frame), 390);
+
+    [self moveAnchorToWidth:150];
+    XCTAssertEqual(CGRectGetMaxX(view.frame), 390);
+}
+
+- (void)testDependentsAreLaidOutAfterTheirSources
+{
+    TUIView *first = [self addSubviewNamed:@"first"];
+    TUIView *second = [self addSubviewNamed:@"second"];
+    [second addLayoutConstraint:[TUILayoutConstraint constraintWithAttribute:TUILayoutConstraintAttributeMinX relativeTo:@"first" attribute:TUILayoutConstraintAttributeMaxX]];
+    [first addLayoutConstraint:[TUILayoutConstraint constraintWithAttribute:TUILayoutConstraintAttributeMinX relativeTo:@"anchor" attribute:TUILayoutConstraintAttributeMaxX]];
+    XCTAssertEqual(CGRectGetMinX(second.frame), 150);
+
+    [self moveAnchorToWidth:200];
+    XCTAssertEqual(CGRectGetMinX(first.frame), 200);
+    XCTAssertEqual(CGRectGetMinX(second.frame), 250);
+
+    // removing a constraint takes the dependency out of the graph
+    [second removeAllLayoutConstraints];
+    [self moveAnchorToWidth:100];
+    XCTAssertEqual(CGRectGetMinX(first.frame), 100);
+    XCTAssertEqual(CGRectGetMinX(second.frame), 250);
+}
+
+- (void)testRenamingASourceRebuildsTheGraph
+{
+    TUIView *view = [self addSubviewNamed:@"view"];
+    [view addLayoutConstraint:[TUILayoutConstraint constraintWithAttribute:TUILayoutConstraintAttributeMinX relativeTo:@"other" attribute:TUILayoutConstraintAttributeMaxX]];
+    XCTAssertEqual(CGRectGetMinX(view.frame), 0);
+
+    self.anchor.layoutName = @"other";
+    [self moveAnchorToWidth:120];
+    XCTAssertEqual(CGRectGetMinX(view.frame), 120);
+}
+
+- (void)testAddingAChainOfConstraints
+{
+    [self measureBlock:^{
+        NSMutableArray *links = [NSMutableArray array];
+        for (NSUInteger i = 0; i < TUILayoutManagerTestsChainLength; i++) {
+            [links addObject:[self addSubviewNamed:[NSString stringWithFormat:@"link%lu", (unsigned long)i]]];
+        }
+
+        // the graph is built once, then each constraint is added to it in place
+        NSString *previous = @"anchor";
+        for (TUIView *view in links) {
+            [view addLayoutConstraint:[TUILayoutConstraint constraintWithAttribute:TUILayoutConstraintAttributeMinY relativeTo:previous attribute:TUILayoutConstraintAttributeMaxY]];
+            previous = view.layoutName;
+        }
+
+        XCTAssertEqual(CGRectGetMinY([links.lastObject frame]), 20 * TUILayoutManagerTestsChainLength);
+
+        for (TUIView *subview in [self.container.subviews copy]) {
+            if (subview != self.anchor) {
+                [subview removeAllLayoutConstraints];
+                [subview removeFromSuperview];
+            }
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,149 @@
+//
+//  TUIScrollPhysicsTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+static const CGFloat TUIScrollPhysicsTestsRate = 0.88; // TUIScrollView's default decelerationRate
+
+// steps the throw for `duration` seconds in ticks of `dt`, the last tick taking whatever is left
+static TUIScrollPhysicsState TUIScrollPhysicsTestsThrow(TUIScrollPhysicsState state, NSTimeInterval duration, NSTimeInterval dt)
+{
+    for (NSTimeInterval t = 0; t < duration - 1e-9; t += dt) {
+        state = TUIScrollPhysicsDecelerate(state, TUIScrollPhysicsTestsRate, MIN(dt, duration - t));
+    }
+    return state;
+}
+
+static TUIScrollPhysicsState TUIScrollPhysicsTestsBounce(TUIScrollPhysicsState state, NSTimeInterval duration, NSTimeInterval dt)
+{
+    for (NSTimeInterval t = 0; t < duration - 1e-9; t += dt) {
+        state = TUIScrollPhysicsSpring(state, MIN(dt, duration - t));
+    }
+    return state;
+}
+
+@interface TUIScrollPhysicsTests : XCTestCase
+
+@end
+
+@implementation TUIScrollPhysicsTests
+
+- (void)assertState:(TUIScrollPhysicsState)state equalToState:(TUIScrollPhysicsState)expected accuracy:(CGFloat)accuracy
+{
+    XCTAssertEqualWithAccuracy(state.position.x, expected.position.x, accuracy);
+    XCTAssertEqualWithAccuracy(state.position.y, expected.position.y, accuracy);
+    XCTAssertEqualWithAccuracy(state.velocity.x, expected.velocity.x, accuracy);
+    XCTAssertEqualWithAccuracy(state.velocity.y, expected.velocity.y, accuracy);
+}
+
+- (void)testThrowIsFrameRateIndependent
+{
+    TUIScrollPhysicsState start = {{0, 0}, {-400, 3000}};
+
+    TUIScrollPhysicsState at60Hz = TUIScrollPhysicsTestsThrow(start, 0.5, 1.0 / 60.0);
+    TUIScrollPhysicsState at120Hz = TUIScrollPhysicsTestsThrow(start, 0.5, 1.0 / 120.0);
+    TUIScrollPhysicsState coalesced = TUIScrollPhysicsTestsThrow(start, 0.5, 5.0 / 60.0);
+    TUIScrollPhysicsState singleTick = TUIScrollPhysicsDecelerate(start, TUIScrollPhysicsTestsRate, 0.5);
+
+    [self assertState:at120Hz equalToState:at60Hz accuracy:1e-6];
+    [self assertState:coalesced equalToState:at60Hz accuracy:1e-6];
+    [self assertState:singleTick equalToState:at60Hz accuracy:1e-6];
+}
+
+- (void)testThrowDistanceMatchesPerTickDecayAt60Hz
+{
+    // the decay TUIScrollView used before it integrated over time
+    CGFloat position = 0;
+    CGFloat velocity = 3000;
+    for (NSUInteger tick = 0; tick < 600; tick++) {
+        position += velocity / 60.0;
+        velocity *= TUIScrollPhysicsTestsRate;
+    }
+
+    TUIScrollPhysicsState state = TUIScrollPhysicsTestsThrow((TUIScrollPhysicsState){{0, 0}, {0, 3000}}, 10.0, 1.0 / 60.0);
+    XCTAssertEqualWithAccuracy(state.position.y, position, position * 0.001);
+    XCTAssertLessThan(fabs(state.velocity.y), 0.1);
+}
+
+- (void)testApproachIsFrameRateIndependent
+{
+    CGPoint start = CGPointMake(0, 0);
+    CGPoint destination = CGPointMake(120, -2400);
+
+    CGPoint at60Hz = start;
+    for (NSUInteger tick = 0; tick < 30; tick++)
+        at60Hz = TUIScrollPhysicsApproach(at60Hz, destination, TUIScrollPhysicsTestsRate, 1.0 / 60.0);
+
+    CGPoint at120Hz = start;
+    for (NSUInteger tick = 0; tick < 60; tick++)
+        at120Hz = TUIScrollPhysicsApproach(at120Hz, destination, TUIScrollPhysicsTestsRate, 1.0 / 120.0);
+
+    CGPoint coalesced = TUIScrollPhysicsApproach(start, destination, TUIScrollPhysicsTestsRate, 0.5);
+
+    XCTAssertEqualWithAccuracy(at120Hz.x, at60Hz.x, 1e-6);
+    XCTAssertEqualWithAccuracy(at120Hz.y, at60Hz.y, 1e-6);
+    XCTAssertEqualWithAccuracy(coalesced.x, at60Hz.x, 1e-6);
+    XCTAssertEqualWithAccuracy(coalesced.y, at60Hz.y, 1e-6);
+}
+
+- (void)testApproachStopThreshold
+{
+    CGPoint destination = CGPointMake(0, 500);
+    CGFloat stepFraction = 1.0 - TUIScrollPhysicsTestsRate;
+
+    // the next 1/60 s step would move just under and just over 0.1pt
+    CGPoint justInside = CGPointMake(0, destination.y - 0.099 / stepFraction);
+    CGPoint justOutside = CGPointMake(0, destination.y - 0.101 / stepFraction);
+    XCTAssertTrue(TUIScrollPhysicsApproachIsFinished(justInside, destination, TUIScrollPhysicsTestsRate));
+    XCTAssertFalse(TUIScrollPhysicsApproachIsFinished(justOutside, destination, TUIScrollPhysicsTestsRate));
+
+    // the animation finishes at the same time whatever the tick rate
+    NSUInteger ticksAt60Hz = 0, ticksAt120Hz = 0;
+    for (CGPoint p = CGPointZero; !TUIScrollPhysicsApproachIsFinished(p, destination, TUIScrollPhysicsTestsRate); ticksAt60Hz++)
+        p = TUIScrollPhysicsApproach(p, destination, TUIScrollPhysicsTestsRate, 1.0 / 60.0);
+    for (CGPoint p = CGPointZero; !TUIScrollPhysicsApproachIsFinished(p, destination, TUIScrollPhysicsTestsRate); ticksAt120Hz++)
+        p = TUIScrollPhysicsApproach(p, destination, TUIScrollPhysicsTestsRate, 1.0 / 120.0);
+    XCTAssertEqualWithAccuracy(ticksAt60Hz / 60.0, ticksAt120Hz / 120.0, 1.0 / 60.0);
+}
+
+- (void)testBounceIsFrameRateIndependent
+{
+    // overscrolled past the top with the throw still moving outwards
+    TUIScrollPhysicsState start = {{0, 0}, {0, -900}};
+
+    TUIScrollPhysicsState at60Hz = TUIScrollPhysicsTestsBounce(start, 0.4, 1.0 / 60.0);
+    TUIScrollPhysicsState at120Hz = TUIScrollPhysicsTestsBounce(start, 0.4, 1.0 / 120.0);
+    TUIScrollPhysicsState coalesced = TUIScrollPhysicsTestsBounce(start, 0.4, 0.1);
+    TUIScrollPhysicsState longFrame = TUIScrollPhysicsSpring(start, 0.4);
+
+    [self assertState:at120Hz equalToState:at60Hz accuracy:1e-6];
+    [self assertState:coalesced equalToState:at60Hz accuracy:1e-6];
+    [self assertState:longFrame equalToState:at60Hz accuracy:1e-6];
+}
+
+- (void)testBounceSettles
+{
+    TUIScrollPhysicsState state = {{0, 0}, {0, -900}};
+    CGFloat furthestOverscroll = 0;
+    NSUInteger ticks = 0;
+
+    while (!TUIScrollPhysicsIsSettled(state, 1.0) && ticks < 600) {
+        state = TUIScrollPhysicsSpring(state, 1.0 / 60.0);
+        furthestOverscroll = MIN(furthestOverscroll, state.position.y);
+        ticks++;
+    }
+
+    XCTAssertLessThan(furthestOverscroll, -10.0, @"the rubber band should stretch before pulling back");
+    XCTAssertTrue(TUIScrollPhysicsIsSettled(state, 1.0));
+    XCTAssertLessThan(ticks, (NSUInteger)60, @"the rubber band should settle within a second");
+
+    // settled is both still and in place
+    XCTAssertFalse(TUIScrollPhysicsIsSettled((TUIScrollPhysicsState){{0, 0.5}, {0, 1.5}}, 1.0));
+    XCTAssertFalse(TUIScrollPhysicsIsSettled((TUIScrollPhysicsState){{1.5, 0}, {0.5, 0}}, 1.0));
+    XCTAssertTrue(TUIScrollPhysicsIsSettled((TUIScrollPhysicsState){{0.5, -0.5}, {0.5, -0.5}}, 1.0));
+}
+
+@end
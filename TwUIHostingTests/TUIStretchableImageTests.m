@@ -0,0 +1,124 @@
+//
+//  TUIStretchableImageTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+static const size_t TUIStretchableImageTestsSourceSize = 9;
+static const CGFloat TUIStretchableImageTestsCap = 3;
+static const size_t TUIStretchableImageTestsDrawSize = 30;
+
+@interface TUIStretchableImageTests : XCTestCase
+
+@end
+
+@implementation TUIStretchableImageTests
+
+// corners in cornerColor, edges green, center blue
+- (NSImage *)sourceImageWithCornerColor:(CGColorRef)cornerColor
+{
+    CGFloat size = TUIStretchableImageTestsSourceSize;
+    CGFloat cap = TUIStretchableImageTestsCap;
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, TUIStretchableImageTestsSourceSize, TUIStretchableImageTestsSourceSize, 8, 0, colorSpace, kCGImageAlphaPremultipliedLast);
+    CGColorSpaceRelease(colorSpace);
+
+    CGContextSetRGBFillColor(context, 0, 1, 0, 1);
+    CGContextFillRect(context, CGRectMake(0, 0, size, size));
+    CGContextSetRGBFillColor(context, 0, 0, 1, 1);
+    CGContextFillRect(context, CGRectMake(cap, cap, size - 2 * cap, size - 2 * cap));
+    CGContextSetFillColorWithColor(context, cornerColor);
+    for (NSUInteger i = 0; i < 4; i++) {
+        CGContextFillRect(context, CGRectMake((i % 2) ? size - cap : 0, (i / 2) ? size - cap : 0, cap, cap));
+    }
+
+    CGImageRef image = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    NSImage *nsImage = [[NSImage alloc] initWithCGImage:image size:NSMakeSize(size, size)];
+    CGImageRelease(image);
+    return nsImage;
+}
+
+// draws image at TUIStretchableImageTestsDrawSize square and returns the RGBA pixels, bottom row first
+- (NSData *)pixelsOfDrawingImage:(NSImage *)image
+{
+    size_t size = TUIStretchableImageTestsDrawSize;
+    NSMutableData *pixels = [NSMutableData dataWithLength:size * size * 4];
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(pixels.mutableBytes, size, size, 8, size * 4, colorSpace, kCGImageAlphaPremultipliedLast);
+    CGColorSpaceRelease(colorSpace);
+
+    [NSGraphicsContext saveGraphicsState];
+    [NSGraphicsContext setCurrentContext:[NSGraphicsContext graphicsContextWithCGContext:context flipped:NO]];
+    [image drawInRect:NSMakeRect(0, 0, size, size) fromRect:NSZeroRect operation:NSCompositeSourceOver fraction:1];
+    [NSGraphicsContext restoreGraphicsState];
+    CGContextRelease(context);
+
+    // the bitmap's first row is the top one
+    NSMutableData *flipped = [NSMutableData dataWithLength:pixels.length];
+    for (size_t y = 0; y < size; y++) {
+        memcpy((uint8_t *)flipped.mutableBytes + y * size * 4, (const uint8_t *)pixels.bytes + (size - 1 - y) * size * 4, size * 4);
+    }
+    return flipped;
+}
+
+- (void)assertPixels:(NSData *)pixels atX:(size_t)x y:(size_t)y red:(BOOL)red green:(BOOL)green blue:(BOOL)blue
+{
+    const uint8_t *pixel = (const uint8_t *)pixels.bytes + (y * TUIStretchableImageTestsDrawSize + x) * 4;
+    XCTAssertEqual(pixel[0] > 200, red, @"red at %zu, %zu", x, y);
+    XCTAssertEqual(pixel[1] > 200, green, @"green at %zu, %zu", x, y);
+    XCTAssertEqual(pixel[2] > 200, blue, @"blue at %zu, %zu", x, y);
+}
+
+- (void)testResizableImageIsAnNSImage
+{
+    TUIEdgeInsets insets = TUIEdgeInsetsMake(1, 2, 3, 4);
+    TUIStretchableImage *image = [[self sourceImageWithCornerColor:CGColorGetConstantColor(kCGColorBlack)] tui_resizableImageWithCapInsets:insets];
+
+    XCTAssertTrue([image isKindOfClass:[NSImage class]]);
+    XCTAssertTrue([image isKindOfClass:[TUIStretchableImage class]]);
+    XCTAssertTrue(TUIEdgeInsetsEqualToEdgeInsets(image.tui_capInsets, insets));
+    XCTAssertTrue(TUIEdgeInsetsEqualToEdgeInsets([image.copy tui_capInsets], insets));
+}
+
+- (void)testCornersKeepTheirSizeAndEdgesStretch
+{
+    CGColorRef red = CGColorCreateGenericRGB(1, 0, 0, 1);
+    NSImage *image = [[self sourceImageWithCornerColor:red] tui_resizableImageWithCapInsets:TUIEdgeInsetsMake(TUIStretchableImageTestsCap, TUIStretchableImageTestsCap, TUIStretchableImageTestsCap, TUIStretchableImageTestsCap)];
+    CGColorRelease(red);
+
+    // the second draw comes from the cached slices and must match the first
+    NSData *first = [self pixelsOfDrawingImage:image];
+    NSData *second = [self pixelsOfDrawingImage:image];
+    XCTAssertEqualObjects(first, second);
+
+    size_t far = TUIStretchableImageTestsDrawSize - 1;
+    size_t middle = TUIStretchableImageTestsDrawSize / 2;
+    [self assertPixels:first atX:1 y:1 red:YES green:NO blue:NO];
+    [self assertPixels:first atX:far y:far red:YES green:NO blue:NO];
+    [self assertPixels:first atX:middle y:1 red:NO green:YES blue:NO];
+    [self assertPixels:first atX:1 y:middle red:NO green:YES blue:NO];
+    [self assertPixels:first atX:middle y:middle red:NO green:NO blue:YES];
+    [self assertPixels:first atX:TUIStretchableImageTestsCap y:TUIStretchableImageTestsCap red:NO green:NO blue:YES];
+}
+
+- (void)testChangingRepresentationsDropsCachedSlices
+{
+    CGColorRef red = CGColorCreateGenericRGB(1, 0, 0, 1);
+    CGColorRef white = CGColorCreateGenericRGB(1, 1, 1, 1);
+    NSImage *image = [[self sourceImageWithCornerColor:red] tui_resizableImageWithCapInsets:TUIEdgeInsetsMake(TUIStretchableImageTestsCap, TUIStretchableImageTestsCap, TUIStretchableImageTestsCap, TUIStretchableImageTestsCap)];
+    [self assertPixels:[self pixelsOfDrawingImage:image] atX:1 y:1 red:YES green:NO blue:NO];
+
+    for (NSImageRep *rep in image.representations.copy) {
+        [image removeRepresentation:rep];
+    }
+    [image addRepresentations:[self sourceImageWithCornerColor:white].representations];
+    [self assertPixels:[self pixelsOfDrawingImage:image] atX:1 y:1 red:YES green:YES blue:YES];
+
+    CGColorRelease(red);
+    CGColorRelease(white);
+}
+
+@end
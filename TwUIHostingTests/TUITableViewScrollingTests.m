@@ -0,0 +1,192 @@
+//
+//  TUITableViewScrollingTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+static NSString * const TUITableViewScrollingTestsCellIdentifier = @"cell";
+static const NSUInteger TUITableViewScrollingTestsTicks = 200;
+
+@interface TUITableViewScrollingTests : XCTestCase <TUITableViewDataSource, TUITableViewDataSourcePrefetching, TUITableViewDelegate>
+
+@property (nonatomic, assign) NSInteger numberOfRows;
+@property (nonatomic, assign) NSUInteger heightRequests;
+@property (nonatomic, assign) NSUInteger cellRequests;
+@property (nonatomic, assign) NSUInteger prefetchRequests;
+@property (nonatomic, strong) NSMutableArray *prefetchedIndexPaths;
+@property (nonatomic, strong) NSMutableArray *endedIndexPaths;
+
+@end
+
+@implementation TUITableViewScrollingTests
+
+- (TUITableView *)tableViewWithNumberOfRows:(NSInteger)numberOfRows
+{
+    self.numberOfRows = numberOfRows;
+
+    TUITableView *tableView = [[TUITableView alloc] initWithFrame:CGRectMake(0, 0, 320, 600) style:TUITableViewStylePlain];
+    [tableView registerClass:[TUITableViewCell class] forCellReuseIdentifier:TUITableViewScrollingTestsCellIdentifier];
+    tableView.dataSource = self;
+    tableView.delegate = self;
+    [tableView reloadData];
+    return tableView;
+}
+
+// one scroll tick: move by a screenful and lay out the cells that came into view
+- (void)scrollTableView:(TUITableView *)tableView ticks:(NSUInteger)ticks
+{
+    NSInteger stride = self.numberOfRows / (NSInteger)ticks;
+    for (NSUInteger tick = 0; tick < ticks; tick++) {
+        TUIFastIndexPath *indexPath = [TUIFastIndexPath indexPathForRow:(NSInteger)tick * stride inSection:0];
+        [tableView scrollToRowAtIndexPath:indexPath atScrollPosition:TUITableViewScrollPositionTop animated:NO];
+        [tableView layoutSubviews];
+    }
+}
+
+// the data source and delegate calls made while scrolling, after warming the reuse pool
+- (NSArray *)requestCountsForScrollingTableView:(TUITableView *)tableView
+{
+    [self scrollTableView:tableView ticks:TUITableViewScrollingTestsTicks / 10];
+
+    self.heightRequests = 0;
+    self.cellRequests = 0;
+    [self scrollTableView:tableView ticks:TUITableViewScrollingTestsTicks];
+    return @[@(self.heightRequests), @(self.cellRequests)];
+}
+
+- (void)testScrollTickPerformanceWith100kRows
+{
+    TUITableView *tableView = [self tableViewWithNumberOfRows:100000];
+    [self measureBlock:^{
+        [self scrollTableView:tableView ticks:TUITableViewScrollingTestsTicks];
+    }];
+}
+
+- (void)testScrollTickPerformanceWith1MRows
+{
+    TUITableView *tableView = [self tableViewWithNumberOfRows:1000000];
+    [self measureBlock:^{
+        [self scrollTableView:tableView ticks:TUITableViewScrollingTestsTicks];
+    }];
+}
+
+- (void)testScrollTickWorkStaysFlatAsRowsGrow
+{
+    NSArray *small = [self requestCountsForScrollingTableView:[self tableViewWithNumberOfRows:100000]];
+    NSArray *large = [self requestCountsForScrollingTableView:[self tableViewWithNumberOfRows:1000000]];
+
+    // both strides are a multiple of the height pattern, so every tick shows rows of the same heights
+    XCTAssertEqualObjects(large, small, @"scrolling asked for more rows with ten times the row count");
+    XCTAssertGreaterThan([small[1] unsignedIntegerValue], (NSUInteger)0);
+}
+
+- (void)testGeometryQueriesAgreeWithRowHeights
+{
+    TUITableView *tableView = [self tableViewWithNumberOfRows:100000];
+
+    for (NSInteger row = 0; row < self.numberOfRows; row += 9973) {
+        TUIFastIndexPath *indexPath = [TUIFastIndexPath indexPathForRow:row inSection:0];
+        CGRect rect = [tableView rectForRowAtIndexPath:indexPath];
+        XCTAssertEqual(CGRectGetHeight(rect), [self tableView:tableView heightForRowAtIndexPath:indexPath]);
+        XCTAssertEqualObjects([tableView indexPathForRowAtPoint:CGPointMake(10, CGRectGetMidY(rect))], indexPath);
+    }
+}
+
+- (void)testPrefetchingOnlyReportsRowsEnteringTheLookahead
+{
+    TUITableView *tableView = [self tableViewWithNumberOfRows:100000];
+    tableView.prefetchDataSource = self;
+
+    // find which way the content offset moves when scrolling towards the end
+    [tableView scrollToRowAtIndexPath:[TUIFastIndexPath indexPathForRow:1001 inSection:0] atScrollPosition:TUITableViewScrollPositionTop animated:NO];
+    [tableView layoutSubviews];
+    CGFloat next = tableView.contentOffset.y;
+    [tableView scrollToRowAtIndexPath:[TUIFastIndexPath indexPathForRow:1000 inSection:0] atScrollPosition:TUITableViewScrollPositionTop animated:NO];
+    [tableView layoutSubviews];
+    CGFloat start = tableView.contentOffset.y;
+    CGFloat step = (next > start) ? 2 : -2;
+
+    // scroll steadily down, a couple of points per tick
+    self.prefetchRequests = 0;
+    self.prefetchedIndexPaths = [NSMutableArray array];
+    for (NSUInteger tick = 1; tick <= TUITableViewScrollingTestsTicks; tick++) {
+        tableView.contentOffset = CGPointMake(0, start + step * tick);
+        [tableView layoutSubviews];
+    }
+
+    // rows are at least 30pt tall, so the lookahead moves by a row every few ticks and no row is reported twice
+    XCTAssertGreaterThan(self.prefetchRequests, (NSUInteger)0);
+    XCTAssertLessThan(self.prefetchRequests, TUITableViewScrollingTestsTicks / 4);
+    XCTAssertEqual([NSSet setWithArray:self.prefetchedIndexPaths].count, self.prefetchedIndexPaths.count);
+}
+
+- (void)testScrollingRemovesOffscreenCellsFromTheOutsideIn
+{
+    TUITableView *tableView = [self tableViewWithNumberOfRows:100000];
+    NSArray *(^scrollToRow)(NSInteger) = ^(NSInteger row) {
+        NSArray *before = [tableView indexPathsForVisibleRows];
+        self.endedIndexPaths = [NSMutableArray array];
+        [tableView scrollToRowAtIndexPath:[TUIFastIndexPath indexPathForRow:row inSection:0] atScrollPosition:TUITableViewScrollPositionTop animated:NO];
+        [tableView layoutSubviews];
+
+        // every row that left was visible before, and none of them still is
+        NSSet *after = [NSSet setWithArray:[tableView indexPathsForVisibleRows]];
+        for (TUIFastIndexPath *indexPath in self.endedIndexPaths) {
+            XCTAssertTrue([before containsObject:indexPath]);
+            XCTAssertFalse([after containsObject:indexPath]);
+        }
+        XCTAssertEqual(before.count - self.endedIndexPaths.count, [after objectsPassingTest:^BOOL(id indexPath, BOOL *stop) { return [before containsObject:indexPath]; }].count);
+        return [self.endedIndexPaths copy];
+    };
+    scrollToRow(1000);
+
+    // rows leaving the top go first to last, so the row next to the viewport is reused first
+    NSArray *head = scrollToRow(1003);
+    XCTAssertEqualObjects(head, (@[[TUIFastIndexPath indexPathForRow:1000 inSection:0], [TUIFastIndexPath indexPathForRow:1001 inSection:0], [TUIFastIndexPath indexPathForRow:1002 inSection:0]]));
+
+    // rows leaving the bottom go last to first
+    NSArray *tail = scrollToRow(1000);
+    XCTAssertGreaterThan(tail.count, (NSUInteger)0);
+    for (NSUInteger i = 1; i < tail.count; i++) {
+        XCTAssertEqual([tail[i - 1] compare:tail[i]], NSOrderedDescending);
+    }
+    self.endedIndexPaths = nil;
+}
+
+#pragma mark - TUITableViewDataSource
+
+- (NSInteger)tableView:(TUITableView *)table numberOfRowsInSection:(NSInteger)section
+{
+    return self.numberOfRows;
+}
+
+- (TUITableViewCell *)tableView:(TUITableView *)tableView cellForRowAtIndexPath:(TUIFastIndexPath *)indexPath
+{
+    self.cellRequests++;
+    return [tableView dequeueReusableCellWithIdentifier:TUITableViewScrollingTestsCellIdentifier];
+}
+
+#pragma mark - TUITableViewDataSourcePrefetching
+
+- (void)tableView:(TUITableView *)tableView prefetchRowsAtIndexPaths:(NSArray *)indexPaths
+{
+    self.prefetchRequests++;
+    [self.prefetchedIndexPaths addObjectsFromArray:indexPaths];
+}
+
+#pragma mark - TUITableViewDelegate
+
+- (CGFloat)tableView:(TUITableView *)tableView heightForRowAtIndexPath:(TUIFastIndexPath *)indexPath
+{
+    self.heightRequests++;
+    return 30 + (indexPath.row % 4) * 10;
+}
+
+- (void)tableView:(TUITableView *)tableView didEndDisplayingCell:(TUITableViewCell *)cell forRowAtIndexPath:(TUIFastIndexPath *)indexPath
+{
+    [self.endedIndexPaths addObject:indexPath];
+}
+
+@end
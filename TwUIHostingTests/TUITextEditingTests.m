@@ -0,0 +1,107 @@
+//
+//  TUITextEditingTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+static const NSUInteger TUITextEditingTestsDocumentLength = 50000;
+static const NSUInteger TUITextEditingTestsKeystrokes = 200;
+static const CGFloat TUITextEditingTestsWidth = 480;
+
+@interface TUITextEditingTests : XCTestCase
+
+@property (nonatomic, strong) TUITextEditor *editor;
+
+@end
+
+@implementation TUITextEditingTests
+
+- (void)setUp
+{
+    // short paragraphs of wrapping prose, like a long note being typed into
+    NSString *sentence = @"The quick brown fox jumps over the lazy dog while the timeline keeps scrolling. ";
+    NSMutableString *text = [NSMutableString stringWithCapacity:TUITextEditingTestsDocumentLength];
+    for (NSUInteger i = 0; text.length < TUITextEditingTestsDocumentLength; i++) {
+        [text appendString:sentence];
+        if (i % 5 == 4) {
+            [text appendString:@"\n"];
+        }
+    }
+    [text deleteCharactersInRange:NSMakeRange(TUITextEditingTestsDocumentLength, text.length - TUITextEditingTestsDocumentLength)];
+
+    self.editor = [[TUITextEditor alloc] init];
+    self.editor.defaultAttributes = @{(id)kCTFontAttributeName: (id)[[TUIFont systemFontOfSize:13] ctFont]};
+    self.editor.frame = CGRectMake(0, 0, TUITextEditingTestsWidth, 1000000);
+    self.editor.text = text;
+    [self.editor.textLayout layoutHeight];
+}
+
+- (void)tearDown
+{
+    self.editor = nil;
+}
+
+// types into the middle of the document, laying out after every keystroke like a redraw would
+- (void)typeKeystrokes:(NSUInteger)keystrokes
+{
+    TUITextEditor *editor = self.editor;
+    editor.selectedRange = NSMakeRange(editor.backingStore.length / 2, 0);
+    for (NSUInteger i = 0; i < keystrokes; i++) {
+        if (i % 8 == 7) {
+            [editor deleteCharactersInRange:NSMakeRange(editor.selectedRange.location - 1, 1)];
+        } else {
+            [editor insertText:(i % 6 == 5) ? @" " : @"a"];
+        }
+        [editor.textLayout layoutHeight];
+    }
+}
+
+- (void)testTypingPerformance
+{
+    [self measureBlock:^{
+        [self typeKeystrokes:TUITextEditingTestsKeystrokes];
+    }];
+}
+
+- (void)testIncrementalLayoutMatchesFullLayout
+{
+    [self typeKeystrokes:TUITextEditingTestsKeystrokes];
+    [self.editor insertText:@"\nnew paragraph\n"];
+
+    TUITextLayout *incremental = self.editor.textLayout;
+    TUITextLayout *full = [[TUITextLayout alloc] initWithAttributedString:[self.editor.backingStore copy]];
+    full.usesSharedLayoutCache = NO;
+    full.size = incremental.size;
+
+    XCTAssertEqual(incremental.containingLineCount, full.containingLineCount);
+    XCTAssertEqualWithAccuracy(incremental.layoutHeight, full.layoutHeight, 0.001);
+    for (NSUInteger i = 0; i < full.containingLineCount; i++) {
+        NSRange incrementalRange, fullRange;
+        CGRect incrementalRect = [incremental lineFragmentRectForLineAtIndex:i effectiveRange:&incrementalRange];
+        CGRect fullRect = [full lineFragmentRectForLineAtIndex:i effectiveRange:&fullRange];
+        XCTAssertTrue(NSEqualRanges(incrementalRange, fullRange), @"line %lu", (unsigned long)i);
+        XCTAssertEqualWithAccuracy(CGRectGetMinY(incrementalRect), CGRectGetMinY(fullRect), 0.001, @"line %lu", (unsigned long)i);
+    }
+}
+
+- (void)testEditingLeavesOtherLayoutsOfTheSameTextAlone
+{
+    // a plain layout of the same text may come out of the shared cache; the editor's edits must not reach it
+    NSAttributedString *snapshot = [self.editor.backingStore copy];
+    TUITextLayout *other = [[TUITextLayout alloc] initWithAttributedString:snapshot];
+    other.size = self.editor.textLayout.size;
+    NSUInteger lastLine = other.containingLineCount - 1;
+    NSRange before;
+    [other lineFragmentRectForLineAtIndex:lastLine effectiveRange:&before];
+
+    [self typeKeystrokes:TUITextEditingTestsKeystrokes / 4];
+
+    NSRange after;
+    [other lineFragmentRectForLineAtIndex:lastLine effectiveRange:&after];
+    XCTAssertTrue(NSEqualRanges(before, after));
+    XCTAssertEqual(NSMaxRange(after), snapshot.length);
+}
+
+@end
@@ -0,0 +1,165 @@
+//
+//  TUITextMeasurementTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+
+static const NSUInteger TUITextMeasurementTestsStringCount = 10000;
+static const CGFloat TUITextMeasurementTestsWidth = 180;
+static const NSUInteger TUITextMeasurementTestsLineLimit = 2;
+
+@interface TUITextMeasurementTests : XCTestCase
+
+@property (nonatomic, copy) NSArray *strings;
+
+@end
+
+@implementation TUITextMeasurementTests
+
+- (void)setUp
+{
+    // short strings fit, long ones get truncated to two lines
+    NSArray *words = @[@"timeline", @"tweet", @"reply", @"a", @"favorite", @"notifications", @"of", @"the", @"conversation"];
+    NSMutableArray *strings = [NSMutableArray arrayWithCapacity:TUITextMeasurementTestsStringCount];
+    for (NSUInteger i = 0; i < TUITextMeasurementTestsStringCount; i++) {
+        NSMutableString *text = [NSMutableString string];
+        for (NSUInteger w = 0; w < 2 + i % 23; w++) {
+            [text appendFormat:@"%@%@", w ? @" " : @"", words[(i * 7 + w * 3) % words.count]];
+        }
+        TUIAttributedString *string = [TUIAttributedString stringWithString:text];
+        string.font = [TUIFont systemFontOfSize:11 + i % 4];
+        [strings addObject:[string copy]];
+    }
+    self.strings = strings;
+}
+
+- (void)tearDown
+{
+    self.strings = nil;
+    [TUITextLayout removeAllCachedLayouts];
+}
+
+// returns a malloc()ed array of one measurement per string
+- (TUITextMeasurement *)measureStringsConcurrently:(BOOL)concurrently
+{
+    TUITextMeasurement *measurements = calloc(self.strings.count, sizeof(TUITextMeasurement));
+    NSArray *strings = self.strings;
+    void (^measure)(size_t) = ^(size_t i) {
+        measurements[i] = [strings[i] ab_measurementConstrainedToWidth:TUITextMeasurementTestsWidth numberOfLines:TUITextMeasurementTestsLineLimit];
+    };
+
+    if (concurrently) {
+        dispatch_apply(strings.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), measure);
+    } else {
+        for (size_t i = 0; i < strings.count; i++) {
+            measure(i);
+        }
+    }
+    return measurements;
+}
+
+- (void)testConcurrentMeasurementMatchesSerial
+{
+    [TUITextLayout removeAllCachedLayouts];
+    TUITextMeasurement *serial = [self measureStringsConcurrently:NO];
+    [TUITextLayout removeAllCachedLayouts];
+    TUITextMeasurement *concurrent = [self measureStringsConcurrently:YES];
+
+    NSUInteger truncatedCount = 0;
+    for (NSUInteger i = 0; i < self.strings.count; i++) {
+        XCTAssertTrue(CGSizeEqualToSize(serial[i].size, concurrent[i].size), @"string %lu", (unsigned long)i);
+        XCTAssertEqual(serial[i].lineCount, concurrent[i].lineCount, @"string %lu", (unsigned long)i);
+        XCTAssertTrue(NSEqualRanges(serial[i].truncatedRange, concurrent[i].truncatedRange), @"string %lu", (unsigned long)i);
+        XCTAssertLessThanOrEqual(serial[i].lineCount, TUITextMeasurementTestsLineLimit);
+        if (serial[i].truncatedRange.location != NSNotFound) {
+            truncatedCount++;
+        }
+    }
+    XCTAssertGreaterThan(truncatedCount, (NSUInteger)0, @"the stress set should include truncated strings");
+
+    free(serial);
+    free(concurrent);
+}
+
+- (void)testTruncatedRangeStartsAfterTheVisiblePrefix
+{
+    TUIAttributedString *string = [TUIAttributedString stringWithString:@"first line of text that wraps onto a second line which is then cut off with an ellipsis well before the end"];
+    string.font = [TUIFont systemFontOfSize:12];
+
+    TUITextMeasurement measurement = [string ab_measurementConstrainedToWidth:TUITextMeasurementTestsWidth numberOfLines:TUITextMeasurementTestsLineLimit];
+    XCTAssertEqual(measurement.lineCount, TUITextMeasurementTestsLineLimit);
+    XCTAssertNotEqual(measurement.truncatedRange.location, (NSUInteger)NSNotFound);
+    XCTAssertEqual(NSMaxRange(measurement.truncatedRange), string.length);
+
+    // the hidden text starts part way into the last line, after what is drawn before the ellipsis
+    TUITextLayout *layout = [[TUITextLayout alloc] initWithAttributedString:string];
+    layout.size = CGSizeMake(TUITextMeasurementTestsWidth, 2000);
+    layout.maximumNumberOfLines = TUITextMeasurementTestsLineLimit;
+    NSRange lastLineRange;
+    [layout lineFragmentRectForLineAtIndex:TUITextMeasurementTestsLineLimit - 1 effectiveRange:&lastLineRange];
+    XCTAssertGreaterThan(measurement.truncatedRange.location, lastLineRange.location);
+
+    // nothing is hidden when everything fits
+    TUIAttributedString *shortString = [TUIAttributedString stringWithString:@"fits"];
+    shortString.font = string.font;
+    XCTAssertEqual([shortString ab_measurementConstrainedToWidth:TUITextMeasurementTestsWidth numberOfLines:TUITextMeasurementTestsLineLimit].truncatedRange.location, (NSUInteger)NSNotFound);
+}
+
+- (void)testMeasuringThenDrawingLaysOutOnce
+{
+    TUIAttributedString *string = self.strings[22];
+    [TUITextLayout removeAllCachedLayouts];
+    [TUITextLayout resetLayoutCacheStatistics];
+
+    // measured against a very tall container, then drawn into one that just fits
+    CGSize size = [string ab_sizeConstrainedToWidth:TUITextMeasurementTestsWidth];
+    CGRect rect = CGRectMake(0, 0, TUITextMeasurementTestsWidth, ceil(size.height) + 4);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, (size_t)rect.size.width, (size_t)rect.size.height, 8, 0, colorSpace, kCGImageAlphaPremultipliedFirst);
+    CGColorSpaceRelease(colorSpace);
+    [string ab_drawInRect:rect context:context];
+    CGContextRelease(context);
+
+    XCTAssertEqual([TUITextLayout layoutCacheMissCount], (NSUInteger)1);
+    XCTAssertGreaterThanOrEqual([TUITextLayout layoutCacheHitCount], (NSUInteger)1);
+
+    // a layout shrunk to the measured height reuses the frame and puts its lines where a fresh layout would
+    [TUITextLayout resetLayoutCacheStatistics];
+    TUITextLayout *cached = [[TUITextLayout alloc] initWithAttributedString:string];
+    cached.size = CGSizeMake(TUITextMeasurementTestsWidth, 2000);
+    CGSize layoutSize = cached.layoutSize;
+    cached.size = CGSizeMake(TUITextMeasurementTestsWidth, ceil(layoutSize.height) + 4);
+    TUITextLayout *fresh = [[TUITextLayout alloc] initWithAttributedString:string];
+    fresh.usesSharedLayoutCache = NO;
+    fresh.size = cached.size;
+
+    NSUInteger lineCount = fresh.containingLineCount;
+    XCTAssertGreaterThan(lineCount, (NSUInteger)1);
+    XCTAssertEqual(cached.containingLineCount, lineCount);
+    for (NSUInteger i = 0; i < lineCount; i++) {
+        CGRect expected = [fresh lineFragmentRectForLineAtIndex:i effectiveRange:NULL];
+        CGRect actual = [cached lineFragmentRectForLineAtIndex:i effectiveRange:NULL];
+        XCTAssertTrue(CGRectEqualToRect(expected, actual), @"line %lu", (unsigned long)i);
+    }
+    XCTAssertEqual([TUITextLayout layoutCacheMissCount], (NSUInteger)1);
+}
+
+- (void)testSerialMeasurementPerformance
+{
+    [self measureBlock:^{
+        [TUITextLayout removeAllCachedLayouts];
+        free([self measureStringsConcurrently:NO]);
+    }];
+}
+
+- (void)testConcurrentMeasurementPerformance
+{
+    [self measureBlock:^{
+        [TUITextLayout removeAllCachedLayouts];
+        free([self measureStringsConcurrently:YES]);
+    }];
+}
+
+@end
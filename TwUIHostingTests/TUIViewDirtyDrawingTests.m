@@ -0,0 +1,121 @@
+//
+//  TUIViewDirtyDrawingTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+#import <IOSurface/IOSurface.h>
+
+static const CGRect TUIViewDirtyDrawingTestsCaretRect = {{120, 100}, {2, 18}};
+
+// a text-like view that draws its own blinking caret
+@interface TUIViewDirtyDrawingTestsView : TUIView
+
+@property (nonatomic, strong) NSMutableArray *drawnRects;
+@property (nonatomic, assign) BOOL caretVisible;
+
+@end
+
+@implementation TUIViewDirtyDrawingTestsView
+
+- (void)drawRect:(CGRect)rect
+{
+    [self.drawnRects addObject:[NSValue valueWithRect:rect]];
+
+    CGContextRef context = TUIGraphicsGetCurrentContext();
+    CGContextSetRGBFillColor(context, 1, 1, 1, 1);
+    CGContextFillRect(context, self.bounds);
+    if (self.caretVisible) {
+        CGContextSetRGBFillColor(context, 0, 0, 0, 1);
+        CGContextFillRect(context, TUIViewDirtyDrawingTestsCaretRect);
+    }
+}
+
+@end
+
+@interface TUIViewDirtyDrawingTests : XCTestCase
+
+@property (nonatomic, strong) TUIViewDirtyDrawingTestsView *view;
+
+@end
+
+@implementation TUIViewDirtyDrawingTests
+
+- (void)setUp
+{
+    self.view = [[TUIViewDirtyDrawingTestsView alloc] initWithFrame:CGRectMake(0, 0, 400, 300)];
+    self.view.opaque = YES;
+    self.view.cachesCGContext = YES;
+    self.view.layer.contentsScale = 1.0;
+    self.view.drawnRects = [NSMutableArray array];
+}
+
+- (void)tearDown
+{
+    self.view = nil;
+}
+
+- (IOSurfaceRef)displayedSurface
+{
+    id contents = self.view.layer.contents;
+    XCTAssertTrue(contents && CFGetTypeID((__bridge CFTypeRef)contents) == IOSurfaceGetTypeID(), @"the layer should show the backing store directly");
+    return (__bridge IOSurfaceRef)contents;
+}
+
+// 0xff for white, 0 for black; y counts from the bottom like the view
+- (uint8_t)blueAtX:(size_t)x y:(size_t)y
+{
+    IOSurfaceRef surface = [self displayedSurface];
+    IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL);
+    size_t row = IOSurfaceGetHeight(surface) - 1 - y;
+    uint8_t blue = ((const uint8_t *)IOSurfaceGetBaseAddress(surface))[row * IOSurfaceGetBytesPerRow(surface) + x * 4];
+    IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+    return blue;
+}
+
+- (void)testCursorBlinkRepaintsOnlyTheCursorRect
+{
+    TUIViewDirtyDrawingTestsView *view = self.view;
+    [view setNeedsDisplay];
+    [view.layer displayIfNeeded];
+    XCTAssertEqualObjects(view.drawnRects.lastObject, [NSValue valueWithRect:view.bounds]);
+
+    NSMutableSet *surfaces = [NSMutableSet set];
+    for (NSUInteger blink = 0; blink < 6; blink++) {
+        [view.drawnRects removeAllObjects];
+        view.caretVisible = !view.caretVisible;
+        [view setNeedsDisplayInRect:TUIViewDirtyDrawingTestsCaretRect];
+        [view.layer displayIfNeeded];
+
+        XCTAssertEqual(view.drawnRects.count, (NSUInteger)1);
+        XCTAssertEqualObjects(view.drawnRects.lastObject, [NSValue valueWithRect:TUIViewDirtyDrawingTestsCaretRect]);
+        [surfaces addObject:view.layer.contents];
+
+        // the caret changed and everything around it was kept
+        XCTAssertEqual([self blueAtX:121 y:110], view.caretVisible ? 0 : 0xff);
+        XCTAssertEqual([self blueAtX:10 y:10], 0xff);
+        XCTAssertEqual([self blueAtX:390 y:290], 0xff);
+    }
+
+    // blinking swaps between the same two surfaces rather than making a new bitmap each time
+    XCTAssertLessThanOrEqual(surfaces.count, (NSUInteger)2);
+}
+
+- (void)testResizeRedrawsEverything
+{
+    TUIViewDirtyDrawingTestsView *view = self.view;
+    [view setNeedsDisplay];
+    [view.layer displayIfNeeded];
+
+    view.frame = CGRectMake(0, 0, 200, 100);
+    [view.drawnRects removeAllObjects];
+    [view setNeedsDisplayInRect:CGRectMake(0, 0, 10, 10)];
+    [view.layer displayIfNeeded];
+
+    // a new backing store has nothing to draw on top of
+    XCTAssertEqualObjects(view.drawnRects.lastObject, [NSValue valueWithRect:view.bounds]);
+    XCTAssertEqual(IOSurfaceGetWidth([self displayedSurface]), (size_t)200);
+}
+
+@end
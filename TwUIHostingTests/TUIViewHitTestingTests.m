@@ -0,0 +1,112 @@
+//
+//  TUIViewHitTestingTests.m
+//  TwUIHostingTests
+//
+
+#import <XCTest/XCTest.h>
+#import <TwUI/TwUI.h>
+#import <pthread.h>
+#import <stdatomic.h>
+
+// libmalloc reports every allocation here while it is set; this is what malloc stack logging uses
+typedef void (TUIViewHitTestingTestsMallocLogger)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numberOfFramesToSkip);
+extern TUIViewHitTestingTestsMallocLogger *malloc_logger;
+
+#define TUIViewHitTestingTestsMallocLogTypeAllocate 2
+
+static pthread_t TUIViewHitTestingTestsCountingThread;
+static atomic_ulong TUIViewHitTestingTestsAllocations;
+
+static void TUIViewHitTestingTestsCountAllocation(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numberOfFramesToSkip)
+{
+    if ((type & TUIViewHitTestingTestsMallocLogTypeAllocate) && pthread_equal(pthread_self(), TUIViewHitTestingTestsCountingThread)) {
+        atomic_fetch_add(&TUIViewHitTestingTestsAllocations, 1);
+    }
+}
+
+static const NSUInteger TUIViewHitTestingTestsRows = 400;
+static const CGFloat TUIViewHitTestingTestsRowHeight = 40;
+static const NSUInteger TUIViewHitTestingTestsHits = 10000;
+
+@interface TUIViewHitTestingTests : XCTestCase
+
+@property (nonatomic, strong) TUIView *container;
+
+@end
+
+@implementation TUIViewHitTestingTests
+
+- (void)setUp
+{
+    // a list of rows, each with an accessory on the right and a badge stacked above it
+    self.container = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 320, TUIViewHitTestingTestsRows * TUIViewHitTestingTestsRowHeight)];
+    for (NSUInteger i = 0; i < TUIViewHitTestingTestsRows; i++) {
+        TUIView *row = [[TUIView alloc] initWithFrame:CGRectMake(0, i * TUIViewHitTestingTestsRowHeight, 320, TUIViewHitTestingTestsRowHeight)];
+        [row addSubview:[[TUIView alloc] initWithFrame:CGRectMake(280, 5, 30, 30)]];
+        TUIView *badge = [[TUIView alloc] initWithFrame:CGRectMake(290, 0, 20, 20)];
+        badge.layer.zPosition = 1;
+        [row addSubview:badge];
+        [self.container addSubview:row];
+    }
+
+    // the first hit test builds the cached z order
+    [self.container hitTest:CGPointMake(1, 1) withEvent:nil];
+}
+
+- (void)tearDown
+{
+    self.container = nil;
+}
+
+- (void)hitTestContainer
+{
+    CGFloat height = CGRectGetHeight(self.container.bounds);
+    for (NSUInteger i = 0; i < TUIViewHitTestingTestsHits; i++) {
+        CGPoint point = CGPointMake((i * 37) % 320, fmod(i * 97.5, height));
+        [self.container hitTest:point withEvent:nil];
+    }
+}
+
+- (void)testHitTestPerformance
+{
+    [self measureBlock:^{
+        [self hitTestContainer];
+    }];
+}
+
+- (void)testHitTestDoesNotAllocate
+{
+    // the first pass sorts every row and leaf once
+    [self hitTestContainer];
+
+    TUIViewHitTestingTestsCountingThread = pthread_self();
+    atomic_store(&TUIViewHitTestingTestsAllocations, 0);
+    @autoreleasepool {
+        malloc_logger = TUIViewHitTestingTestsCountAllocation;
+        [self hitTestContainer];
+        // still inside the pool, so autoreleased temporaries are counted too
+        malloc_logger = NULL;
+    }
+
+    // every allocation on this thread counts, freed or not; allow a few incidental ones, not one per hit test
+    XCTAssertLessThan(atomic_load(&TUIViewHitTestingTestsAllocations), (unsigned long)10);
+}
+
+- (void)testHitTestFollowsZOrder
+{
+    TUIView *row = self.container.subviews[3];
+    TUIView *accessory = row.subviews[0];
+    TUIView *badge = row.subviews[1];
+
+    CGPoint overlap = [row convertPoint:CGPointMake(295, 10) toView:self.container];
+    XCTAssertEqual([self.container hitTest:overlap withEvent:nil], badge);
+
+    // raising the accessory above the badge reorders the cached subviews
+    accessory.layer.zPosition = 2;
+    XCTAssertEqual([self.container hitTest:overlap withEvent:nil], accessory);
+
+    CGPoint empty = [row convertPoint:CGPointMake(10, 10) toView:self.container];
+    XCTAssertEqual([self.container hitTest:empty withEvent:nil], row);
+}
+
+@end
@@ -20,4 +20,10 @@
  */
 + (TUIAnimationManager *)defaultManager;
 
+/*
+ * Runs the block once on the main run loop, before timers fire on its next
+ * iteration. Must be called on the main thread.
+ */
+- (void)performBlockBeforeTimers:(void (^)(void))block;
+
 @end
@@ -7,13 +7,6 @@
 
 #import "TUIAnimationManager.h"
 
-/**
- * Disables implicit AppKit animations on every run loop iteration.
- */
-static void mainRunLoopObserverCallback (CFRunLoopObserverRef observer, CFRunLoopActivity activity, void *info) {
-	[[NSAnimationContext currentContext] setDuration:0];
-}
-
 @interface TUIAnimationManager ()
 /**
  * The observer associated with the main run loop, responsible for invoking the
@@ -21,6 +14,11 @@ static void mainRunLoopObserverCallback (CFRunLoopObserverRef observer, CFRunLoo
  */
 @property (nonatomic) CFRunLoopObserverRef mainRunLoopObserver;
 
+/**
+ * Blocks to run on the next invocation of the mainRunLoopObserverCallback.
+ */
+@property (nonatomic, strong) NSMutableArray *pendingBlocks;
+
 /**
  * Invoked on the defaultManager when the application has finished launching.
  */
@@ -31,13 +29,28 @@ static void mainRunLoopObserverCallback (CFRunLoopObserverRef observer, CFRunLoo
  * mainRunLoopObserverCallback.
  */
 - (void)registerRunLoopObserver;
+
+/**
+ * Runs and clears the pendingBlocks.
+ */
+- (void)performPendingBlocks;
 @end
 
+/**
+ * Disables implicit AppKit animations on every run loop iteration, and runs
+ * any blocks queued with -performBlockBeforeTimers:.
+ */
+static void mainRunLoopObserverCallback (CFRunLoopObserverRef observer, CFRunLoopActivity activity, void *info) {
+	[[NSAnimationContext currentContext] setDuration:0];
+	[[TUIAnimationManager defaultManager] performPendingBlocks];
+}
+
 @implementation TUIAnimationManager
 
 #pragma mark Properties
 
 @synthesize mainRunLoopObserver = m_mainRunLoopObserver;
+@synthesize pendingBlocks = m_pendingBlocks;
 
 - (void)setMainRunLoopObserver:(CFRunLoopObserverRef)observer {
 	if (observer == m_mainRunLoopObserver)
@@ -104,11 +117,42 @@ static void mainRunLoopObserverCallback (CFRunLoopObserverRef observer, CFRunLoo
 	CFRelease(observer);
 }
 
+- (void)performBlockBeforeTimers:(void (^)(void))block {
+	NSParameterAssert(block != nil);
+	NSAssert([NSThread isMainThread], @"%@ must be called on the main thread", NSStringFromSelector(_cmd));
+
+	if (!self.pendingBlocks)
+		self.pendingBlocks = [NSMutableArray array];
+
+	[self.pendingBlocks addObject:[block copy]];
+
+	// work may be queued before the application finishes launching
+	if (!self.mainRunLoopObserver)
+		[self registerRunLoopObserver];
+
+	CFRunLoopWakeUp(CFRunLoopGetMain());
+}
+
+- (void)performPendingBlocks {
+	if (self.pendingBlocks.count == 0)
+		return;
+
+	// blocks may queue more work, which waits for the next iteration
+	NSArray *blocks = self.pendingBlocks;
+	self.pendingBlocks = nil;
+
+	for (void (^block)(void) in blocks) {
+		block();
+	}
+}
+
 #pragma mark Notifications
 
 - (void)applicationDidFinishLaunchingNotification:(NSNotification *)notification {
 	[[NSNotificationCenter defaultCenter] removeObserver:self name:notification.name object:nil];
-	[self registerRunLoopObserver];
+
+	if (!self.mainRunLoopObserver)
+		[self registerRunLoopObserver];
 }
 
 @end
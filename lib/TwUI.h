@@ -67,9 +67,12 @@
 #import <TWUI/TUIFastIndexPath.h>
 #import <TWUI/TUIFont.h>
 #import <TWUI/TUIGeometry.h>
+#import <TWUI/TUIGraphicsContextPool.h>
 #import <TWUI/TUIHostView.h>
 #import <TWUI/TUIImage.h>
 #import <TWUI/TUIImage+Drawing.h>
+#import <TWUI/TUIImage+Loading.h>
+#import <TWUI/TUIImageCache.h>
 #import <TWUI/TUIImageView.h>
 #import <TWUI/TUILabel.h>
 #import <TWUI/TUILayoutConstraint.h>
@@ -85,6 +88,7 @@
 #import <TWUI/TUIScrollKnob.h>
 #import <TWUI/TUIScrollView.h>
 #import <TWUI/TUIScrollView+TUIBridgedScrollView.h>
+#import <TWUI/TUIStretchableImage.h>
 #import <TWUI/TUIStringDrawing.h>
 #import <TWUI/TUIStyledView.h>
 #import <TWUI/TUITableView.h>
@@ -92,6 +96,7 @@
 #import <TWUI/TUITableView+Cell.h>
 #import <TWUI/TUITableView+Derepeater.h>
 #import <TWUI/TUITableViewCell.h>
+#import <TWUI/TUITableViewCellReusePool.h>
 #import <TWUI/TUITableViewController.h>
 #import <TWUI/TUITableViewFastLiveResizingContext.h>
 #import <TWUI/TUITableViewSectionHeader.h>
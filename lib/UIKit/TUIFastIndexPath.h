@@ -21,6 +21,38 @@
 #define TUIFastIndexPath_DANGEROUS_ISEQUAL 1
 #endif
 
+/**
+ A section/row pair packed into one integer: the section in the high 32 bits, the row in the low 32 bits.
+ Never allocates, and integer order is index path order, so table internals use these directly and only
+ box them into TUIFastIndexPath objects at the API boundary.
+ */
+typedef uint64_t TUIPackedIndexPath;
+
+#define TUIPackedIndexPathNotFound UINT64_MAX
+
+static inline TUIPackedIndexPath TUIPackedIndexPathMake(NSUInteger section, NSUInteger row)
+{
+	return ((TUIPackedIndexPath)(uint32_t)section << 32) | (uint32_t)row;
+}
+
+static inline NSUInteger TUIPackedIndexPathSection(TUIPackedIndexPath p)
+{
+	return (NSUInteger)(p >> 32);
+}
+
+static inline NSUInteger TUIPackedIndexPathRow(TUIPackedIndexPath p)
+{
+	return (NSUInteger)(p & 0xffffffff);
+}
+
+static inline NSUInteger TUIPackedIndexPathHash(TUIPackedIndexPath p)
+{
+	// splitmix64 finalizer, every input bit affects every output bit
+	p = (p ^ (p >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	p = (p ^ (p >> 27)) * 0x94d049bb133111ebULL;
+	return (NSUInteger)(p ^ (p >> 31));
+}
+
 #define TUIFastIndexPathFromNSIndexPath(indexPath)  (((indexPath) != nil) ? [TUIFastIndexPath indexPathForRow:(indexPath).row inSection:(indexPath).section] : nil)
 #define NSIndexPathFromTUIFastIndexPath(indexPath)  (((indexPath) != nil) ? [NSIndexPath indexPathForRow:(indexPath).row inSection:(indexPath).section] : nil)
 
@@ -35,11 +67,14 @@
 }
 
 + (TUIFastIndexPath *)indexPathForRow:(NSUInteger)row inSection:(NSUInteger)section;
++ (TUIFastIndexPath *)indexPathWithPackedIndexPath:(TUIPackedIndexPath)packedIndexPath;
 
 // duck type to NSIndexPath
 @property(nonatomic, readonly) NSUInteger section;
 @property(nonatomic, readonly) NSUInteger row;
 
+@property(nonatomic, readonly) TUIPackedIndexPath packedIndexPath;
+
 - (NSComparisonResult)compare:(TUIFastIndexPath *)i;
 - (BOOL)isEqual:(TUIFastIndexPath *)i;
 
@@ -67,6 +67,11 @@ static struct TUIFastIndexPath_staticStruct {
 	return f;
 }
 
++ (TUIFastIndexPath *)indexPathWithPackedIndexPath:(TUIPackedIndexPath)packedIndexPath
+{
+	return [self indexPathForRow:TUIPackedIndexPathRow(packedIndexPath) inSection:TUIPackedIndexPathSection(packedIndexPath)];
+}
+
 - (instancetype)copyWithZone:(NSZone *)zone
 {
 	return self;  // change me if we ever do mutable index paths
@@ -101,9 +106,14 @@ static struct TUIFastIndexPath_staticStruct {
 	return row;
 }
 
+- (TUIPackedIndexPath)packedIndexPath
+{
+	return TUIPackedIndexPathMake(section, row);
+}
+
 - (NSUInteger)hash
 {
-	return ((section << 28) ^ row); // assume we're going to have a lot more rows than sections
+	return TUIPackedIndexPathHash(TUIPackedIndexPathMake(section, row));
 }
 
 - (NSComparisonResult)compare:(TUIFastIndexPath *)i
@@ -128,7 +138,7 @@ static struct TUIFastIndexPath_staticStruct {
 #if TUIFastIndexPath_DANGEROUS_ISEQUAL
 	return ((row == i->row) && (section == i->section)); // assume it's a TUIFastIndexPath - this may be stupid for your app
 #else
-	if([i isKindOfClass:[TUIFastIndexPath class]]
+	if([i isKindOfClass:[TUIFastIndexPath class]])
 	   return ((row == i->row) && (section == i->section));
 	else if([i isKindOfClass:[NSIndexPath class]]) // we never hit this in T2
 	   return ((row == i.row) && (section == i.section));
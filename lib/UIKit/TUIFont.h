@@ -17,7 +17,7 @@
 #import <Foundation/Foundation.h>
 
 /*
- Your best bet is to build commonly used fonts at launch, cache for the lifetime of the app
+ Fonts returned by the class factory methods are shared: asking twice for the same name and size returns the same instance, from any thread.  Descriptors and their fallback cascade lists are built once per font name.  Both caches are bounded and are emptied when the system reports memory pressure.
  */
 
 @interface TUIFont : NSObject
@@ -51,3 +51,16 @@
 + (NSString *)boldDefaultFontName;
 
 @end
+
+@interface TUIFont (FontCache)
+
++ (NSUInteger)fontCacheHitCount;
++ (NSUInteger)fontCacheMissCount;
++ (void)resetFontCacheStatistics;
+
+/**
+ Drops the shared fonts, descriptors and default font metrics; instances already handed out stay valid.  Called automatically under memory pressure.
+ */
++ (void)removeAllCachedFonts;
+
+@end
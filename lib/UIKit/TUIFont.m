@@ -15,6 +15,100 @@
  */
 
 #import "TUIFont.h"
+#import "TUIGeometry.h"
+#import <pthread.h>
+
+typedef NS_ENUM(NSUInteger, TUIFontCacheTraits) {
+    TUIFontCacheTraitsNone = 0,
+    TUIFontCacheTraitsSystem,
+    TUIFontCacheTraitsBoldSystem,
+};
+
+@interface TUIFontCacheKey : NSObject <NSCopying>
+{
+    @public
+    NSString * _fontName;
+    CGFloat _pointSize;
+    TUIFontCacheTraits _traits;
+}
+@end
+
+@implementation TUIFontCacheKey
+
+- (NSUInteger)hash
+{
+    return (_fontName.hash * 31) ^ (NSUInteger)(_pointSize * 64.0) ^ (_traits << 24);
+}
+
+- (BOOL)isEqual:(id)object
+{
+    TUIFontCacheKey * other = object;
+    if (![other isKindOfClass:[TUIFontCacheKey class]]) {
+        return NO;
+    }
+    return _pointSize == other->_pointSize && _traits == other->_traits && (_fontName == other->_fontName || [_fontName isEqualToString:other->_fontName]);
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self; // immutable once it is used as a key
+}
+
+@end
+
+static pthread_mutex_t TUIFontCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static NSCache * TUIFontCache = nil; // TUIFontCacheKey -> TUIFont
+static NSUInteger TUIFontCacheHits = 0;
+static NSUInteger TUIFontCacheMisses = 0;
+
+// enough for every font a window full of timelines uses; arbitrary sizes from animations or zooming get evicted
+static const NSUInteger TUIFontCacheCountLimit = 256;
+static const NSUInteger TUIFontDescriptorCacheCountLimit = 64;
+
+/**
+ * Returns the shared font for (name, size, traits), creating it with
+ * @p createBlock outside the lock on a miss.  Two threads missing at once both create a font, the
+ * first one stored wins.
+ */
+static TUIFont * TUIFontCacheFontForKey(NSString * fontName, CGFloat pointSize, TUIFontCacheTraits traits, TUIFont * (^createBlock)(void))
+{
+    TUIFontCacheKey * key = [[TUIFontCacheKey alloc] init];
+    key->_fontName = [fontName copy];
+    key->_pointSize = pointSize;
+    key->_traits = traits;
+    
+    pthread_mutex_lock(&TUIFontCacheLock);
+    TUIFont * font = [TUIFontCache objectForKey:key];
+    if (font) {
+        TUIFontCacheHits++;
+    } else {
+        TUIFontCacheMisses++;
+    }
+    pthread_mutex_unlock(&TUIFontCacheLock);
+    
+    if (font) {
+        return font;
+    }
+    
+    TUIFont * newFont = createBlock();
+    if (!newFont) {
+        return nil;
+    }
+    
+    pthread_mutex_lock(&TUIFontCacheLock);
+    if (!TUIFontCache) {
+        TUIFontCache = [[NSCache alloc] init];
+        TUIFontCache.countLimit = TUIFontCacheCountLimit;
+    }
+    font = [TUIFontCache objectForKey:key];
+    if (!font) {
+        font = newFont;
+        [TUIFontCache setObject:font forKey:key];
+    }
+    pthread_mutex_unlock(&TUIFontCacheLock);
+    
+    return font;
+}
 
 @implementation TUIFont
 
@@ -39,7 +133,8 @@ static NSRange MakeNSRangeFromEndpoints(NSUInteger first, NSUInteger last) {
 }
 
 static NSArray * defaultFallbacks = nil;
-static NSDictionary *CachedFontDescriptors = nil;
+static NSCache *CachedFontDescriptors = nil; // font name -> descriptor with its cascade list, guarded by TUIFontCacheLock
+static dispatch_source_t TUIFontMemoryPressureSource = NULL;
 
 + (void)initialize
 {
@@ -64,28 +159,28 @@ static NSDictionary *CachedFontDescriptors = nil;
         
         defaultFallbacks = fallbacks;
         
-        NSString *normalFontName = [self defaultFontName];
-        NSString *lightFontName = [self lightDefaultFontName];
-        NSString *mediumFontName = [self defaultFontName];
-        NSString *boldFontName = [self boldDefaultFontName];
+        CachedFontDescriptors = [[NSCache alloc] init];
+        CachedFontDescriptors.countLimit = TUIFontDescriptorCacheCountLimit;
         
-        NSFontDescriptor *D_HelveticaNeue = [self fontDescriptorWithName:normalFontName];
-        NSFontDescriptor *D_HelveticaNeue_Light = [self fontDescriptorWithName:lightFontName];
-        NSFontDescriptor *D_HelveticaNeue_Medium = [self fontDescriptorWithName:mediumFontName];
-        NSFontDescriptor *D_HelveticaNeue_Bold = [self fontDescriptorWithName:boldFontName];
+        // same policy as TUIImageCache: everything here can be rebuilt on demand
+        TUIFontMemoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+        dispatch_source_set_event_handler(TUIFontMemoryPressureSource, ^{
+            [TUIFont removeAllCachedFonts];
+        });
+        dispatch_resume(TUIFontMemoryPressureSource);
         
-        CachedFontDescriptors = [NSDictionary dictionaryWithObjectsAndKeys:
-                                 D_HelveticaNeue, normalFontName,
-                                 D_HelveticaNeue_Light, lightFontName,
-                                 D_HelveticaNeue_Medium, mediumFontName,
-                                 D_HelveticaNeue_Bold, boldFontName,
-                                 nil];
+        [self fontDescriptorWithName:[self defaultFontName]];
+        [self fontDescriptorWithName:[self lightDefaultFontName]];
+        [self fontDescriptorWithName:[self mediumDefaultFontName]];
+        [self fontDescriptorWithName:[self boldDefaultFontName]];
     }
 }
 
 + (NSFontDescriptor *)fontDescriptorWithName:(NSString *)fontName
 {
-    NSFontDescriptor *desc = [CachedFontDescriptors objectForKey:fontName];
+    pthread_mutex_lock(&TUIFontCacheLock);
+    NSFontDescriptor *desc = fontName ? [CachedFontDescriptors objectForKey:fontName] : nil;
+    pthread_mutex_unlock(&TUIFontCacheLock);
 
     if(!desc) {
         NSMutableArray * fallbacks = [NSMutableArray array];
@@ -106,6 +201,12 @@ static NSDictionary *CachedFontDescriptors = nil;
                  fontName, NSFontNameAttribute,
                  fallbacks, NSFontCascadeListAttribute, // oh thank you jesus
                  nil]];
+        
+        if(fontName) {
+            pthread_mutex_lock(&TUIFontCacheLock);
+            [CachedFontDescriptors setObject:desc forKey:fontName];
+            pthread_mutex_unlock(&TUIFontCacheLock);
+        }
     }
 
     return desc;
@@ -118,24 +219,27 @@ static NSDictionary *CachedFontDescriptors = nil;
 
 + (TUIFont *)fontWithName:(NSString *)fontName size:(CGFloat)fontSize
 {
-    NSFontDescriptor *desc = [self fontDescriptorWithName:fontName];
-    CTFontRef font = CTFontCreateWithFontDescriptor((__bridge CTFontDescriptorRef)desc, fontSize, NULL);
-    TUIFont *uiFont = [[TUIFont alloc] initWithCTFont:font];
-    CFRelease(font);
-    
-    return uiFont;
+    return TUIFontCacheFontForKey(fontName, fontSize, TUIFontCacheTraitsNone, ^TUIFont *{
+        NSFontDescriptor *desc = [self fontDescriptorWithName:fontName];
+        CTFontRef font = CTFontCreateWithFontDescriptor((__bridge CTFontDescriptorRef)desc, fontSize, NULL);
+        TUIFont *uiFont = [[TUIFont alloc] initWithCTFont:font];
+        CFRelease(font);
+        return uiFont;
+    });
 }
 
 + (TUIFont *)systemFontOfSize:(CGFloat)fontSize
 {
-    TUIFont *uifont = [[TUIFont alloc] initWithCTFont:(CTFontRef)[NSFont systemFontOfSize:fontSize]];
-    return uifont;
+    return TUIFontCacheFontForKey(nil, fontSize, TUIFontCacheTraitsSystem, ^TUIFont *{
+        return [[TUIFont alloc] initWithCTFont:(CTFontRef)[NSFont systemFontOfSize:fontSize]];
+    });
 }
 
 + (TUIFont *)boldSystemFontOfSize:(CGFloat)fontSize
 {
-    TUIFont *uifont = [[TUIFont alloc] initWithCTFont:(CTFontRef)[NSFont boldSystemFontOfSize:fontSize]];
-    return uifont;
+    return TUIFontCacheFontForKey(nil, fontSize, TUIFontCacheTraitsBoldSystem, ^TUIFont *{
+        return [[TUIFont alloc] initWithCTFont:(CTFontRef)[NSFont boldSystemFontOfSize:fontSize]];
+    });
 }
 
 - (NSString *)familyName { return (__bridge_transfer NSString *)CTFontCopyFamilyName(_ctFont); }
@@ -258,3 +362,41 @@ static NSDictionary *CachedFontDescriptors = nil;
 }
 
 @end
+
+@implementation TUIFont (FontCache)
+
++ (NSUInteger)fontCacheHitCount
+{
+    pthread_mutex_lock(&TUIFontCacheLock);
+    NSUInteger hits = TUIFontCacheHits;
+    pthread_mutex_unlock(&TUIFontCacheLock);
+    return hits;
+}
+
++ (NSUInteger)fontCacheMissCount
+{
+    pthread_mutex_lock(&TUIFontCacheLock);
+    NSUInteger misses = TUIFontCacheMisses;
+    pthread_mutex_unlock(&TUIFontCacheLock);
+    return misses;
+}
+
++ (void)resetFontCacheStatistics
+{
+    pthread_mutex_lock(&TUIFontCacheLock);
+    TUIFontCacheHits = 0;
+    TUIFontCacheMisses = 0;
+    pthread_mutex_unlock(&TUIFontCacheLock);
+}
+
++ (void)removeAllCachedFonts
+{
+    pthread_mutex_lock(&TUIFontCacheLock);
+    [TUIFontCache removeAllObjects];
+    [CachedFontDescriptors removeAllObjects];
+    pthread_mutex_unlock(&TUIFontCacheLock);
+    
+    TUIFontMetricsRemoveAllCachedDefaults();
+}
+
+@end
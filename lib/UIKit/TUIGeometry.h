@@ -110,6 +110,17 @@ static inline BOOL TUIFontMetricsEqual(TUIFontMetrics m1, TUIFontMetrics m2)
 
 TUI_EXTERN TUIFontMetrics TUIFontMetricsGetDefault(NSInteger pointSize);
 
+/**
+ * @brief Metrics of the system font at @p pointSize, fractional sizes included
+ *
+ * Results are memoized in a bounded cache that is emptied under memory
+ * pressure, and the function is safe to call from any thread.
+ */
+TUI_EXTERN TUIFontMetrics TUIFontMetricsGetDefaultForPointSize(CGFloat pointSize);
+TUI_EXTERN void TUIFontMetricsGetDefaultCacheStatistics(NSUInteger * hitCount, NSUInteger * missCount);
+TUI_EXTERN void TUIFontMetricsResetDefaultCacheStatistics(void);
+TUI_EXTERN void TUIFontMetricsRemoveAllCachedDefaults(void);
+
 @interface NSCoder (TUIFontMetricsKeyedCoding)
 
 - (void)tui_encodeFontMetrics:(TUIFontMetrics)metrics forKey:(NSString *)key;
@@ -15,6 +15,7 @@
  */
 
 #import "TUIGeometry.h"
+#import <pthread.h>
 
 const TUIEdgeInsets TUIEdgeInsetsZero = { 0.0, 0.0, 0.0, 0.0 };
 
@@ -39,26 +40,75 @@ const TUIFontMetrics TUIFontMetricsNull = {NSNotFound, NSNotFound, NSNotFound};
 
 @end
 
-static TUIFontMetrics TUICachedFontMetrics[13];
+static pthread_mutex_t TUIFontMetricsCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static NSCache * TUIFontMetricsCache = nil; // NSNumber(pointSize) -> NSValue(TUIFontMetrics)
+static const NSUInteger TUIFontMetricsCacheCountLimit = 128;
+static NSUInteger TUIFontMetricsCacheHits = 0;
+static NSUInteger TUIFontMetricsCacheMisses = 0;
 
 TUI_EXTERN TUIFontMetrics TUIFontMetricsGetDefault(NSInteger pointSize)
 {
-    if (pointSize < 8 || pointSize > 20)
-    {
-        NSFont * font = [NSFont systemFontOfSize:pointSize];
-        return TUIFontMetricsMakeFromNSFont(font);
+    return TUIFontMetricsGetDefaultForPointSize(pointSize);
+}
+
+TUI_EXTERN TUIFontMetrics TUIFontMetricsGetDefaultForPointSize(CGFloat pointSize)
+{
+    NSNumber * key = @(pointSize);
+    TUIFontMetrics metrics;
+    
+    pthread_mutex_lock(&TUIFontMetricsCacheLock);
+    NSValue * value = [TUIFontMetricsCache objectForKey:key];
+    if (value) {
+        TUIFontMetricsCacheHits++;
+        [value getValue:&metrics];
+    } else {
+        TUIFontMetricsCacheMisses++;
+    }
+    pthread_mutex_unlock(&TUIFontMetricsCacheLock);
+    
+    if (value) {
+        return metrics;
     }
     
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        @autoreleasepool {
-            for (NSInteger i = 0; i < 13; i++) {
-                NSUInteger pointSize = i + 8;
-                NSFont * font = [NSFont systemFontOfSize:pointSize];
-                TUICachedFontMetrics[i] = TUIFontMetricsMakeFromNSFont(font);
-            }
-        }
-    });
+    // measure outside the lock, a racing thread computes the same thing
+    @autoreleasepool {
+        metrics = TUIFontMetricsMakeFromNSFont([NSFont systemFontOfSize:pointSize]);
+    }
     
-    return TUICachedFontMetrics[pointSize - 8];
+    pthread_mutex_lock(&TUIFontMetricsCacheLock);
+    if (!TUIFontMetricsCache) {
+        TUIFontMetricsCache = [[NSCache alloc] init];
+        TUIFontMetricsCache.countLimit = TUIFontMetricsCacheCountLimit;
+    }
+    [TUIFontMetricsCache setObject:[NSValue valueWithBytes:&metrics objCType:@encode(TUIFontMetrics)] forKey:key];
+    pthread_mutex_unlock(&TUIFontMetricsCacheLock);
+    
+    return metrics;
+}
+
+TUI_EXTERN void TUIFontMetricsGetDefaultCacheStatistics(NSUInteger * hitCount, NSUInteger * missCount)
+{
+    pthread_mutex_lock(&TUIFontMetricsCacheLock);
+    if (hitCount) {
+        *hitCount = TUIFontMetricsCacheHits;
+    }
+    if (missCount) {
+        *missCount = TUIFontMetricsCacheMisses;
+    }
+    pthread_mutex_unlock(&TUIFontMetricsCacheLock);
+}
+
+TUI_EXTERN void TUIFontMetricsResetDefaultCacheStatistics(void)
+{
+    pthread_mutex_lock(&TUIFontMetricsCacheLock);
+    TUIFontMetricsCacheHits = 0;
+    TUIFontMetricsCacheMisses = 0;
+    pthread_mutex_unlock(&TUIFontMetricsCacheLock);
+}
+
+TUI_EXTERN void TUIFontMetricsRemoveAllCachedDefaults(void)
+{
+    pthread_mutex_lock(&TUIFontMetricsCacheLock);
+    [TUIFontMetricsCache removeAllObjects];
+    pthread_mutex_unlock(&TUIFontMetricsCacheLock);
 }
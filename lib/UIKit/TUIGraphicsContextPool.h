@@ -0,0 +1,57 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ A process-wide pool of bitmap memory for views that don't cache their context, so a draw can reuse the pixels of an earlier one instead of allocating and freeing a full-size bitmap every time.
+
+ A buffer is lent to a context, and then to the image made from it with -copyImageFromGraphicsContext:.  It only goes back to the pool once both are gone, that is once the layer has let go of the image, so pooled memory is never shared with anything still on screen.  Buffers are matched on pixel size, opacity and color space.  The pool keeps at most totalBytesLimit bytes of idle buffers, drops the oldest ones beyond that and empties itself under memory pressure.  All methods are thread safe.
+ */
+@interface TUIGraphicsContextPool : NSObject
+
++ (instancetype)sharedPool;
+
+/**
+ Maximum bytes of idle buffers kept around, 0 disables pooling.  The shared pool defaults to 32 MB.
+ */
+@property (nonatomic, assign) NSUInteger totalBytesLimit;
+
+/**
+ Returns a context like the one TUICreateGraphicsContextWithOptions() would create for the current display, drawing into a pooled buffer when one is idle.  Transparent contexts are cleared; opaque ones may hold an earlier drawing, as documented for -[TUIView opaque].  The caller owns the returned context.
+ */
+- (CGContextRef)copyGraphicsContextWithPixelSize:(CGSize)size opaque:(BOOL)opaque CF_RETURNS_RETAINED;
+
+/**
+ Returns an image of @p context that uses its buffer without copying it.  Release the context right after and don't draw into it again; the buffer goes back to the pool when the image is freed.  Falls back to CGBitmapContextCreateImage() for contexts that didn't come from the pool.
+ */
+- (CGImageRef)copyImageFromGraphicsContext:(CGContextRef)context CF_RETURNS_RETAINED;
+
+- (void)removeAllBuffers;
+
+@property (nonatomic, readonly) NSUInteger totalBytes; // idle buffers currently pooled
+@property (nonatomic, readonly) NSUInteger lentBytes;  // buffers held by contexts or images
+
+// statistics
+@property (nonatomic, readonly) NSUInteger reuseCount;      // contexts served from an idle buffer
+@property (nonatomic, readonly) NSUInteger allocationCount; // contexts that needed a new buffer
+@property (nonatomic, readonly) NSUInteger discardCount;    // buffers freed for the byte limit
+@property (nonatomic, readonly) NSUInteger peakBytes;       // high-water mark of totalBytes + lentBytes
+@property (nonatomic, readonly) double reuseRate;           // reuseCount / (reuseCount + allocationCount), 0 before any draw
+
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,393 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIGraphicsContextPool.h"
+#import "TUICGAdditions.h"
+#import <pthread.h>
+
+typedef struct TUIGraphicsContextPoolBuffer {
+	struct TUIGraphicsContextPoolBuffer *previous; // idle list, towards the most recently returned
+	struct TUIGraphicsContextPoolBuffer *next;
+	void *data;
+	size_t width;
+	size_t height;
+	size_t bytesPerRow;
+	BOOL opaque;
+	CGColorSpaceRef colorSpace;
+	NSUInteger references; // the context, then the image made from it
+	const void *pool; // retained while lent
+} TUIGraphicsContextPoolBuffer;
+
+static size_t TUIGraphicsContextPoolBufferBytes(TUIGraphicsContextPoolBuffer *buffer)
+{
+	return buffer->bytesPerRow * buffer->height;
+}
+
+static CGBitmapInfo TUIGraphicsContextPoolBitmapInfo(BOOL opaque)
+{
+	// same formats as TUICreateGraphicsContextWithOptions()
+	return kCGBitmapByteOrder32Host | (opaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst);
+}
+
+static void TUIGraphicsContextPoolFreeBuffer(TUIGraphicsContextPoolBuffer *buffer)
+{
+	CGColorSpaceRelease(buffer->colorSpace);
+	free(buffer->data);
+	free(buffer);
+}
+
+// a list linked through next
+static void TUIGraphicsContextPoolFreeBuffers(TUIGraphicsContextPoolBuffer *buffer)
+{
+	while(buffer) {
+		TUIGraphicsContextPoolBuffer *next = buffer->next;
+		TUIGraphicsContextPoolFreeBuffer(buffer);
+		buffer = next;
+	}
+}
+
+@interface TUIGraphicsContextPool ()
+- (void)_releaseBuffer:(TUIGraphicsContextPoolBuffer *)buffer;
+@end
+
+static void TUIGraphicsContextPoolReleaseBuffer(TUIGraphicsContextPoolBuffer *buffer)
+{
+	const void *pool = buffer->pool;
+	[(__bridge TUIGraphicsContextPool *)pool _releaseBuffer:buffer];
+	CFRelease(pool);
+}
+
+static void TUIGraphicsContextPoolReleaseContextData(void *releaseInfo, void *data)
+{
+	TUIGraphicsContextPoolReleaseBuffer(releaseInfo);
+}
+
+static void TUIGraphicsContextPoolReleaseImageData(void *info, const void *data, size_t size)
+{
+	TUIGraphicsContextPoolReleaseBuffer(info);
+}
+
+@implementation TUIGraphicsContextPool
+{
+	pthread_mutex_t _lock;
+	TUIGraphicsContextPoolBuffer *_newestIdleBuffer;
+	TUIGraphicsContextPoolBuffer *_oldestIdleBuffer;
+	CFMutableDictionaryRef _lentBuffers; // data -> buffer
+	NSUInteger _totalBytesLimit;
+	NSUInteger _totalBytes;
+	NSUInteger _lentBytes;
+	NSUInteger _reuseCount;
+	NSUInteger _allocationCount;
+	NSUInteger _discardCount;
+	NSUInteger _peakBytes;
+	dispatch_source_t _memoryPressureSource;
+}
+
++ (instancetype)sharedPool
+{
+	static TUIGraphicsContextPool *pool = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		pool = [[TUIGraphicsContextPool alloc] init];
+		pool.totalBytesLimit = 32 * 1024 * 1024;
+	});
+	return pool;
+}
+
+- (instancetype)init
+{
+	if((self = [super init])) {
+		pthread_mutex_init(&_lock, NULL);
+		_lentBuffers = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+
+		__weak TUIGraphicsContextPool *weakSelf = self;
+		_memoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		dispatch_source_set_event_handler(_memoryPressureSource, ^{
+			[weakSelf removeAllBuffers];
+		});
+		dispatch_resume(_memoryPressureSource);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	// lent buffers keep the pool alive, so only idle ones are left
+	dispatch_source_cancel(_memoryPressureSource);
+	[self removeAllBuffers];
+	CFRelease(_lentBuffers);
+	pthread_mutex_destroy(&_lock);
+}
+
+#pragma mark - Idle List
+
+// call with _lock held
+- (void)_removeIdleBuffer:(TUIGraphicsContextPoolBuffer *)buffer
+{
+	if(buffer->previous)
+		buffer->previous->next = buffer->next;
+	else
+		_newestIdleBuffer = buffer->next;
+	if(buffer->next)
+		buffer->next->previous = buffer->previous;
+	else
+		_oldestIdleBuffer = buffer->previous;
+	buffer->previous = buffer->next = NULL;
+	_totalBytes -= TUIGraphicsContextPoolBufferBytes(buffer);
+}
+
+// call with _lock held; returns the oldest buffers beyond bytes, linked through next, for freeing outside the lock
+- (TUIGraphicsContextPoolBuffer *)_trimToBytes:(NSUInteger)bytes
+{
+	TUIGraphicsContextPoolBuffer *discarded = NULL;
+	while(_totalBytes > bytes && _oldestIdleBuffer) {
+		TUIGraphicsContextPoolBuffer *buffer = _oldestIdleBuffer;
+		[self _removeIdleBuffer:buffer];
+		buffer->next = discarded;
+		discarded = buffer;
+		_discardCount++;
+	}
+	return discarded;
+}
+
+#pragma mark - Lending
+
+- (CGContextRef)copyGraphicsContextWithPixelSize:(CGSize)size opaque:(BOOL)opaque
+{
+	size_t width = size.width;
+	size_t height = size.height;
+	CGColorSpaceRef colorSpace = TUICopyCurrentDisplayColorSpace();
+	TUIGraphicsContextPoolBuffer *buffer = NULL;
+
+	pthread_mutex_lock(&_lock);
+	for(TUIGraphicsContextPoolBuffer *candidate = _newestIdleBuffer; candidate; candidate = candidate->next) {
+		if(candidate->width == width && candidate->height == height && candidate->opaque == opaque && CFEqual(candidate->colorSpace, colorSpace)) {
+			buffer = candidate;
+			[self _removeIdleBuffer:buffer];
+			break;
+		}
+	}
+	if(buffer)
+		_reuseCount++;
+	else
+		_allocationCount++;
+	pthread_mutex_unlock(&_lock);
+
+	if(buffer) {
+		CGColorSpaceRelease(colorSpace);
+		// opaque views fill their bounds themselves
+		if(!opaque)
+			memset(buffer->data, 0, TUIGraphicsContextPoolBufferBytes(buffer));
+	} else {
+		buffer = calloc(1, sizeof(TUIGraphicsContextPoolBuffer));
+		buffer->width = width;
+		buffer->height = height;
+		buffer->bytesPerRow = 4 * width;
+		buffer->opaque = opaque;
+		buffer->colorSpace = colorSpace;
+		buffer->data = calloc(height, buffer->bytesPerRow);
+		if(!buffer->data) {
+			TUIGraphicsContextPoolFreeBuffer(buffer);
+			return NULL;
+		}
+	}
+
+	buffer->references = 1;
+	buffer->pool = CFBridgingRetain(self);
+
+	pthread_mutex_lock(&_lock);
+	CFDictionarySetValue(_lentBuffers, buffer->data, buffer);
+	_lentBytes += TUIGraphicsContextPoolBufferBytes(buffer);
+	_peakBytes = MAX(_peakBytes, _totalBytes + _lentBytes);
+	pthread_mutex_unlock(&_lock);
+
+	CGContextRef context = CGBitmapContextCreateWithData(buffer->data, width, height, 8, buffer->bytesPerRow, buffer->colorSpace, TUIGraphicsContextPoolBitmapInfo(opaque), TUIGraphicsContextPoolReleaseContextData, buffer);
+	if(!context)
+		TUIGraphicsContextPoolReleaseBuffer(buffer);
+	return context;
+}
+
+- (CGImageRef)copyImageFromGraphicsContext:(CGContextRef)context
+{
+	if(!context)
+		return NULL;
+
+	pthread_mutex_lock(&_lock);
+	TUIGraphicsContextPoolBuffer *buffer = (TUIGraphicsContextPoolBuffer *)CFDictionaryGetValue(_lentBuffers, CGBitmapContextGetData(context));
+	if(buffer) {
+		buffer->references++;
+		CFRetain(buffer->pool);
+	}
+	pthread_mutex_unlock(&_lock);
+
+	if(!buffer)
+		return CGBitmapContextCreateImage(context);
+
+	// make sure everything drawn so far has landed in the buffer
+	CGContextFlush(context);
+
+	CGDataProviderRef provider = CGDataProviderCreateWithData(buffer, buffer->data, TUIGraphicsContextPoolBufferBytes(buffer), TUIGraphicsContextPoolReleaseImageData);
+	if(!provider) {
+		TUIGraphicsContextPoolReleaseBuffer(buffer);
+		return CGBitmapContextCreateImage(context);
+	}
+	CGImageRef image = CGImageCreate(buffer->width, buffer->height, 8, 32, buffer->bytesPerRow, buffer->colorSpace, TUIGraphicsContextPoolBitmapInfo(buffer->opaque), provider, NULL, false, kCGRenderingIntentDefault);
+	CGDataProviderRelease(provider);
+	return image;
+}
+
+// called once per reference, from whichever thread frees the context or the image
+- (void)_releaseBuffer:(TUIGraphicsContextPoolBuffer *)buffer
+{
+	TUIGraphicsContextPoolBuffer *discarded = NULL;
+
+	pthread_mutex_lock(&_lock);
+	if(--buffer->references > 0) {
+		pthread_mutex_unlock(&_lock);
+		return;
+	}
+
+	CFDictionaryRemoveValue(_lentBuffers, buffer->data);
+	size_t bytes = TUIGraphicsContextPoolBufferBytes(buffer);
+	_lentBytes -= bytes;
+	buffer->pool = NULL;
+	if(bytes <= _totalBytesLimit) {
+		buffer->next = _newestIdleBuffer;
+		if(_newestIdleBuffer)
+			_newestIdleBuffer->previous = buffer;
+		else
+			_oldestIdleBuffer = buffer;
+		_newestIdleBuffer = buffer;
+		_totalBytes += bytes;
+		discarded = [self _trimToBytes:_totalBytesLimit];
+	} else {
+		discarded = buffer;
+		_discardCount++;
+	}
+	pthread_mutex_unlock(&_lock);
+
+	TUIGraphicsContextPoolFreeBuffers(discarded);
+}
+
+- (void)removeAllBuffers
+{
+	pthread_mutex_lock(&_lock);
+	TUIGraphicsContextPoolBuffer *discarded = _newestIdleBuffer;
+	_newestIdleBuffer = _oldestIdleBuffer = NULL;
+	_totalBytes = 0;
+	pthread_mutex_unlock(&_lock);
+
+	TUIGraphicsContextPoolFreeBuffers(discarded);
+}
+
+#pragma mark - Properties
+
+- (NSUInteger)totalBytesLimit
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger limit = _totalBytesLimit;
+	pthread_mutex_unlock(&_lock);
+	return limit;
+}
+
+- (void)setTotalBytesLimit:(NSUInteger)totalBytesLimit
+{
+	pthread_mutex_lock(&_lock);
+	_totalBytesLimit = totalBytesLimit;
+	TUIGraphicsContextPoolBuffer *discarded = [self _trimToBytes:_totalBytesLimit];
+	pthread_mutex_unlock(&_lock);
+
+	TUIGraphicsContextPoolFreeBuffers(discarded);
+}
+
+- (NSUInteger)totalBytes
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger bytes = _totalBytes;
+	pthread_mutex_unlock(&_lock);
+	return bytes;
+}
+
+- (NSUInteger)lentBytes
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger bytes = _lentBytes;
+	pthread_mutex_unlock(&_lock);
+	return bytes;
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)reuseCount
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger count = _reuseCount;
+	pthread_mutex_unlock(&_lock);
+	return count;
+}
+
+- (NSUInteger)allocationCount
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger count = _allocationCount;
+	pthread_mutex_unlock(&_lock);
+	return count;
+}
+
+- (NSUInteger)discardCount
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger count = _discardCount;
+	pthread_mutex_unlock(&_lock);
+	return count;
+}
+
+- (NSUInteger)peakBytes
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger bytes = _peakBytes;
+	pthread_mutex_unlock(&_lock);
+	return bytes;
+}
+
+- (double)reuseRate
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger count = _reuseCount + _allocationCount;
+	double rate = count ? (double)_reuseCount / count : 0;
+	pthread_mutex_unlock(&_lock);
+	return rate;
+}
+
+- (void)resetStatistics
+{
+	pthread_mutex_lock(&_lock);
+	_reuseCount = 0;
+	_allocationCount = 0;
+	_discardCount = 0;
+	_peakBytes = _totalBytes + _lentBytes;
+	pthread_mutex_unlock(&_lock);
+}
+
+- (NSString *)description
+{
+	pthread_mutex_lock(&_lock);
+	NSString *description = [NSString stringWithFormat:@"<%@: %p idle=%lu/%lu lent=%lu peak=%lu reused=%lu allocated=%lu discarded=%lu>", [self class], self, (unsigned long)_totalBytes, (unsigned long)_totalBytesLimit, (unsigned long)_lentBytes, (unsigned long)_peakBytes, (unsigned long)_reuseCount, (unsigned long)_allocationCount, (unsigned long)_discardCount];
+	pthread_mutex_unlock(&_lock);
+	return description;
+}
+
+@end
@@ -0,0 +1,47 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIImage.h"
+
+/**
+ A pending asynchronous image load.  Cancelling it guarantees the completion handler won't run.
+ */
+@interface TUIImageLoadRequest : NSObject
+
+@property (nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+
+- (void)cancel; // main thread only
+
+@end
+
+@interface TUIImage (Loading)
+
+/**
+ Decodes @p data on a background queue, downsampled with ImageIO so that it just covers @p size points at @p scale, and calls @p completion on the main thread.  Images smaller than that are decoded at full size, never upscaled.  Pass CGSizeZero to decode at full size.  @p completion gets nil if the data can't be decoded.
+ */
++ (TUIImageLoadRequest *)loadImageWithData:(NSData *)data size:(CGSize)size scale:(CGFloat)scale completion:(void(^)(TUIImage *image))completion;
+
+/**
+ Same as above, reading a file URL on the background queue as well.
+ */
++ (TUIImageLoadRequest *)loadImageWithContentsOfURL:(NSURL *)url size:(CGSize)size scale:(CGFloat)scale completion:(void(^)(TUIImage *image))completion;
+
+/**
+ Synchronous version of the decoding step, safe to call from any thread.
+ */
++ (TUIImage *)imageWithData:(NSData *)data downsampledToSize:(CGSize)size scale:(CGFloat)scale;
+
+@end
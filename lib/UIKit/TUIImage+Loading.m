@@ -0,0 +1,151 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIImage+Loading.h"
+#import <ImageIO/ImageIO.h>
+
+@interface TUIImageLoadRequest ()
+
+@property (atomic, assign, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, strong) NSOperation *operation;
+
+@end
+
+@implementation TUIImageLoadRequest
+
+- (void)cancel
+{
+	self.cancelled = YES;
+	[self.operation cancel];
+	self.operation = nil;
+}
+
+@end
+
+@implementation TUIImage (Loading)
+
++ (NSOperationQueue *)_loadingQueue
+{
+	static NSOperationQueue *queue = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		queue = [[NSOperationQueue alloc] init];
+		queue.name = @"com.twitter.TUIImage.loading";
+		queue.maxConcurrentOperationCount = MAX(2, (NSInteger)[[NSProcessInfo processInfo] activeProcessorCount] / 2);
+		queue.qualityOfService = NSQualityOfServiceUserInitiated;
+	});
+	return queue;
+}
+
+/**
+ * @brief Longest side, in pixels, of an image of @p imageSize scaled to cover
+ * @p size points at @p scale.  Returns 0 when no downsampling is needed.
+ */
+static CGFloat TUIImageLoadingMaxPixelSize(CGSize imageSize, CGSize size, CGFloat scale)
+{
+	if(size.width <= 0 || size.height <= 0 || imageSize.width <= 0 || imageSize.height <= 0)
+		return 0;
+
+	CGFloat factor = MAX(size.width * scale / imageSize.width, size.height * scale / imageSize.height);
+	if(factor >= 1)
+		return 0;
+
+	return ceil(MAX(imageSize.width, imageSize.height) * factor);
+}
+
++ (TUIImage *)_imageWithImageSource:(CGImageSourceRef)source size:(CGSize)size scale:(CGFloat)scale
+{
+	if(!source || CGImageSourceGetCount(source) == 0)
+		return nil;
+
+	NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+	CGSize imageSize = CGSizeMake([properties[(NSString *)kCGImagePropertyPixelWidth] doubleValue], [properties[(NSString *)kCGImagePropertyPixelHeight] doubleValue]);
+	CGFloat maxPixelSize = TUIImageLoadingMaxPixelSize(imageSize, size, scale);
+
+	NSMutableDictionary *options = [NSMutableDictionary dictionary];
+	options[(NSString *)kCGImageSourceShouldCacheImmediately] = @YES; // decode here, not on the first draw
+	options[(NSString *)kCGImageSourceCreateThumbnailWithTransform] = @YES;
+	options[(NSString *)kCGImageSourceCreateThumbnailFromImageAlways] = @YES;
+	if(maxPixelSize > 0) {
+		options[(NSString *)kCGImageSourceThumbnailMaxPixelSize] = @(maxPixelSize);
+	} else {
+		options[(NSString *)kCGImageSourceThumbnailMaxPixelSize] = @(MAX(imageSize.width, imageSize.height));
+	}
+
+	CGImageRef imageRef = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+	if(!imageRef)
+		return nil;
+
+	TUIImage *image = [self imageWithCGImage:imageRef scale:(maxPixelSize > 0 ? scale : 1.0)];
+	CGImageRelease(imageRef);
+	return image;
+}
+
++ (TUIImage *)imageWithData:(NSData *)data downsampledToSize:(CGSize)size scale:(CGFloat)scale
+{
+	if(!data)
+		return nil;
+
+	CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, (__bridge CFDictionaryRef)@{(NSString *)kCGImageSourceShouldCache: @NO});
+	TUIImage *image = [self _imageWithImageSource:source size:size scale:scale];
+	if(source)
+		CFRelease(source);
+	return image;
+}
+
++ (TUIImageLoadRequest *)_loadImageWithSourceBlock:(CGImageSourceRef(^)(void))sourceBlock size:(CGSize)size scale:(CGFloat)scale completion:(void(^)(TUIImage *image))completion
+{
+	TUIImageLoadRequest *request = [[TUIImageLoadRequest alloc] init];
+
+	// request and operation retain each other until the completion is delivered or the request is cancelled
+	NSBlockOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
+		if(request.cancelled)
+			return;
+
+		CGImageSourceRef source = sourceBlock();
+		TUIImage *image = [self _imageWithImageSource:source size:size scale:scale];
+		if(source)
+			CFRelease(source);
+
+		dispatch_async(dispatch_get_main_queue(), ^{
+			if(request.cancelled)
+				return;
+			request.operation = nil;
+			if(completion)
+				completion(image);
+		});
+	}];
+
+	request.operation = operation;
+	[[self _loadingQueue] addOperation:operation];
+	return request;
+}
+
++ (TUIImageLoadRequest *)loadImageWithData:(NSData *)data size:(CGSize)size scale:(CGFloat)scale completion:(void(^)(TUIImage *image))completion
+{
+	return [self _loadImageWithSourceBlock:^CGImageSourceRef{
+		return data ? CGImageSourceCreateWithData((__bridge CFDataRef)data, (__bridge CFDictionaryRef)@{(NSString *)kCGImageSourceShouldCache: @NO}) : NULL;
+	} size:size scale:scale completion:completion];
+}
+
++ (TUIImageLoadRequest *)loadImageWithContentsOfURL:(NSURL *)url size:(CGSize)size scale:(CGFloat)scale completion:(void(^)(TUIImage *image))completion
+{
+	return [self _loadImageWithSourceBlock:^CGImageSourceRef{
+		return url ? CGImageSourceCreateWithURL((__bridge CFURLRef)url, (__bridge CFDictionaryRef)@{(NSString *)kCGImageSourceShouldCache: @NO}) : NULL;
+	} size:size scale:scale completion:completion];
+}
+
+@end
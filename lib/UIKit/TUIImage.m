@@ -16,6 +16,7 @@
 
 #import "TUIImage.h"
 #import "TUICGAdditions.h"
+#import "TUIImageCache.h"
 #import "TUIView+Private.h"
 
 TUI_EXTERN_C_BEGIN
@@ -41,21 +42,20 @@ static CGImageRef TUICreateImageRefWithData(NSData *data)
 
 static CGImageRef TUICreateImageRefForURL(NSURL *url, BOOL shouldCache)
 {
-    static NSMutableDictionary *cache = nil;
-    if(!cache)
-        cache = [NSMutableDictionary new];
-
     if(url) {
-        CGImageRef image;
+        TUIImageCache *cache = [TUIImageCache sharedCache];
 
         // look up in cache
-        image = (__bridge CGImageRef)[cache objectForKey:url];
+        CGImageRef image = [cache copyImageForKey:url];
         if(image)
-            return CGImageRetain(image);
+            return image;
 
         image = TUICreateImageRefWithData([NSData dataWithContentsOfURL:url]);
-        if(image && shouldCache)
-            [cache setObject:(__bridge id)image forKey:url];
+        if(image && shouldCache) {
+            CGImageRef cachedImage = [cache copyImageByStoringImage:image forKey:url];
+            CGImageRelease(image);
+            image = cachedImage;
+        }
 
         return image;
     }
@@ -113,7 +113,7 @@ NSData *TUIImageJPEGRepresentation(TUIImage *image, CGFloat compressionQuality)
 
 TUI_EXTERN_C_END
 
-@interface TUIStretchableImage : TUIImage
+@interface TUIStretchableCGImage : TUIImage
 {
 	@public
 	NSInteger leftCapWidth;
@@ -370,7 +370,7 @@ TUI_EXTERN_C_END
 }
 - (TUIImage *)stretchableImageWithEdgeInsets:(TUIEdgeInsets)insets
 {
-    TUIStretchableImage *i = (TUIStretchableImage *)[TUIStretchableImage imageWithCGImage:[self CGImage] scale:self.scale];
+    TUIStretchableCGImage *i = (TUIStretchableCGImage *)[TUIStretchableCGImage imageWithCGImage:[self CGImage] scale:self.scale];
     
 	i->leftCapWidth = insets.left;
 	i->topCapHeight = insets.top;
@@ -403,7 +403,7 @@ TUI_EXTERN_C_END
 
 @end
 
-@implementation TUIStretchableImage
+@implementation TUIStretchableCGImage
 
 - (NSInteger)leftCapWidth
 {
@@ -0,0 +1,76 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ A thread-safe cache of decoded CGImages, bounded by the number of bytes the decoded bitmaps take.
+
+ The least recently used images are evicted first, when the total cost goes over the limit and when the system reports memory pressure.  It is safe to use from the background queues that views with drawInBackground draw on.
+ */
+@interface TUIImageCache : NSObject
+
+/**
+ The cache used by +[TUIImage imageNamed:].
+ */
++ (instancetype)sharedCache;
+
+/**
+ Maximum total cost in bytes, 0 means unlimited.  The shared cache defaults to 64 MB.
+ */
+@property (nonatomic, assign) NSUInteger totalCostLimit;
+
+/**
+ When YES (the default), images are drawn into a bitmap when they are inserted, so the first draw doesn't pay for decoding.
+ */
+@property (nonatomic, assign) BOOL decompressesImages;
+
+/**
+ Returns the cached image retained, or NULL.
+ */
+- (CGImageRef)copyImageForKey:(id<NSCopying>)key CF_RETURNS_RETAINED;
+
+/**
+ Inserts @p image, decompressing it first if decompressesImages is set, and returns the image actually stored, retained.  Images bigger than the whole cost limit are not stored but are still returned.
+ */
+- (CGImageRef)copyImageByStoringImage:(CGImageRef)image forKey:(id<NSCopying>)key CF_RETURNS_RETAINED;
+
+- (void)removeImageForKey:(id<NSCopying>)key;
+- (void)removeAllImages;
+
+/**
+ Number of bytes held by the cached bitmaps.
+ */
+@property (nonatomic, readonly) NSUInteger totalCost;
+@property (nonatomic, readonly) NSUInteger count;
+
+// statistics
+@property (nonatomic, readonly) NSUInteger hitCount;
+@property (nonatomic, readonly) NSUInteger missCount;
+@property (nonatomic, readonly) NSUInteger evictionCount; // images dropped for the cost limit or memory pressure
+
+- (void)resetStatistics;
+
+@end
+
+TUI_EXTERN_C_BEGIN
+
+/**
+ Returns a copy of @p image backed by a plain bitmap, or @p image itself, retained, if it can't be redrawn.
+ */
+CGImageRef TUICreateDecompressedImage(CGImageRef image);
+
+TUI_EXTERN_C_END
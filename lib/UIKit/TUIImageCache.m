@@ -0,0 +1,358 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIImageCache.h"
+#import "TUICGAdditions.h"
+#import <pthread.h>
+
+TUI_EXTERN_C_BEGIN
+
+CGImageRef TUICreateDecompressedImage(CGImageRef image)
+{
+	if(!image)
+		return NULL;
+
+	size_t width = CGImageGetWidth(image);
+	size_t height = CGImageGetHeight(image);
+	if(width == 0 || height == 0)
+		return CGImageRetain(image);
+
+	CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(image);
+	BOOL opaque = (alphaInfo == kCGImageAlphaNone || alphaInfo == kCGImageAlphaNoneSkipFirst || alphaInfo == kCGImageAlphaNoneSkipLast);
+
+	CGContextRef ctx = TUICreateGraphicsContextWithOptions(CGSizeMake(width, height), opaque);
+	if(!ctx)
+		return CGImageRetain(image);
+
+	CGContextDrawImage(ctx, CGRectMake(0, 0, width, height), image);
+	CGImageRef decompressed = CGBitmapContextCreateImage(ctx);
+	CGContextRelease(ctx);
+
+	return decompressed ? decompressed : CGImageRetain(image);
+}
+
+TUI_EXTERN_C_END
+
+static NSUInteger TUIImageCacheCostForImage(CGImageRef image)
+{
+	return CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+}
+
+@interface TUIImageCacheEntry : NSObject
+{
+	@public
+	id<NSCopying> key;
+	CGImageRef image;
+	NSUInteger cost;
+	__unsafe_unretained TUIImageCacheEntry *previous; // more recently used
+	__unsafe_unretained TUIImageCacheEntry *next;     // less recently used
+}
+@end
+
+@implementation TUIImageCacheEntry
+
+- (void)dealloc
+{
+	CGImageRelease(image);
+}
+
+@end
+
+@implementation TUIImageCache
+{
+	pthread_mutex_t _lock;
+	NSMutableDictionary *_entries; // key -> entry, owns every entry
+	__unsafe_unretained TUIImageCacheEntry *_head;
+	__unsafe_unretained TUIImageCacheEntry *_tail;
+	dispatch_source_t _memoryPressureSource;
+
+	NSUInteger _totalCostLimit;
+	BOOL _decompressesImages;
+	NSUInteger _totalCost;
+	NSUInteger _hitCount;
+	NSUInteger _missCount;
+	NSUInteger _evictionCount;
+}
+
++ (instancetype)sharedCache
+{
+	static TUIImageCache *cache = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		cache = [[TUIImageCache alloc] init];
+		cache.totalCostLimit = 64 * 1024 * 1024;
+	});
+	return cache;
+}
+
+- (instancetype)init
+{
+	if((self = [super init])) {
+		pthread_mutex_init(&_lock, NULL);
+		_entries = [[NSMutableDictionary alloc] init];
+		_decompressesImages = YES;
+
+		__weak TUIImageCache *weakSelf = self;
+		_memoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+		dispatch_source_set_event_handler(_memoryPressureSource, ^{
+			TUIImageCache *strongSelf = weakSelf;
+			if(!strongSelf)
+				return;
+			unsigned long pressure = dispatch_source_get_data(strongSelf->_memoryPressureSource);
+			[strongSelf _handleMemoryPressure:pressure];
+		});
+		dispatch_resume(_memoryPressureSource);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	dispatch_source_cancel(_memoryPressureSource);
+	pthread_mutex_destroy(&_lock);
+}
+
+#pragma mark - LRU list, call with _lock held
+
+- (void)_unlinkEntry:(TUIImageCacheEntry *)entry
+{
+	if(entry->previous)
+		entry->previous->next = entry->next;
+	else
+		_head = entry->next;
+
+	if(entry->next)
+		entry->next->previous = entry->previous;
+	else
+		_tail = entry->previous;
+
+	entry->previous = nil;
+	entry->next = nil;
+}
+
+- (void)_linkEntryAtHead:(TUIImageCacheEntry *)entry
+{
+	entry->next = _head;
+	if(_head)
+		_head->previous = entry;
+	_head = entry;
+	if(!_tail)
+		_tail = entry;
+}
+
+- (void)_removeEntry:(TUIImageCacheEntry *)entry
+{
+	id key = entry->key; // the dictionary holds the last reference to entry
+	[self _unlinkEntry:entry];
+	_totalCost -= entry->cost;
+	[_entries removeObjectForKey:key];
+}
+
+- (void)_trimToCost:(NSUInteger)cost
+{
+	while(_totalCost > cost && _tail) {
+		[self _removeEntry:_tail];
+		_evictionCount++;
+	}
+}
+
+#pragma mark - Memory Pressure
+
+- (void)_handleMemoryPressure:(unsigned long)pressure
+{
+	pthread_mutex_lock(&_lock);
+	if(pressure & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+		[self _trimToCost:0];
+	} else {
+		[self _trimToCost:_totalCost / 2];
+	}
+	pthread_mutex_unlock(&_lock);
+}
+
+#pragma mark - Access
+
+- (CGImageRef)copyImageForKey:(id<NSCopying>)key
+{
+	if(!key)
+		return NULL;
+
+	CGImageRef image = NULL;
+
+	pthread_mutex_lock(&_lock);
+	TUIImageCacheEntry *entry = _entries[key];
+	if(entry) {
+		if(entry != _head) {
+			[self _unlinkEntry:entry];
+			[self _linkEntryAtHead:entry];
+		}
+		image = CGImageRetain(entry->image);
+		_hitCount++;
+	} else {
+		_missCount++;
+	}
+	pthread_mutex_unlock(&_lock);
+
+	return image;
+}
+
+- (CGImageRef)copyImageByStoringImage:(CGImageRef)image forKey:(id<NSCopying>)key
+{
+	if(!image)
+		return NULL;
+	if(!key)
+		return CGImageRetain(image);
+
+	// decoding is the slow part, keep it outside the lock
+	CGImageRef storedImage = self.decompressesImages ? TUICreateDecompressedImage(image) : CGImageRetain(image);
+
+	TUIImageCacheEntry *entry = [[TUIImageCacheEntry alloc] init];
+	entry->key = [(id)key copy];
+	entry->image = CGImageRetain(storedImage);
+	entry->cost = TUIImageCacheCostForImage(storedImage);
+
+	pthread_mutex_lock(&_lock);
+	TUIImageCacheEntry *existingEntry = _entries[entry->key];
+	if(existingEntry)
+		[self _removeEntry:existingEntry];
+
+	if(_totalCostLimit == 0 || entry->cost <= _totalCostLimit) {
+		_entries[entry->key] = entry;
+		[self _linkEntryAtHead:entry];
+		_totalCost += entry->cost;
+		if(_totalCostLimit > 0)
+			[self _trimToCost:_totalCostLimit];
+	}
+	pthread_mutex_unlock(&_lock);
+
+	return storedImage;
+}
+
+- (void)removeImageForKey:(id<NSCopying>)key
+{
+	if(!key)
+		return;
+
+	pthread_mutex_lock(&_lock);
+	TUIImageCacheEntry *entry = _entries[key];
+	if(entry)
+		[self _removeEntry:entry];
+	pthread_mutex_unlock(&_lock);
+}
+
+- (void)removeAllImages
+{
+	pthread_mutex_lock(&_lock);
+	_head = nil;
+	_tail = nil;
+	_totalCost = 0;
+	[_entries removeAllObjects];
+	pthread_mutex_unlock(&_lock);
+}
+
+#pragma mark - Properties
+
+- (NSUInteger)totalCostLimit
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger limit = _totalCostLimit;
+	pthread_mutex_unlock(&_lock);
+	return limit;
+}
+
+- (void)setTotalCostLimit:(NSUInteger)totalCostLimit
+{
+	pthread_mutex_lock(&_lock);
+	_totalCostLimit = totalCostLimit;
+	if(_totalCostLimit > 0)
+		[self _trimToCost:_totalCostLimit];
+	pthread_mutex_unlock(&_lock);
+}
+
+- (BOOL)decompressesImages
+{
+	pthread_mutex_lock(&_lock);
+	BOOL decompresses = _decompressesImages;
+	pthread_mutex_unlock(&_lock);
+	return decompresses;
+}
+
+- (void)setDecompressesImages:(BOOL)decompressesImages
+{
+	pthread_mutex_lock(&_lock);
+	_decompressesImages = decompressesImages;
+	pthread_mutex_unlock(&_lock);
+}
+
+- (NSUInteger)totalCost
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger cost = _totalCost;
+	pthread_mutex_unlock(&_lock);
+	return cost;
+}
+
+- (NSUInteger)count
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger count = _entries.count;
+	pthread_mutex_unlock(&_lock);
+	return count;
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)hitCount
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger hits = _hitCount;
+	pthread_mutex_unlock(&_lock);
+	return hits;
+}
+
+- (NSUInteger)missCount
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger misses = _missCount;
+	pthread_mutex_unlock(&_lock);
+	return misses;
+}
+
+- (NSUInteger)evictionCount
+{
+	pthread_mutex_lock(&_lock);
+	NSUInteger evictions = _evictionCount;
+	pthread_mutex_unlock(&_lock);
+	return evictions;
+}
+
+- (void)resetStatistics
+{
+	pthread_mutex_lock(&_lock);
+	_hitCount = 0;
+	_missCount = 0;
+	_evictionCount = 0;
+	pthread_mutex_unlock(&_lock);
+}
+
+- (NSString *)description
+{
+	pthread_mutex_lock(&_lock);
+	NSString *description = [NSString stringWithFormat:@"<%@: %p count=%lu cost=%lu/%lu hits=%lu misses=%lu evicted=%lu>", [self class], self, (unsigned long)_entries.count, (unsigned long)_totalCost, (unsigned long)_totalCostLimit, (unsigned long)_hitCount, (unsigned long)_missCount, (unsigned long)_evictionCount];
+	pthread_mutex_unlock(&_lock);
+	return description;
+}
+
+@end
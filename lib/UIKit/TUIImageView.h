@@ -17,14 +17,23 @@
 #import "TUIView.h"
 
 @class TUIImage;
+@class TUIImageLoadRequest;
 
 @interface TUIImageView : TUIView
 {
 	TUIImage *_image;
+	TUIImageLoadRequest *_loadRequest;
 }
 
 - (instancetype)initWithImage:(TUIImage *)image;
 
-@property(nonatomic,strong) TUIImage *image;
+@property(nonatomic,strong) TUIImage *image; // setting it cancels a pending load
+
+/**
+ Shows @p placeholder, then decodes the image on a background queue at the view's current size and backing scale and shows it.  A later load or -setImage: cancels the pending one, so a reused cell never shows a stale image.
+ */
+- (void)loadImageWithContentsOfURL:(NSURL *)url placeholder:(TUIImage *)placeholder;
+- (void)loadImageWithData:(NSData *)data placeholder:(TUIImage *)placeholder;
+- (void)cancelImageLoad;
 
 @end
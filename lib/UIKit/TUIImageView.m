@@ -16,6 +16,7 @@
 
 #import "TUIImageView.h"
 #import "TUIImage.h"
+#import "TUIImage+Loading.h"
 
 @implementation TUIImageView
 
@@ -45,10 +46,56 @@
 
 - (void)setImage:(TUIImage *)i
 {
+	[self cancelImageLoad];
 	_image = i;
 	[self setNeedsDisplay];
 }
 
+- (void)cancelImageLoad
+{
+	[_loadRequest cancel];
+	_loadRequest = nil;
+}
+
+- (CGFloat)_imageLoadScale
+{
+	return [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
+}
+
+- (void)_finishImageLoadWithImage:(TUIImage *)image
+{
+	_loadRequest = nil;
+	if(image) {
+		_image = image;
+		[self setNeedsDisplay];
+	}
+}
+
+- (void)loadImageWithContentsOfURL:(NSURL *)url placeholder:(TUIImage *)placeholder
+{
+	self.image = placeholder;
+
+	__weak TUIImageView *weakSelf = self;
+	_loadRequest = [TUIImage loadImageWithContentsOfURL:url size:self.bounds.size scale:[self _imageLoadScale] completion:^(TUIImage *image) {
+		[weakSelf _finishImageLoadWithImage:image];
+	}];
+}
+
+- (void)loadImageWithData:(NSData *)data placeholder:(TUIImage *)placeholder
+{
+	self.image = placeholder;
+
+	__weak TUIImageView *weakSelf = self;
+	_loadRequest = [TUIImage loadImageWithData:data size:self.bounds.size scale:[self _imageLoadScale] completion:^(TUIImage *image) {
+		[weakSelf _finishImageLoadWithImage:image];
+	}];
+}
+
+- (void)dealloc
+{
+	[_loadRequest cancel];
+}
+
 - (void)drawRect:(CGRect)rect
 {
 	[super drawRect:rect];
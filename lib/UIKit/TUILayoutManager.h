@@ -57,10 +57,42 @@
 - (NSString *)layoutNameForView:(TUIView *)view;
 - (void)setLayoutName:(NSString *)name forView:(TUIView *)view;
 
+/*
+ 
+ Returns the first subview of a view carrying the given layout name. Names
+ and the constraint dependencies among subviews are kept in a graph per
+ superview, which TUIView invalidates through -subviewsDidChangeInView:
+ whenever it gains or loses a subview.
+ 
+ */
+- (TUIView *)subviewNamed:(NSString *)name inView:(TUIView *)superview;
+- (void)subviewsDidChangeInView:(TUIView *)view;
+
 /*
  Similar to -redraw on a TUIView, but for constraints. Forces a re-processing
  of all constraints attached to a view.
  */
 - (void)beginProcessingView:(TUIView *)aView;
 
+/*
+ 
+ Deferred layout. While deferring, -beginProcessingView: only marks the
+ view as needing layout; marked views are resolved together in a single
+ pass, at the latest before timers fire on the next run loop turn. Set
+ defersLayout to defer permanently, or wrap a batch of constraint changes
+ in -beginDeferringLayout and -endDeferringLayout, which nest, and resolve
+ the batch when the outermost call ends. -layoutIfNeeded resolves any
+ pending views immediately.
+ 
+ numberOfAvoidedPasses counts the passes that were skipped because a view
+ was already pending, or had already been settled earlier in the pass.
+ 
+ */
+@property (nonatomic, assign) BOOL defersLayout;
+@property (nonatomic, assign, readonly) NSUInteger numberOfAvoidedPasses;
+
+- (void)beginDeferringLayout;
+- (void)endDeferringLayout;
+- (void)layoutIfNeeded;
+
 @end
@@ -1,4 +1,5 @@
 #import <objc/runtime.h>
+#import "TUIAnimationManager.h"
 #import "TUILayoutConstraint.h"
 #import "TUILayoutManager.h"
 #import "TUIView+Layout.h"
@@ -38,22 +39,140 @@
 
 @end
 
+/*
+ 
+ A constraint on a target view, filed under the view it reads from.
+ 
+ */
+@interface TUILayoutDependency : NSObject
+
+@property (nonatomic, weak) TUIView *target;
+@property (nonatomic, strong) TUILayoutConstraint *constraint;
+
+@end
+
+@implementation TUILayoutDependency
+@end
+
+/*
+ 
+ The constraint graph among the subviews of one view. Names resolve to
+ the first subview carrying them, and every source view (a named subview,
+ or the superview itself for "superview" constraints) maps to the
+ constraints that read from it. Adding or removing a constraint updates
+ the graph in place; a change to the subviews or their names only marks
+ it invalid, and it is rebuilt the next time it is needed.
+ 
+ */
+@interface TUILayoutGraph : NSObject
+
+@property (nonatomic, strong, readonly) NSMapTable *viewsByName;
+@property (nonatomic, strong, readonly) NSMapTable *dependents;
+@property (nonatomic, assign, getter = isValid) BOOL valid;
+
+- (void)rebuildWithSuperview:(TUIView *)superview constraints:(NSMapTable *)constraints;
+- (void)addConstraint:(TUILayoutConstraint *)constraint toView:(TUIView *)view;
+- (void)removeConstraint:(TUILayoutConstraint *)constraint fromView:(TUIView *)view;
+
+@end
+
+@implementation TUILayoutGraph
+
+@synthesize viewsByName = _viewsByName;
+@synthesize dependents = _dependents;
+@synthesize valid = _valid;
+
+- (instancetype)init {
+	if((self = [super init])) {
+		_viewsByName = [NSMapTable strongToWeakObjectsMapTable];
+		_dependents = [NSMapTable weakToStrongObjectsMapTable];
+	}
+	return self;
+}
+
+- (TUIView *)sourceOfConstraint:(TUILayoutConstraint *)constraint onView:(TUIView *)view {
+	NSString *sourceName = [constraint sourceName];
+	if(sourceName == nil) return nil;
+	
+	TUIView *source = [sourceName isEqual:@"superview"] ? [view superview] : [self.viewsByName objectForKey:sourceName];
+	return (source == view ? nil : source);
+}
+
+- (void)rebuildWithSuperview:(TUIView *)superview constraints:(NSMapTable *)constraints {
+	[self.viewsByName removeAllObjects];
+	[self.dependents removeAllObjects];
+	
+	NSArray *subviews = [superview subviews];
+	for(TUIView *subview in subviews) {
+		NSString *name = [(TUILayoutContainer *)[constraints objectForKey:subview] layoutName];
+		if(name != nil && [self.viewsByName objectForKey:name] == nil)
+			[self.viewsByName setObject:subview forKey:name];
+	}
+	
+	for(TUIView *subview in subviews) {
+		for(TUILayoutConstraint *constraint in [(TUILayoutContainer *)[constraints objectForKey:subview] layoutConstraints])
+			[self addConstraint:constraint toView:subview];
+	}
+	
+	self.valid = YES;
+}
+
+- (void)addConstraint:(TUILayoutConstraint *)constraint toView:(TUIView *)view {
+	TUIView *source = [self sourceOfConstraint:constraint onView:view];
+	if(source == nil) return;
+	
+	NSMutableArray *dependencies = [self.dependents objectForKey:source];
+	if(dependencies == nil) {
+		dependencies = [[NSMutableArray alloc] init];
+		[self.dependents setObject:dependencies forKey:source];
+	}
+	
+	TUILayoutDependency *dependency = [[TUILayoutDependency alloc] init];
+	dependency.target = view;
+	dependency.constraint = constraint;
+	[dependencies addObject:dependency];
+}
+
+- (void)removeConstraint:(TUILayoutConstraint *)constraint fromView:(TUIView *)view {
+	TUIView *source = [self sourceOfConstraint:constraint onView:view];
+	if(source == nil) return;
+	
+	NSMutableArray *dependencies = [self.dependents objectForKey:source];
+	[dependencies removeObjectsAtIndexes:[dependencies indexesOfObjectsPassingTest:^BOOL(TUILayoutDependency *dependency, NSUInteger idx, BOOL *stop) {
+		return dependency.target == view && dependency.constraint == constraint;
+	}]];
+}
+
+@end
+
 @interface TUILayoutManager ()
 
 @property (nonatomic, assign, getter = isProcessingChanges) BOOL processingChanges;
 
 @property (nonatomic, strong) NSMapTable *constraints;
-@property (nonatomic, strong) NSMutableArray *viewsToProcess;
+@property (nonatomic, strong) NSMapTable *graphs;
+@property (nonatomic, strong) NSMutableOrderedSet *viewsToProcess;
 @property (nonatomic, strong) NSMutableSet *processedViews;
 
+@property (nonatomic, assign) NSUInteger deferralCount;
+@property (nonatomic, assign, getter = isFlushScheduled) BOOL flushScheduled;
+@property (nonatomic, strong) NSMutableOrderedSet *viewsNeedingLayout;
+@property (nonatomic, assign, readwrite) NSUInteger numberOfAvoidedPasses;
+
 @end
 
 @implementation TUILayoutManager
 
 @synthesize processingChanges = _processingChanges;
 @synthesize constraints = _constraints;
+@synthesize graphs = _graphs;
 @synthesize viewsToProcess = _viewsToProcess;
 @synthesize processedViews = _processedViews;
+@synthesize defersLayout = _defersLayout;
+@synthesize deferralCount = _deferralCount;
+@synthesize flushScheduled = _flushScheduled;
+@synthesize viewsNeedingLayout = _viewsNeedingLayout;
+@synthesize numberOfAvoidedPasses = _numberOfAvoidedPasses;
 
 + (instancetype)sharedLayoutManager {
 	static TUILayoutManager *_sharedLayoutManager = nil;
@@ -71,8 +190,10 @@
 		_processingChanges = NO;
 		
 		_constraints = [NSMapTable weakToStrongObjectsMapTable];
-		_viewsToProcess = [[NSMutableArray alloc] init];
+		_graphs = [NSMapTable weakToStrongObjectsMapTable];
+		_viewsToProcess = [[NSMutableOrderedSet alloc] init];
 		_processedViews = [[NSMutableSet alloc] init];
+		_viewsNeedingLayout = [[NSMutableOrderedSet alloc] init];
 	}
 	return self;
 }
@@ -83,60 +204,126 @@
 
 - (void)removeAllLayoutConstraints {
 	[self.constraints removeAllObjects];
+	[self.graphs removeAllObjects];
 }
 
-- (void)processView:(TUIView *)aView {
-	[self.processedViews addObject:aView];
+#pragma mark - Dependency Graph
+
+- (TUILayoutGraph *)graphForSuperview:(TUIView *)superview {
+	if(superview == nil) return nil;
 	
-	NSArray *viewConstraints = [self layoutConstraintsOnView:aView];
-	for(TUILayoutConstraint * constraint in viewConstraints)
-		[constraint applyToTargetView:aView];
+	TUILayoutGraph *graph = [self.graphs objectForKey:superview];
+	if(graph == nil) {
+		graph = [[TUILayoutGraph alloc] init];
+		[self.graphs setObject:graph forKey:superview];
+	}
+	if(graph.valid == NO)
+		[graph rebuildWithSuperview:superview constraints:self.constraints];
+	return graph;
+}
+
+// a graph that has not been built yet picks the change up when it is
+- (TUILayoutGraph *)validGraphForSuperview:(TUIView *)superview {
+	if(superview == nil) return nil;
 	
-	// Order of Operations:
-	// 1.  Siblings with constraints to this view.
-	// 2.  Children with constraints to superview.
+	TUILayoutGraph *graph = [self.graphs objectForKey:superview];
+	return (graph.valid ? graph : nil);
+}
+
+- (void)subviewsDidChangeInView:(TUIView *)view {
+	if(view != nil)
+		[[self.graphs objectForKey:view] setValid:NO];
+}
+
+- (TUIView *)subviewNamed:(NSString *)name inView:(TUIView *)superview {
+	if(name == nil) return nil;
+	return [[[self graphForSuperview:superview] viewsByName] objectForKey:name];
+}
+
+// siblings reading from the view by name, then subviews reading from "superview"
+- (void)enumerateDependenciesOfView:(TUIView *)view usingBlock:(void (^)(TUILayoutDependency *dependency))block {
+	for(TUILayoutDependency *dependency in [[[self graphForSuperview:[view superview]] dependents] objectForKey:view])
+		block(dependency);
+	for(TUILayoutDependency *dependency in [[[self graphForSuperview:view] dependents] objectForKey:view])
+		block(dependency);
+}
+
+/*
+ 
+ Applies the constraints on a view, then on everything that depends on
+ it, directly or transitively, in topological order. Every view is laid
+ out once, by re-applying all of its constraints in the order they were
+ added, so a later constraint still wins over an earlier one. Views caught
+ in a cycle are laid out once, in discovery order.
+ 
+ */
+- (void)processView:(TUIView *)aView {
+	// collect the affected views, counting for each the edges coming from other affected views
+	NSMutableOrderedSet *affectedViews = [NSMutableOrderedSet orderedSetWithObject:aView];
+	NSMapTable *remainingSources = [NSMapTable strongToStrongObjectsMapTable];
 	
-	if([self layoutNameForView:aView] != nil) {
-		NSArray *siblings = [[aView superview] subviews];
-		for(TUIView *subview in siblings) {
-			if(subview == aView) continue;
+	for(NSUInteger i = 0; i < [affectedViews count]; i++) {
+		[self enumerateDependenciesOfView:[affectedViews objectAtIndex:i] usingBlock:^(TUILayoutDependency *dependency) {
+			TUIView *target = dependency.target;
+			if(target == nil || target == aView) return;
 			
-			NSArray *subviewConstraints = [self layoutConstraintsOnView:subview];
-			for(TUILayoutConstraint *subviewConstraint in subviewConstraints) {
-				TUIView *sourceView = [subview relativeViewForName:[subviewConstraint sourceName]];
-				if(sourceView == aView)
-					[subviewConstraint applyToTargetView:subview sourceView:sourceView];
-			}
-		}
+			[affectedViews addObject:target];
+			NSUInteger remaining = [[remainingSources objectForKey:target] unsignedIntegerValue];
+			[remainingSources setObject:@(remaining + 1) forKey:target];
+		}];
 	}
 	
-	NSArray *subviews = [aView subviews];
-	for(TUIView *subview in subviews) {
-		NSArray *subviewConstraints = [self layoutConstraintsOnView:subview];
-		for(TUILayoutConstraint *subviewConstraint in subviewConstraints) {
-			TUIView *sourceView = [subview relativeViewForName:[subviewConstraint sourceName]];
-			if(sourceView == aView)
-				[subviewConstraint applyToTargetView:subview sourceView:sourceView];
+	NSMutableArray *ready = [NSMutableArray arrayWithObject:aView];
+	NSMutableSet *applied = [NSMutableSet setWithCapacity:[affectedViews count]];
+	NSUInteger nextUnapplied = 0;
+	
+	while([applied count] < [affectedViews count]) {
+		TUIView *view = [ready lastObject];
+		if(view != nil) {
+			[ready removeLastObject];
+		} else {
+			// only a cycle is left, break it at the earliest discovered view
+			while([applied containsObject:[affectedViews objectAtIndex:nextUnapplied]])
+				nextUnapplied++;
+			view = [affectedViews objectAtIndex:nextUnapplied];
 		}
+		if([applied containsObject:view]) continue;
+		[applied addObject:view];
+		[self.processedViews addObject:view];
+		
+		for(TUILayoutConstraint *constraint in [(TUILayoutContainer *)[self.constraints objectForKey:view] layoutConstraints])
+			[constraint applyToTargetView:view];
+		
+		[self enumerateDependenciesOfView:view usingBlock:^(TUILayoutDependency *dependency) {
+			TUIView *target = dependency.target;
+			if(target == nil || target == aView || [applied containsObject:target]) return;
+			
+			NSUInteger remaining = [[remainingSources objectForKey:target] unsignedIntegerValue];
+			if(remaining > 0) remaining--;
+			[remainingSources setObject:@(remaining) forKey:target];
+			if(remaining == 0)
+				[ready addObject:target];
+		}];
 	}
 }
 
-- (void)beginProcessingView:(TUIView *)view {
-    if (!view) {
-        return;
-    }
-    
+- (void)processViews:(NSOrderedSet *)views {
 	if(self.processingChanges == NO) {
 		self.processingChanges = YES;
 		
 		@autoreleasepool {
-			[self.viewsToProcess addObject:view];
+			[self.viewsToProcess unionOrderedSet:views];
 			
 			while([self.viewsToProcess count] > 0) {
-				TUIView *currentView = [self.viewsToProcess objectAtIndex:0];
-				[self.viewsToProcess removeObjectAtIndex:0];			
-				if([self.viewsToProcess containsObject:currentView] == NO)
-					[self processView:currentView];
+				TUIView *currentView = [self.viewsToProcess firstObject];
+				[self.viewsToProcess removeObjectAtIndex:0];
+				
+				// already settled as a dependent of an earlier view in this pass
+				if([self.processedViews containsObject:currentView]) {
+					self.numberOfAvoidedPasses++;
+					continue;
+				}
+				[self processView:currentView];
 			}
 			
 			[self.viewsToProcess removeAllObjects];
@@ -145,11 +332,71 @@
 		
 		self.processingChanges = NO;
 	} else {
-		if([self.processedViews containsObject:view] == NO)
-			[self.viewsToProcess addObject:view];
+		for(TUIView *view in views) {
+			if([self.processedViews containsObject:view] == NO)
+				[self.viewsToProcess addObject:view];
+		}
 	}
 }
 
+- (void)beginProcessingView:(TUIView *)view {
+    if (!view) {
+        return;
+    }
+    
+	if(self.defersLayout || self.deferralCount > 0) {
+		if([self.viewsNeedingLayout containsObject:view])
+			self.numberOfAvoidedPasses++;
+		else
+			[self.viewsNeedingLayout addObject:view];
+		
+		[self scheduleLayoutFlush];
+	} else {
+		[self processViews:[NSOrderedSet orderedSetWithObject:view]];
+	}
+}
+
+#pragma mark - Deferred Layout
+
+- (void)scheduleLayoutFlush {
+	if(self.flushScheduled) return;
+	self.flushScheduled = YES;
+	
+	__weak TUILayoutManager *weakSelf = self;
+	[[TUIAnimationManager defaultManager] performBlockBeforeTimers:^{
+		TUILayoutManager *strongSelf = weakSelf;
+		strongSelf.flushScheduled = NO;
+		[strongSelf layoutIfNeeded];
+	}];
+}
+
+- (void)setDefersLayout:(BOOL)defersLayout {
+	_defersLayout = defersLayout;
+	if(defersLayout == NO && self.deferralCount == 0)
+		[self layoutIfNeeded];
+}
+
+- (void)beginDeferringLayout {
+	self.deferralCount++;
+}
+
+- (void)endDeferringLayout {
+	NSAssert(self.deferralCount > 0, @"-endDeferringLayout called without a matching -beginDeferringLayout");
+	if(self.deferralCount == 0) return;
+	
+	self.deferralCount--;
+	if(self.deferralCount == 0 && self.defersLayout == NO)
+		[self layoutIfNeeded];
+}
+
+- (void)layoutIfNeeded {
+	if([self.viewsNeedingLayout count] == 0) return;
+	
+	NSOrderedSet *views = [self.viewsNeedingLayout copy];
+	[self.viewsNeedingLayout removeAllObjects];
+	[self processViews:views];
+}
+
 - (void)addLayoutConstraint:(TUILayoutConstraint *)constraint toView:(TUIView *)view {
 	TUILayoutContainer *viewContainer = [self.constraints objectForKey:view];
 	if(viewContainer == nil) {
@@ -158,6 +405,7 @@
 	}
 	
 	[[viewContainer layoutConstraints] addObject:constraint];
+	[[self validGraphForSuperview:[view superview]] addConstraint:constraint toView:view];
 	[self beginProcessingView:view];
 }
 
@@ -168,11 +416,21 @@
     }
 
     [[viewContainer layoutConstraints] removeObject:constraint];
+    [[self validGraphForSuperview:[view superview]] removeConstraint:constraint fromView:view];
     [self beginProcessingView:view];
 }
 
 - (void)removeLayoutConstraintsFromView:(TUIView *)view {
 	TUILayoutContainer *viewContainer = [self.constraints objectForKey:view];
+	if([viewContainer layoutName] != nil) {
+		// the name goes with the container
+		[self subviewsDidChangeInView:[view superview]];
+	} else {
+		TUILayoutGraph *graph = [self validGraphForSuperview:[view superview]];
+		for(TUILayoutConstraint *constraint in [viewContainer layoutConstraints])
+			[graph removeConstraint:constraint fromView:view];
+	}
+	
 	[[viewContainer layoutConstraints] removeAllObjects];
 	[self.constraints removeObjectForKey:view];
 }
@@ -191,6 +449,7 @@
 
 - (void)setLayoutName:(NSString *)name forView:(TUIView *)view {
 	TUILayoutContainer *viewContainer = [self.constraints objectForKey:view];
+	[self subviewsDidChangeInView:[view superview]];
 	
 	if(name == nil && [[viewContainer layoutConstraints] count] == 0)
 		[self.constraints removeObjectForKey:view];
@@ -48,6 +48,35 @@ typedef enum {
 
 @class TUIScrollKnob;
 
+/**
+ Scroll animation physics, as pure functions so they can be stepped without a view or a display link.
+
+ Rates are given per 1/60 s frame, the way decelerationRate always was. Every step is solved exactly over @p dt seconds, so 60 Hz, 120 Hz and coalesced ticks all reach the same state at the same time.
+ */
+typedef struct TUIScrollPhysicsState {
+	CGPoint position;
+	CGPoint velocity; // points per second
+} TUIScrollPhysicsState;
+
+TUI_EXTERN_C_BEGIN
+
+/** Free throw: decays velocity so that a throw travels as far as it did with the per-tick decay by @p decelerationRate at 60 Hz. */
+TUIScrollPhysicsState TUIScrollPhysicsDecelerate(TUIScrollPhysicsState state, CGFloat decelerationRate, NSTimeInterval dt);
+
+/** Animated scroll: the remaining distance to @p destination shrinks by @p decelerationRate per 1/60 s. */
+CGPoint TUIScrollPhysicsApproach(CGPoint position, CGPoint destination, CGFloat decelerationRate, NSTimeInterval dt);
+
+/** YES once the next 1/60 s approach step would move less than 0.1pt on both axes. */
+BOOL TUIScrollPhysicsApproachIsFinished(CGPoint position, CGPoint destination, CGFloat decelerationRate);
+
+/** Rubber band: damped spring pulling position back to zero. */
+TUIScrollPhysicsState TUIScrollPhysicsSpring(TUIScrollPhysicsState state, NSTimeInterval dt);
+
+/** YES once both position and velocity are below @p threshold on both axes. */
+BOOL TUIScrollPhysicsIsSettled(TUIScrollPhysicsState state, CGFloat threshold);
+
+TUI_EXTERN_C_END
+
 /**
  
  Bouncing is enabled on [REDACTED]+ or if ForceEnableScrollBouncing defaults = YES
@@ -83,6 +112,7 @@ typedef enum {
   TUIScrollKnob * _horizontalScrollKnob;
 	
 	CVDisplayLinkRef displayLink;
+	volatile int32_t _tickScheduled; // set on the display link thread until the main thread runs the tick
 	CGPoint destinationOffset;
 	CGPoint unfixedContentOffset;
 	
@@ -164,7 +194,7 @@ typedef enum {
 @property (readonly, nonatomic) BOOL horizontalScrollIndicatorShowing;
 @property (nonatomic) TUIScrollViewIndicatorStyle scrollIndicatorStyle;
 @property (nonatomic) TUIEdgeInsets scrollIndicatorInsets; // only bottom and right available currently
-@property (nonatomic) float decelerationRate;
+@property (nonatomic) float decelerationRate; // per 1/60 s, independent of the display refresh rate
 
 - (void)setContentOffset:(CGPoint)contentOffset animated:(BOOL)animated;
 - (void)scrollRectToVisible:(CGRect)rect animated:(BOOL)animated;
@@ -26,6 +26,92 @@
 #define TUIScrollViewContinuousScrollDragBoundary 25.0
 #define TUIScrollViewContinuousScrollRate         10.0
 
+#define TUIScrollPhysicsReferenceFrameRate 60.0
+
+TUI_EXTERN_C_BEGIN
+
+TUIScrollPhysicsState TUIScrollPhysicsDecelerate(TUIScrollPhysicsState state, CGFloat decelerationRate, NSTimeInterval dt)
+{
+	if(dt <= 0)
+		return state;
+
+	if(decelerationRate >= 1.0) {
+		state.position.x += state.velocity.x * dt;
+		state.position.y += state.velocity.y * dt;
+		return state;
+	}
+	if(decelerationRate <= 0.0) {
+		state.velocity = CGPointZero;
+		return state;
+	}
+
+	// v(t) = v0 * e^(-lambda t), integrated exactly over dt. The per-tick
+	// decay (x += v / 60; v *= r) threw v0 / (60 (1 - r)) points in total;
+	// lambda = 60 (1 - r) keeps that distance rather than the per-tick factor
+	CGFloat lambda = (1.0 - decelerationRate) * TUIScrollPhysicsReferenceFrameRate;
+	CGFloat decay = exp(-lambda * dt);
+	CGFloat distance = (1.0 - decay) / lambda;
+
+	state.position.x += state.velocity.x * distance;
+	state.position.y += state.velocity.y * distance;
+	state.velocity.x *= decay;
+	state.velocity.y *= decay;
+	return state;
+}
+
+CGPoint TUIScrollPhysicsApproach(CGPoint position, CGPoint destination, CGFloat decelerationRate, NSTimeInterval dt)
+{
+	if(dt <= 0)
+		return position;
+
+	CGFloat remaining = pow(MAX(decelerationRate, 0.0), dt * TUIScrollPhysicsReferenceFrameRate);
+	position.x = destination.x + (position.x - destination.x) * remaining;
+	position.y = destination.y + (position.y - destination.y) * remaining;
+	return position;
+}
+
+BOOL TUIScrollPhysicsApproachIsFinished(CGPoint position, CGPoint destination, CGFloat decelerationRate)
+{
+	CGFloat stepFraction = 1.0 - decelerationRate;
+	return (fabs(destination.x - position.x) * stepFraction < 0.1) && (fabs(destination.y - position.y) * stepFraction < 0.1);
+}
+
+static void TUIScrollPhysicsSpringAxis(CGFloat *x, CGFloat *v, NSTimeInterval t)
+{
+	// x'' = -k x - c x', the per-tick spring (tightness 2.5, dampiness 0.35
+	// per 1/60 s) taken to its continuous limit; underdamped for these values
+	const CGFloat k = 2.5 * TUIScrollPhysicsReferenceFrameRate;
+	const CGFloat c = 0.35 * TUIScrollPhysicsReferenceFrameRate;
+	const CGFloat alpha = c / 2.0;
+	const CGFloat omega = sqrt(k - alpha * alpha);
+
+	CGFloat a = *x;
+	CGFloat b = (*v + alpha * a) / omega;
+	CGFloat decay = exp(-alpha * t);
+	CGFloat cosine = cos(omega * t);
+	CGFloat sine = sin(omega * t);
+
+	*x = decay * (a * cosine + b * sine);
+	*v = decay * ((b * omega - alpha * a) * cosine - (a * omega + alpha * b) * sine);
+}
+
+TUIScrollPhysicsState TUIScrollPhysicsSpring(TUIScrollPhysicsState state, NSTimeInterval dt)
+{
+	if(dt <= 0)
+		return state;
+
+	TUIScrollPhysicsSpringAxis(&state.position.x, &state.velocity.x, dt);
+	TUIScrollPhysicsSpringAxis(&state.position.y, &state.velocity.y, dt);
+	return state;
+}
+
+BOOL TUIScrollPhysicsIsSettled(TUIScrollPhysicsState state, CGFloat threshold)
+{
+	return fabs(state.position.x) < threshold && fabs(state.position.y) < threshold && fabs(state.velocity.x) < threshold && fabs(state.velocity.y) < threshold;
+}
+
+TUI_EXTERN_C_END
+
 enum {
 	ScrollPhaseNormal = 0,
 	ScrollPhaseThrowingBegan = 1,
@@ -315,13 +401,21 @@ enum {
 static CVReturn scrollCallback(CVDisplayLinkRef displayLink, const CVTimeStamp *now, const CVTimeStamp *outputTime, CVOptionFlags flagsIn, CVOptionFlags *flagsOut, void *displayLinkContext)
 {
 	@autoreleasepool {
-		// perform drawing on the main thread
+		// perform drawing on the main thread, at most one tick queued at a time
 		TUIScrollView *scrollView = (__bridge id)displayLinkContext;
-		[scrollView performSelectorOnMainThread:@selector(tick:) withObject:nil waitUntilDone:NO];
+		if(__sync_bool_compare_and_swap(&scrollView->_tickScheduled, 0, 1)) {
+			[scrollView performSelectorOnMainThread:@selector(_scheduledTick) withObject:nil waitUntilDone:NO];
+		}
 	}
 	return kCVReturnSuccess;
 }
 
+- (void)_scheduledTick
+{
+	__sync_lock_release(&_tickScheduled);
+	[self tick:nil];
+}
+
 - (void)_startDisplayLink:(int)scrollMode
 {
 	_scrollViewFlags.animationMode = scrollMode;
@@ -821,30 +915,16 @@ static float clampBounce(float x) {
 		CFAbsoluteTime t = CFAbsoluteTimeGetCurrent();
         double dt = t - _bounce.t;
 		
-		CGPoint F = CGPointZero;
-		
-		float tightness = 2.5f;
-		float dampiness = 0.35f;
-		
-		// spring
-		F.x = -_bounce.x * tightness;
-		F.y = -_bounce.y * tightness;
-		
-		// damper
-		if(fabsf(_bounce.x) > 0.0)
-			F.x -= _bounce.vx * dampiness;
-		if(fabsf(_bounce.y) > 0.0)
-			F.y -= _bounce.vy * dampiness;
-		
-		_bounce.vx += F.x; // mass=1
-		_bounce.vy += F.y;
-		
-		_bounce.x += _bounce.vx * dt;
-		_bounce.y += _bounce.vy * dt;
+		TUIScrollPhysicsState state = {{_bounce.x, _bounce.y}, {_bounce.vx, _bounce.vy}};
+		state = TUIScrollPhysicsSpring(state, dt);
+		_bounce.x = state.position.x;
+		_bounce.y = state.position.y;
+		_bounce.vx = state.velocity.x;
+		_bounce.vy = state.velocity.y;
 		
 		_bounce.t = t;
 		
-		if(fabsf(_bounce.vy) < 1.0 && fabsf(_bounce.y) < 1.0 && fabsf(_bounce.vx) < 1.0 && fabsf(_bounce.x) < 1.0) {
+		if(TUIScrollPhysicsIsSettled(state, 1.0)) {
 			[self _stopDisplayLink];
             [self _didEndDecelerating];
 		}
@@ -873,11 +953,11 @@ static float clampBounce(float x) {
 	switch(_scrollViewFlags.animationMode) {
 		case AnimationModeThrow: {
 			
-			CGPoint o = _unroundedContentOffset;
 			CFAbsoluteTime t = CFAbsoluteTimeGetCurrent();
             double dt = t - _throw.t;
-			o.x = o.x + _throw.vx * dt;
-			o.y = o.y - _throw.vy * dt;
+			TUIScrollPhysicsState state = {_unroundedContentOffset, {_throw.vx, -_throw.vy}};
+			state = TUIScrollPhysicsDecelerate(state, decelerationRate, dt);
+			CGPoint o = state.position;
 			
 			CGPoint fixedOffset = [self _fixProposedContentOffset:o];
 			if(!CGPointEqualToPoint(fixedOffset, o)) {
@@ -886,8 +966,8 @@ static float clampBounce(float x) {
 			
 			[self setContentOffset:o];
 			
-			_throw.vx *= decelerationRate;
-			_throw.vy *= decelerationRate;
+			_throw.vx = state.velocity.x;
+			_throw.vy = -state.velocity.y;
 			_throw.t = t;
 			
 			if(_throw.throwing && !self._pulling && !_bounce.bouncing) {
@@ -902,14 +982,15 @@ static float clampBounce(float x) {
 		}
 		case AnimationModeScrollTo: {
 			
-			CGPoint o = _unroundedContentOffset;
-			CGPoint lastOffset = o;
-			o.x = o.x * decelerationRate + destinationOffset.x * (1-decelerationRate);
-			o.y = o.y * decelerationRate + destinationOffset.y * (1-decelerationRate);
+			CFAbsoluteTime t = CFAbsoluteTimeGetCurrent();
+			double dt = t - _throw.t;
+			_throw.t = t;
+			
+			CGPoint o = TUIScrollPhysicsApproach(_unroundedContentOffset, destinationOffset, decelerationRate, dt);
 			o = [self _fixProposedContentOffset:o];
 			[self _setContentOffset:o];
 			
-			if((fabs(o.x - lastOffset.x) < 0.1) && (fabs(o.y - lastOffset.y) < 0.1)) {
+			if(TUIScrollPhysicsApproachIsFinished(o, destinationOffset, decelerationRate)) {
 				[self _stopDisplayLink];
 				[self setContentOffset:destinationOffset];
 			}
@@ -930,8 +1011,12 @@ static float clampBounce(float x) {
         return; // no scrolling; outside drag boundary
       }
       
+			CFAbsoluteTime t = CFAbsoluteTimeGetCurrent();
+			double dt = t - _throw.t;
+			_throw.t = t;
+			
 			CGPoint offset = _unroundedContentOffset;
-      CGFloat step = (1.0 - (distance / TUIScrollViewContinuousScrollDragBoundary)) * TUIScrollViewContinuousScrollRate;
+      CGFloat step = (1.0 - (distance / TUIScrollViewContinuousScrollDragBoundary)) * TUIScrollViewContinuousScrollRate * dt * TUIScrollPhysicsReferenceFrameRate; // rate is per 1/60 s
 			CGPoint dest = CGPointMake(offset.x, offset.y + (step * direction));
       
 			[self setContentOffset:dest];
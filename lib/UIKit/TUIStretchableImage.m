@@ -16,32 +16,77 @@
 
 #import "TUIStretchableImage.h"
 
-@implementation TUIStretchableImage
-
-#pragma mark Drawing
+/*
+ * Parts are indexed bottom to top, left to right:
+ *
+ *   6 7 8
+ *   3 4 5
+ *   0 1 2
+ */
+enum {
+	TUIStretchableImagePartBottomLeft,
+	TUIStretchableImagePartBottomEdge,
+	TUIStretchableImagePartBottomRight,
+	TUIStretchableImagePartLeftEdge,
+	TUIStretchableImagePartCenter,
+	TUIStretchableImagePartRightEdge,
+	TUIStretchableImagePartTopLeft,
+	TUIStretchableImagePartTopEdge,
+	TUIStretchableImagePartTopRight,
+	TUIStretchableImagePartCount
+};
+
+// One slice set per backing scale is plenty; a window moving between a
+// retina and a non-retina screen alternates between two.
+#define TUIStretchableImageMaximumCachedSlices 2
 
-- (void)drawInRect:(NSRect)dstRect fromRect:(NSRect)srcRect operation:(NSCompositingOperation)op fraction:(CGFloat)alpha {
-	[self drawInRect:dstRect fromRect:srcRect operation:op fraction:alpha respectFlipped:YES hints:nil];
+/*
+ * The nine parts cut from one representation of the image, for one set of
+ * insets and source rect.
+ *
+ * -CGImageForProposedRect: may hand out a new CGImage on every call, so the
+ * slices are matched on the scale of the representation rather than on the
+ * CGImage itself; a change of representations drops the whole cache.
+ */
+@interface TUIStretchableImageSlices : NSObject {
+@public
+	CGRect sourceRect; // in points
+	TUIEdgeInsets capInsets; // in points
+	CGFloat scale; // pixels per point of the CGImage the parts were cut from
+
+	TUIEdgeInsets insets; // capInsets reduced to the source rect, in pixels
+	CGImageRef parts[TUIStretchableImagePartCount];
+	NSArray *partImages; // NSImage wrappers for AppKit, built on first use
 }
 
-- (void)drawInRect:(NSRect)dstRect fromRect:(NSRect)srcRect operation:(NSCompositingOperation)op fraction:(CGFloat)alpha respectFlipped:(BOOL)respectFlipped hints:(NSDictionary *)hints {
-	CGImageRef image = [self CGImageForProposedRect:&dstRect context:[NSGraphicsContext currentContext] hints:hints];
-	if (image == NULL) {
-		NSLog(@"*** Could not get CGImage of %@", self);
-		return;
-	}
+- (instancetype)initWithImage:(CGImageRef)image scale:(CGFloat)scale sourceRect:(CGRect)srcRect capInsets:(TUIEdgeInsets)capInsets;
+- (BOOL)matchesScale:(CGFloat)scale sourceRect:(CGRect)srcRect capInsets:(TUIEdgeInsets)capInsets;
 
+@end
+
+@implementation TUIStretchableImageSlices
+
+- (instancetype)initWithImage:(CGImageRef)sourceImageRef scale:(CGFloat)theScale sourceRect:(CGRect)srcRect capInsets:(TUIEdgeInsets)theCapInsets {
+	self = [super init];
+	if (self == nil) return nil;
+
+	sourceRect = srcRect;
+	capInsets = theCapInsets;
+	scale = theScale;
+
+	// Cut in pixels.
+	insets = TUIEdgeInsetsMake(theCapInsets.top * theScale, theCapInsets.left * theScale, theCapInsets.bottom * theScale, theCapInsets.right * theScale);
+	srcRect = CGRectMake(CGRectGetMinX(srcRect) * theScale, CGRectGetMinY(srcRect) * theScale, CGRectGetWidth(srcRect) * theScale, CGRectGetHeight(srcRect) * theScale);
+
+	CGImageRef image = sourceImageRef;
 	CGSize size = CGSizeMake(CGImageGetWidth(image), CGImageGetHeight(image));
-	TUIEdgeInsets insets = self.tui_capInsets;
 
-	// TODO: Cache the nine-part images for this common case of wanting to draw
-	// the whole source image.
 	if (CGRectIsEmpty(srcRect)) {
 		// Match the image creation that occurs in the 'else' clause.
 		CGImageRetain(image);
 	} else {
 		image = CGImageCreateWithImageInRect(image, srcRect);
-		if (!image) return;
+		if (!image) return nil;
 
 		// Reduce insets to account for taking only part of the original image.
 		insets.left = fmax(0, insets.left - CGRectGetMinX(srcRect));
@@ -54,91 +99,274 @@
 		insets.top = fmax(0, insets.top - srcTopInset);
 	}
 
-	NSImage *topLeft = nil, *topEdge = nil, *topRight = nil;
-	NSImage *leftEdge = nil, *center = nil, *rightEdge = nil;
-	NSImage *bottomLeft = nil, *bottomEdge = nil, *bottomRight = nil;
-
 	// Length of sides that run vertically.
 	CGFloat verticalEdgeLength = fmax(0, size.height - insets.top - insets.bottom);
 
 	// Length of sides that run horizontally.
 	CGFloat horizontalEdgeLength = fmax(0, size.width - insets.left - insets.right);
 
-	NSImage *(^imageWithRect)(CGRect) = ^ id (CGRect rect){
-		CGImageRef part = CGImageCreateWithImageInRect(image, rect);
-		if (part == NULL) return nil;
-
-		NSImage *image = [[NSImage alloc] initWithCGImage:part size:rect.size];
-		CGImageRelease(part);
-
-		return image;
+	CGRect partRects[TUIStretchableImagePartCount] = {
+		CGRectMake(0, 0, insets.left, insets.bottom),
+		CGRectMake(insets.left, 0, horizontalEdgeLength, insets.bottom),
+		CGRectMake(size.width - insets.right, 0, insets.right, insets.bottom),
+		CGRectMake(0, insets.bottom, insets.left, verticalEdgeLength),
+		TUIEdgeInsetsInsetRect(CGRectMake(0, 0, size.width, size.height), insets),
+		CGRectMake(size.width - insets.right, insets.bottom, insets.right, verticalEdgeLength),
+		CGRectMake(0, size.height - insets.top, insets.left, insets.top),
+		CGRectMake(insets.left, size.height - insets.top, horizontalEdgeLength, insets.top),
+		CGRectMake(size.width - insets.right, size.height - insets.top, insets.right, insets.top),
 	};
 
-	if (verticalEdgeLength > 0) {
-		if (insets.left > 0) {
-			CGRect partRect = CGRectMake(0, insets.bottom, insets.left, verticalEdgeLength);
-			leftEdge = imageWithRect(partRect);
+	for (NSUInteger i = 0; i < TUIStretchableImagePartCount; i++) {
+		if (partRects[i].size.width > 0 && partRects[i].size.height > 0) {
+			parts[i] = CGImageCreateWithImageInRect(image, partRects[i]);
 		}
+	}
 
-		if (insets.right > 0) {
-			CGRect partRect = CGRectMake(size.width - insets.right, insets.bottom, insets.right, verticalEdgeLength);
-			rightEdge = imageWithRect(partRect);
-		}
+	CGImageRelease(image);
+	return self;
+}
+
+- (void)dealloc {
+	for (NSUInteger i = 0; i < TUIStretchableImagePartCount; i++) {
+		CGImageRelease(parts[i]);
 	}
+}
+
+- (BOOL)matchesScale:(CGFloat)theScale sourceRect:(CGRect)srcRect capInsets:(TUIEdgeInsets)theCapInsets {
+	return theScale == scale && CGRectEqualToRect(srcRect, sourceRect) && TUIEdgeInsetsEqualToEdgeInsets(theCapInsets, capInsets);
+}
 
-	if (horizontalEdgeLength > 0) {
-		if (insets.bottom > 0) {
-			CGRect partRect = CGRectMake(insets.left, 0, horizontalEdgeLength, insets.bottom);
-			bottomEdge = imageWithRect(partRect);
+// Size of a part in points.
+- (CGSize)sizeOfPart:(CGImageRef)part {
+	return CGSizeMake(CGImageGetWidth(part) / scale, CGImageGetHeight(part) / scale);
+}
+
+- (BOOL)isNinePart {
+	return parts[TUIStretchableImagePartTopLeft] != NULL || parts[TUIStretchableImagePartBottomRight] != NULL;
+}
+
+- (NSImage *)partImageAtIndex:(NSUInteger)index {
+	@synchronized (self) {
+		if (partImages == nil) {
+			NSMutableArray *images = [NSMutableArray arrayWithCapacity:TUIStretchableImagePartCount];
+			for (NSUInteger i = 0; i < TUIStretchableImagePartCount; i++) {
+				CGImageRef part = parts[i];
+				if (part == NULL) {
+					[images addObject:[NSNull null]];
+				} else {
+					[images addObject:[[NSImage alloc] initWithCGImage:part size:[self sizeOfPart:part]]];
+				}
+			}
+			partImages = images;
 		}
+	}
+
+	id image = partImages[index];
+	return image == [NSNull null] ? nil : image;
+}
+
+- (void)drawWithAppKitInRect:(NSRect)dstRect operation:(NSCompositingOperation)op fraction:(CGFloat)alpha flipped:(BOOL)flipped {
+	if ([self isNinePart]) {
+		NSDrawNinePartImage(dstRect,
+			[self partImageAtIndex:TUIStretchableImagePartBottomLeft], [self partImageAtIndex:TUIStretchableImagePartBottomEdge], [self partImageAtIndex:TUIStretchableImagePartBottomRight],
+			[self partImageAtIndex:TUIStretchableImagePartLeftEdge], [self partImageAtIndex:TUIStretchableImagePartCenter], [self partImageAtIndex:TUIStretchableImagePartRightEdge],
+			[self partImageAtIndex:TUIStretchableImagePartTopLeft], [self partImageAtIndex:TUIStretchableImagePartTopEdge], [self partImageAtIndex:TUIStretchableImagePartTopRight],
+			op, alpha, flipped);
+	} else if (parts[TUIStretchableImagePartLeftEdge] != NULL) {
+		// Horizontal three-part image.
+		NSDrawThreePartImage(dstRect, [self partImageAtIndex:TUIStretchableImagePartLeftEdge], [self partImageAtIndex:TUIStretchableImagePartCenter], [self partImageAtIndex:TUIStretchableImagePartRightEdge], NO, op, alpha, flipped);
+	} else {
+		// Vertical three-part image.
+		NSDrawThreePartImage(dstRect, [self partImageAtIndex:TUIStretchableImagePartTopEdge], [self partImageAtIndex:TUIStretchableImagePartCenter], [self partImageAtIndex:TUIStretchableImagePartBottomEdge], YES, op, alpha, flipped);
+	}
+}
 
-		if (insets.top > 0) {
-			CGRect partRect = CGRectMake(insets.left, size.height - insets.top, horizontalEdgeLength, insets.top);
-			topEdge = imageWithRect(partRect);
+/*
+ * Draws a nine-part image straight into the CGContext, the same way
+ * NSDrawNinePartImage() lays it out: corners at their natural size, edges and
+ * center tiled in between.
+ */
+- (void)drawNinePartInContext:(CGContextRef)context rect:(CGRect)dstRect fraction:(CGFloat)alpha flipped:(BOOL)flipped {
+	// Everything below is in points; the parts are in pixels.
+	CGFloat left = 0, right = 0, bottom = 0, top = 0;
+	if (parts[TUIStretchableImagePartBottomLeft]) {
+		CGSize partSize = [self sizeOfPart:parts[TUIStretchableImagePartBottomLeft]];
+		left = partSize.width;
+		bottom = partSize.height;
+	}
+	if (parts[TUIStretchableImagePartTopRight]) {
+		CGSize partSize = [self sizeOfPart:parts[TUIStretchableImagePartTopRight]];
+		right = partSize.width;
+		top = partSize.height;
+	}
+	if (parts[TUIStretchableImagePartTopLeft]) {
+		CGSize partSize = [self sizeOfPart:parts[TUIStretchableImagePartTopLeft]];
+		left = fmax(left, partSize.width);
+		top = fmax(top, partSize.height);
+	}
+	if (parts[TUIStretchableImagePartBottomRight]) {
+		CGSize partSize = [self sizeOfPart:parts[TUIStretchableImagePartBottomRight]];
+		right = fmax(right, partSize.width);
+		bottom = fmax(bottom, partSize.height);
+	}
+
+	CGFloat x0 = CGRectGetMinX(dstRect), x1 = x0 + left, x3 = CGRectGetMaxX(dstRect), x2 = x3 - right;
+	CGFloat y0 = CGRectGetMinY(dstRect), y1 = y0 + bottom, y3 = CGRectGetMaxY(dstRect), y2 = y3 - top;
+
+	CGRect r[TUIStretchableImagePartCount] = {
+		CGRectMake(x0, y0, x1 - x0, y1 - y0),
+		CGRectMake(x1, y0, x2 - x1, y1 - y0),
+		CGRectMake(x2, y0, x3 - x2, y1 - y0),
+		CGRectMake(x0, y1, x1 - x0, y2 - y1),
+		CGRectMake(x1, y1, x2 - x1, y2 - y1),
+		CGRectMake(x2, y1, x3 - x2, y2 - y1),
+		CGRectMake(x0, y2, x1 - x0, y3 - y2),
+		CGRectMake(x1, y2, x2 - x1, y3 - y2),
+		CGRectMake(x2, y2, x3 - x2, y3 - y2),
+	};
+
+	CGContextSaveGState(context);
+	CGContextSetAlpha(context, alpha);
+	if (flipped) {
+		// Draw the whole thing upright inside dstRect.
+		CGContextTranslateCTM(context, 0, y0 + y3);
+		CGContextScaleCTM(context, 1, -1);
+	}
+
+	for (NSUInteger i = 0; i < TUIStretchableImagePartCount; i++) {
+		CGImageRef part = parts[i];
+		if (part == NULL || r[i].size.width <= 0 || r[i].size.height <= 0) continue;
+
+		CGSize partSize = [self sizeOfPart:part];
+		if (CGSizeEqualToSize(partSize, r[i].size)) {
+			CGContextDrawImage(context, r[i], part);
+		} else {
+			CGContextSaveGState(context);
+			CGContextClipToRect(context, r[i]);
+			CGContextDrawTiledImage(context, (CGRect){ r[i].origin, partSize }, part);
+			CGContextRestoreGState(context);
 		}
 	}
 
-	if (insets.left > 0 && insets.top > 0) {
-		CGRect partRect = CGRectMake(0, size.height - insets.top, insets.left, insets.top);
-		topLeft = imageWithRect(partRect);
+	CGContextRestoreGState(context);
+}
+
+@end
+
+@interface TUIStretchableImage ()
+
+@property (nonatomic, strong) NSMutableArray *cachedSlices; // most recently used first
+
+@end
+
+@implementation TUIStretchableImage
+
+#pragma mark Slice Cache
+
+- (TUIStretchableImageSlices *)slicesForImage:(CGImageRef)image sourceRect:(CGRect)srcRect {
+	TUIEdgeInsets insets = self.tui_capInsets;
+
+	CGFloat scale = 1;
+	CGFloat pointWidth = self.size.width;
+	if (pointWidth > 0 && CGImageGetWidth(image) > 0) {
+		scale = CGImageGetWidth(image) / pointWidth;
 	}
 
-	if (insets.left > 0 && insets.bottom > 0) {
-		CGRect partRect = CGRectMake(0, 0, insets.left, insets.bottom);
-		bottomLeft = imageWithRect(partRect);
+	@synchronized (self) {
+		NSUInteger index = [self.cachedSlices indexOfObjectPassingTest:^BOOL(TUIStretchableImageSlices *slices, NSUInteger idx, BOOL *stop) {
+			return [slices matchesScale:scale sourceRect:srcRect capInsets:insets];
+		}];
+		if (index != NSNotFound) {
+			TUIStretchableImageSlices *slices = self.cachedSlices[index];
+			if (index != 0) {
+				[self.cachedSlices removeObjectAtIndex:index];
+				[self.cachedSlices insertObject:slices atIndex:0];
+			}
+			return slices;
+		}
 	}
 
-	if (insets.right > 0 && insets.top > 0) {
-		CGRect partRect = CGRectMake(size.width - insets.right, size.height - insets.top, insets.right, insets.top);
-		topRight = imageWithRect(partRect);
+	TUIStretchableImageSlices *slices = [[TUIStretchableImageSlices alloc] initWithImage:image scale:scale sourceRect:srcRect capInsets:insets];
+	if (slices == nil) return nil;
+
+	@synchronized (self) {
+		if (self.cachedSlices == nil) self.cachedSlices = [NSMutableArray array];
+		[self.cachedSlices insertObject:slices atIndex:0];
+		if (self.cachedSlices.count > TUIStretchableImageMaximumCachedSlices) {
+			[self.cachedSlices removeLastObject];
+		}
 	}
 
-	if (insets.right > 0 && insets.bottom > 0) {
-		CGRect partRect = CGRectMake(size.width - insets.right, 0, insets.right, insets.bottom);
-		bottomRight = imageWithRect(partRect);
+	return slices;
+}
+
+- (void)invalidateSlices {
+	@synchronized (self) {
+		[self.cachedSlices removeAllObjects];
 	}
+}
+
+- (void)setTui_capInsets:(TUIEdgeInsets)capInsets {
+	_tui_capInsets = capInsets;
+	[self invalidateSlices];
+}
 
-	CGRect centerRect = TUIEdgeInsetsInsetRect(CGRectMake(0, 0, size.width, size.height), insets);
-	if (centerRect.size.width > 0 && centerRect.size.height > 0) {
-		center = imageWithRect(centerRect);
+- (void)addRepresentation:(NSImageRep *)imageRep {
+	[super addRepresentation:imageRep];
+	[self invalidateSlices];
+}
+
+- (void)addRepresentations:(NSArray *)imageReps {
+	[super addRepresentations:imageReps];
+	[self invalidateSlices];
+}
+
+- (void)removeRepresentation:(NSImageRep *)imageRep {
+	[super removeRepresentation:imageRep];
+	[self invalidateSlices];
+}
+
+- (void)setSize:(NSSize)size {
+	[super setSize:size];
+	[self invalidateSlices];
+}
+
+- (void)recache {
+	[super recache];
+	[self invalidateSlices];
+}
+
+#pragma mark Drawing
+
+- (void)drawInRect:(NSRect)dstRect fromRect:(NSRect)srcRect operation:(NSCompositingOperation)op fraction:(CGFloat)alpha {
+	[self drawInRect:dstRect fromRect:srcRect operation:op fraction:alpha respectFlipped:YES hints:nil];
+}
+
+- (void)drawInRect:(NSRect)dstRect fromRect:(NSRect)srcRect operation:(NSCompositingOperation)op fraction:(CGFloat)alpha respectFlipped:(BOOL)respectFlipped hints:(NSDictionary *)hints {
+	NSGraphicsContext *graphicsContext = [NSGraphicsContext currentContext];
+	CGImageRef image = [self CGImageForProposedRect:&dstRect context:graphicsContext hints:hints];
+	if (image == NULL) {
+		NSLog(@"*** Could not get CGImage of %@", self);
+		return;
 	}
 
-	CGImageRelease(image);
+	TUIStretchableImageSlices *slices = [self slicesForImage:image sourceRect:srcRect];
+	if (slices == nil) return;
 
 	BOOL flipped = NO;
 	if (respectFlipped) {
-		flipped = [[NSGraphicsContext currentContext] isFlipped];
+		flipped = [graphicsContext isFlipped];
 	}
 
-	if (topLeft != nil || bottomRight != nil) {
-		NSDrawNinePartImage(dstRect, bottomLeft, bottomEdge, bottomRight, leftEdge, center, rightEdge, topLeft, topEdge, topRight, op, alpha, flipped);
-	} else if (leftEdge != nil) {
-		// Horizontal three-part image.
-		NSDrawThreePartImage(dstRect, leftEdge, center, rightEdge, NO, op, alpha, flipped);
-	} else {
-		// Vertical three-part image.
-		NSDrawThreePartImage(dstRect, topEdge, center, bottomEdge, YES, op, alpha, flipped);
+	// Plain source-over nine-part drawing needs nothing from AppKit.
+	CGContextRef context = graphicsContext.CGContext;
+	if (context != NULL && op == NSCompositeSourceOver && [slices isNinePart]) {
+		[slices drawNinePartInContext:context rect:dstRect fraction:alpha flipped:flipped];
+		return;
 	}
+
+	[slices drawWithAppKitInRect:dstRect operation:op fraction:alpha flipped:flipped];
 }
 
 #pragma mark NSCopying
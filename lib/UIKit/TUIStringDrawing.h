@@ -20,12 +20,25 @@
 @class TUIFont;
 @class TUIColor;
 
+typedef struct {
+	CGSize size;            // same as -ab_sizeConstrainedToSize:
+	NSUInteger lineCount;   // lines laid out, after applying the line limit
+	NSRange truncatedRange; // characters hidden or cut by the truncation token, {NSNotFound, 0} if everything fits
+} TUITextMeasurement;
+
 @interface NSAttributedString (TUIStringDrawing)
 
 - (CGSize)ab_size;
 - (CGSize)ab_sizeConstrainedToSize:(CGSize)size;
 - (CGSize)ab_sizeConstrainedToWidth:(CGFloat)width;
 
+/**
+ Measure the string without drawing it.  Pass 0 for @p numberOfLines for no limit.
+ 
+ Safe to call from any thread, including many at once on a concurrent queue: each thread reuses its own text renderer, and finished layouts are shared through the TUITextLayout cache.  Don't call it from inside a block that is itself measuring or drawing with -ab_ methods on the same thread.
+ */
+- (TUITextMeasurement)ab_measurementConstrainedToWidth:(CGFloat)width numberOfLines:(NSUInteger)numberOfLines;
+
 - (CGSize)ab_drawInRect:(CGRect)rect;
 - (CGSize)ab_drawInRect:(CGRect)rect context:(CGContextRef)ctx;
 - (CGSize)ab_drawInRect:(CGRect)rect context:(CGContextRef)ctx verticalAlignment:(TUITextVerticalAlignment)verticalAlignment;
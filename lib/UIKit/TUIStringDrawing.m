@@ -20,6 +20,8 @@
 #import "TUIFont.h"
 #import "TUIStringDrawing.h"
 #import "TUITextRenderer.h"
+#import "TUITextLayout_Private.h"
+#import "TUITextLayoutLine.h"
 
 @implementation NSAttributedString (TUIStringDrawing)
 
@@ -51,24 +53,61 @@ NSString * const kThreadTextRendererKey = @"com.twui.thread-textrenderer";
     if ([NSThread isMainThread]) {
         return [[self class] ab_globalTextRenderer];
     } else {
-        return [[TUITextRenderer alloc] init];
+        return [[self class] ab_textRendererForCurrentThread];
     }
 }
 
-- (CGSize)ab_sizeConstrainedToWidth:(CGFloat)width
-{
-	return [self ab_sizeConstrainedToSize:CGSizeMake(width, 2000)]; // big enough
-}
-
-- (CGSize)ab_sizeConstrainedToSize:(CGSize)size
+- (TUIFontMetrics)ab_baselineFontMetrics
 {
     TUIFontMetrics metrics = TUIFontMetricsNull;
     if (self.length) {
         CTFontRef font = (__bridge CTFontRef)[self attribute:(NSString *)kCTFontAttributeName atIndex:0 effectiveRange:NULL];
         if (font) {
-            metrics = TUIFontMetricsGetDefault(CTFontGetSize(font));
+            metrics = TUIFontMetricsGetDefaultForPointSize(CTFontGetSize(font));
         }
     }
+    return metrics;
+}
+
+- (CGSize)ab_sizeConstrainedToWidth:(CGFloat)width
+{
+	return [self ab_sizeConstrainedToSize:CGSizeMake(width, 2000)]; // big enough
+}
+
+- (TUITextMeasurement)ab_measurementConstrainedToWidth:(CGFloat)width numberOfLines:(NSUInteger)numberOfLines
+{
+    TUITextRenderer *t = [self ab_sharedTextRenderer];
+    TUITextLayout *layout = t.textLayout;
+    NSUInteger oldNumberOfLines = layout.maximumNumberOfLines;
+    
+    t.attributedString = self;
+    t.frame = CGRectMake(0, 0, width, 2000); // same as -ab_sizeConstrainedToWidth:, so both share cached layouts
+    layout.baselineFontMetrics = [self ab_baselineFontMetrics];
+    layout.maximumNumberOfLines = numberOfLines;
+    
+    TUITextMeasurement measurement;
+    measurement.size = layout.layoutSize;
+    measurement.truncatedRange = NSMakeRange(NSNotFound, 0);
+    
+    NSArray *lines = layout.layoutFrame.lineFragments;
+    measurement.lineCount = lines.count;
+    
+    TUITextLayoutLine *lastLine = lines.lastObject;
+    NSUInteger visibleEnd = NSMaxRange(lastLine.visibleStringRange);
+    if (visibleEnd < self.length) {
+        measurement.truncatedRange = NSMakeRange(visibleEnd, self.length - visibleEnd);
+    }
+    
+    // don't keep the string alive, or leak the line limit into the next user of this renderer
+    layout.maximumNumberOfLines = oldNumberOfLines;
+    t.attributedString = nil;
+    
+    return measurement;
+}
+
+- (CGSize)ab_sizeConstrainedToSize:(CGSize)size
+{
+    TUIFontMetrics metrics = [self ab_baselineFontMetrics];
     
     TUITextRenderer *t = [self ab_sharedTextRenderer];
     t.attributedString = self;
@@ -84,13 +123,7 @@ NSString * const kThreadTextRendererKey = @"com.twui.thread-textrenderer";
 
 - (CGSize)ab_drawInRect:(CGRect)rect context:(CGContextRef)ctx verticalAlignment:(TUITextVerticalAlignment)verticalAlignment
 {
-    TUIFontMetrics metrics = TUIFontMetricsNull;
-    if (self.length) {
-        CTFontRef font = (__bridge CTFontRef)[self attribute:(NSString *)kCTFontAttributeName atIndex:0 effectiveRange:NULL];
-        if (font) {
-            metrics = TUIFontMetricsGetDefault(CTFontGetSize(font));
-        }
-    }
+    TUIFontMetrics metrics = [self ab_baselineFontMetrics];
 
     TUITextRenderer *t = [self ab_sharedTextRenderer];
     t.attributedString = self;
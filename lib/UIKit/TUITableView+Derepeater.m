@@ -44,7 +44,8 @@
 	
 	for(TUITableViewCell<ABDerepeaterTableViewCell> *cell in [self sortedVisibleCells]) {
 		zIndex--;
-		cell.layer.zPosition = zIndex;
+		if(cell.layer.zPosition != zIndex) // leaves the table's sorted subviews cached when nothing moved
+			cell.layer.zPosition = zIndex;
 		CGRect cellFrame = cell.frame;
 		
 		NSString *identifier = [cell derepeaterIdentifier];
@@ -17,6 +17,8 @@
 #import "TUIScrollView.h"
 
 @class TUIFastIndexPath;
+@class TUITableViewCellReusePool;
+@class TUITableViewVisibleRows;
 
 typedef enum {
 	TUITableViewStylePlain,              // regular table view
@@ -39,6 +41,7 @@ typedef enum {
 
 @class TUITableViewCell;
 @protocol TUITableViewDataSource;
+@protocol TUITableViewDataSourcePrefetching;
 
 @class TUITableView;
 
@@ -48,6 +51,11 @@ typedef enum {
 
 @optional
 
+/**
+ Implement this to defer -tableView:heightForRowAtIndexPath: until a row comes close to the viewport.  The estimate is used for layout until then; the content size is corrected as estimates are replaced and the topmost visible row stays in place.
+ */
+- (CGFloat)tableView:(TUITableView *)tableView estimatedHeightForRowAtIndexPath:(TUIFastIndexPath *)indexPath;
+
 - (void)tableView:(TUITableView *)tableView willDisplayCell:(TUITableViewCell *)cell forRowAtIndexPath:(TUIFastIndexPath *)indexPath; // called after the cell's frame has been set but before it's added as a subview
 - (void)tableView:(TUITableView *)tableView didEndDisplayingCell:(TUITableViewCell *)cell forRowAtIndexPath:(TUIFastIndexPath *)indexPath;
 - (void)tableView:(TUITableView *)tableView didSelectRowAtIndexPath:(TUIFastIndexPath *)indexPath; // happens on left/right mouse down, key up/down
@@ -79,8 +87,8 @@ typedef enum {
 	CGFloat                       _contentHeight;
 	
 	NSMutableIndexSet           * _visibleSectionHeaders;
-	NSMutableDictionary         * _visibleItems;
-	NSMutableDictionary         * _reusableTableCells;
+	TUITableViewVisibleRows     * _visibleItems;
+	TUITableViewCellReusePool   * _reusePool;
 	
 	TUIFastIndexPath            * _selectedIndexPath;
 	TUIFastIndexPath            * _indexPathShouldBeFirstResponder;
@@ -105,6 +113,10 @@ typedef enum {
 		unsigned int delegateTableViewWillDisplayCellForRowAtIndexPath:1;
         unsigned int delegateTableViewDidEndDisplayingCellForRowAtIndexPath:1;
 		unsigned int maintainContentOffsetAfterReload:1;
+		unsigned int delegateTableViewEstimatedHeightForRowAtIndexPath:1;
+		unsigned int prefetchDataSourceCancelPrefetching:1;
+		unsigned int prefetchDataSourceHeightForRowInBackground:1;
+		unsigned int needsCellRelayout:1;
 	} _tableFlags;
 	
 }
@@ -113,11 +125,17 @@ typedef enum {
 
 @property (nonatomic,weak) id <TUITableViewDataSource>  dataSource;
 @property (nonatomic,weak) id <TUITableViewDelegate>    delegate;
+@property (nonatomic,weak) id <TUITableViewDataSourcePrefetching> prefetchDataSource;
 
 @property (readwrite, assign) BOOL                        animateSelectionChanges;
 @property (nonatomic, assign) BOOL maintainContentOffsetAfterReload;
 @property (nonatomic, assign) BOOL optimizedLiveResizingEnabled;
 
+/**
+ When greater than zero and the delegate doesn't implement -tableView:estimatedHeightForRowAtIndexPath:, every row starts out with this height and is only measured once it comes close to the viewport, so reloading doesn't call the delegate once per row.  Default is 0 (measure every row up front).
+ */
+@property (nonatomic, assign) CGFloat estimatedRowHeight;
+
 - (void)reloadData;
 
 /**
@@ -128,6 +146,19 @@ typedef enum {
 // Forces a re-calculation and re-layout of the table. This is most useful for animating the relayout. It is potentially _more_ expensive than -reloadData since it has to allow for animating.
 - (void)reloadLayout;
 
+/**
+ Batched row updates.  Inserts, deletes, moves and reloads made between -beginUpdates and -endUpdates are applied together when the outermost -endUpdates is called; outside of a batch each call is applied immediately.  As with UIKit, deleted, reloaded and moved-from index paths refer to the table before the update, inserted and moved-to index paths refer to it after.
+
+ Only the affected rows are measured with -tableView:heightForRowAtIndexPath:, visible cells for unchanged rows are kept, and the topmost visible row stays where it was on screen.  The number of sections must not change; if the data source disagrees with the batch the table falls back to -reloadData.
+ */
+- (void)beginUpdates;
+- (void)endUpdates;
+
+- (void)insertRowsAtIndexPaths:(NSArray *)indexPaths;
+- (void)deleteRowsAtIndexPaths:(NSArray *)indexPaths;
+- (void)reloadRowsAtIndexPaths:(NSArray *)indexPaths;
+- (void)moveRowAtIndexPath:(TUIFastIndexPath *)indexPath toIndexPath:(TUIFastIndexPath *)newIndexPath;
+
 - (NSInteger)numberOfSections;
 - (NSInteger)numberOfRowsInSection:(NSInteger)section;
 
@@ -182,6 +213,16 @@ typedef enum {
  */
 - (__kindof TUITableViewCell *)dequeueReusableCellWithIdentifier:(NSString *)identifier;
 
+/**
+ Cells that scroll offscreen wait here until they're dequeued.  Use it to cap pool sizes per identifier and to read hit/miss counts.
+ */
+@property (nonatomic, readonly) TUITableViewCellReusePool *reusePool;
+
+/**
+ Fill the pool for a registered @p identifier, during idle time, with enough cells to cover the visible rect.
+ */
+- (void)prewarmReusableCellsWithIdentifier:(NSString *)identifier;
+
 @end
 
 @protocol TUITableViewDataSource<NSObject>
@@ -207,6 +248,27 @@ typedef enum {
 
 @end
 
+@protocol TUITableViewDataSourcePrefetching<NSObject>
+
+/**
+ Called with rows that are about to scroll into view, ahead of -tableView:cellForRowAtIndexPath:.  How far ahead depends on the scroll velocity.  A good place to start loading images or other content for those rows.
+ */
+- (void)tableView:(TUITableView *)tableView prefetchRowsAtIndexPaths:(NSArray *)indexPaths;
+
+@optional
+
+/**
+ Called for previously prefetched rows that are no longer approaching the viewport, e.g. because the scroll direction changed, so that work started for them can be cancelled.
+ */
+- (void)tableView:(TUITableView *)tableView cancelPrefetchingForRowsAtIndexPaths:(NSArray *)indexPaths;
+
+/**
+ When row heights are estimated, this is called on a background queue for prefetched rows that haven't been measured yet, and must be safe to call from there.  The heights are merged into the table on the main thread.  Rows that come into view before their background measurement finishes are measured with -tableView:heightForRowAtIndexPath: as usual.
+ */
+- (CGFloat)tableView:(TUITableView *)tableView heightForRowAtIndexPathInBackground:(TUIFastIndexPath *)indexPath;
+
+@end
+
 @interface NSIndexPath (TUITableView)
 
 + (NSIndexPath *)indexPathForRow:(NSUInteger)row inSection:(NSUInteger)section;
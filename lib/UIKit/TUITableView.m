@@ -20,17 +20,97 @@
 #import "TUINSView.h"
 #import "TUINSWindow.h"
 #import "TUITableView+Cell.h"
+#import "TUITableViewCellReusePool.h"
 #import "TUITableViewSectionHeader.h"
 #import "TUITableViewFastLiveResizingContext.h"
+#import "TUITableViewVisibleRows.h"
 
 // header views need to be above the cells at all times
 #define HEADER_Z_POSITION 1000 
 
+// how far ahead of the viewport rows are prefetched: one screen, plus this
+// many seconds of throw velocity, but never more than the given number of screens
+#define PREFETCH_VELOCITY_LOOKAHEAD 0.5
+#define PREFETCH_MAX_SCREENS 4.0
+
 typedef struct {
-	CGFloat offset; // from beginning of section
 	CGFloat height;
+	BOOL estimated; // placeholder height until the row approaches the viewport
 } TUITableViewRowInfo;
 
+@interface TUITableView (Private)
+- (void)_updateSectionInfo;
+- (void)_updateDerepeaterViews;
+- (CGFloat)_uniformEstimatedRowHeight;
+- (TUITableViewRowInfo)_rowInfoForRowAtPackedIndexPath:(TUIPackedIndexPath)indexPath;
+- (CGRect)_rectForRowAtPackedIndexPath:(TUIPackedIndexPath)indexPath;
+- (TUIPackedIndexPath)_packedIndexPathForRowAtVerticalOffset:(CGFloat)offset;
+- (void)_enumeratePackedIndexPathsFrom:(TUIPackedIndexPath)from to:(TUIPackedIndexPath)to usingBlock:(void (^)(TUIPackedIndexPath indexPath, BOOL *stop))block;
+- (void)_enumeratePackedIndexPathsFrom:(TUIPackedIndexPath)from to:(TUIPackedIndexPath)to excludingFrom:(TUIPackedIndexPath)excludedFrom to:(TUIPackedIndexPath)excludedTo usingBlock:(void (^)(TUIPackedIndexPath indexPath))block;
+@end
+
+/*
+ Row offsets are kept in a Fenwick (binary indexed) tree over the row heights
+ so that offset lookups, offset -> row searches and single height changes are
+ all O(log n) rather than a walk over every row in the section.  Heights are
+ rounded to whole points, so the sums are exact.
+ */
+
+static inline NSUInteger TUITableViewRowTreeLowBit(NSUInteger i)
+{
+	return i & (~i + 1);
+}
+
+static void TUITableViewRowTreeBuild(CGFloat *tree, const TUITableViewRowInfo *rows, NSUInteger n)
+{
+	tree[0] = 0.0;
+	for(NSUInteger i = 1; i <= n; ++i)
+		tree[i] = rows[i - 1].height;
+	for(NSUInteger i = 1; i <= n; ++i) {
+		NSUInteger parent = i + TUITableViewRowTreeLowBit(i);
+		if(parent <= n)
+			tree[parent] += tree[i];
+	}
+}
+
+// sum of the heights of the first `count` rows
+static CGFloat TUITableViewRowTreePrefix(const CGFloat *tree, NSUInteger count)
+{
+	CGFloat sum = 0.0;
+	for(NSUInteger i = count; i > 0; i -= TUITableViewRowTreeLowBit(i))
+		sum += tree[i];
+	return sum;
+}
+
+static void TUITableViewRowTreeAdd(CGFloat *tree, NSUInteger n, NSUInteger row, CGFloat delta)
+{
+	for(NSUInteger i = row + 1; i <= n; i += TUITableViewRowTreeLowBit(i))
+		tree[i] += delta;
+}
+
+// largest count such that the first `count` rows end strictly before `offset`,
+// i.e. the index of the row containing `offset` (== n if past the last row)
+static NSUInteger TUITableViewRowTreeSearch(const CGFloat *tree, NSUInteger n, NSUInteger mask, CGFloat offset)
+{
+	NSUInteger pos = 0;
+	for(NSUInteger step = mask; step > 0; step >>= 1) {
+		NSUInteger next = pos + step;
+		if(next <= n && tree[next] < offset) {
+			pos = next;
+			offset -= tree[next];
+		}
+	}
+	return pos;
+}
+
+static NSUInteger TUITableViewRowTreeMask(NSUInteger n)
+{
+	NSUInteger mask = 1;
+	while((mask << 1) <= n)
+		mask <<= 1;
+	return n ? mask : 0;
+}
+
 @interface TUITableViewSection : NSObject
 {
 	__weak TUITableView  *_tableView;   // weak
@@ -39,7 +119,10 @@ typedef struct {
 	NSUInteger            numberOfRows;
 	CGFloat               sectionHeight;
 	CGFloat               sectionOffset;
+	CGFloat               rowsOffset;   // rounded header height, rows start here
 	TUITableViewRowInfo  *rowInfo;
+	CGFloat              *rowTree;      // 1-based Fenwick tree over rowInfo heights
+	NSUInteger            rowTreeMask;
 }
 
 @property (strong, readonly) TUIView           *headerView;
@@ -60,6 +143,8 @@ typedef struct {
 		sectionIndex = s;
 		numberOfRows = n;
 		rowInfo = (TUITableViewRowInfo *)calloc(n, sizeof(TUITableViewRowInfo));
+		rowTree = (CGFloat *)calloc(n + 1, sizeof(CGFloat));
+		rowTreeMask = TUITableViewRowTreeMask(n);
 	}
 	return self;
 }
@@ -67,6 +152,7 @@ typedef struct {
 - (void)dealloc
 {
 	if(rowInfo) free(rowInfo);
+	if(rowTree) free(rowTree);
 }
 
 - (NSUInteger)numberOfRows
@@ -76,20 +162,80 @@ typedef struct {
 
 - (void)_setupRowHeights
 {
-	sectionHeight = 0.0;
+	rowsOffset = 0.0;
 	
 	TUIView *header;
 	if((header = self.headerView) != nil) {
-		sectionHeight += round(header.frame.size.height);
+		rowsOffset += round(header.frame.size.height);
 	}
-  
-	for(int i = 0; i < numberOfRows; ++i) {
-		CGFloat h = round([_tableView.delegate tableView:_tableView heightForRowAtIndexPath:[TUIFastIndexPath indexPathForRow:i inSection:sectionIndex]]);
-		rowInfo[i].offset = sectionHeight;
-		rowInfo[i].height = h;
-		sectionHeight += h;
+	
+	CGFloat rowsHeight = 0.0;
+	CGFloat estimatedHeight = [_tableView _uniformEstimatedRowHeight];
+	if(estimatedHeight > 0.0) {
+		// nothing is measured until it comes close to the viewport
+		for(NSUInteger i = 0; i < numberOfRows; ++i) {
+			rowInfo[i].height = estimatedHeight;
+			rowInfo[i].estimated = YES;
+		}
+		rowsHeight = estimatedHeight * numberOfRows;
+	} else {
+		for(NSUInteger i = 0; i < numberOfRows; ++i) {
+			rowInfo[i] = [_tableView _rowInfoForRowAtPackedIndexPath:TUIPackedIndexPathMake(sectionIndex, i)];
+			rowsHeight += rowInfo[i].height;
+		}
 	}
 	
+	TUITableViewRowTreeBuild(rowTree, rowInfo, numberOfRows);
+	sectionHeight = rowsOffset + rowsHeight;
+}
+
+/**
+ * @brief Replace the row geometry of this section
+ * 
+ * Used by batched row updates to splice rows in and out without asking the
+ * delegate for the heights of rows that did not change.  The section takes
+ * ownership of @p rows, which must have been allocated with malloc().
+ */
+- (void)_setRowInfo:(TUITableViewRowInfo *)rows numberOfRows:(NSUInteger)n
+{
+	if(rowInfo) free(rowInfo);
+	if(rowTree) free(rowTree);
+	
+	numberOfRows = n;
+	rowInfo = rows;
+	rowTree = (CGFloat *)calloc(n + 1, sizeof(CGFloat));
+	rowTreeMask = TUITableViewRowTreeMask(n);
+	TUITableViewRowTreeBuild(rowTree, rowInfo, numberOfRows);
+	sectionHeight = rowsOffset + TUITableViewRowTreePrefix(rowTree, numberOfRows);
+}
+
+/**
+ * @brief Change the height of a single row
+ * 
+ * Offsets of the following rows shift implicitly through the row tree.
+ */
+- (void)_setHeight:(CGFloat)h estimated:(BOOL)estimated forRow:(NSUInteger)row
+{
+	if(row >= numberOfRows)
+		return;
+	
+	rowInfo[row].estimated = estimated;
+	CGFloat delta = h - rowInfo[row].height;
+	if(delta != 0.0) {
+		rowInfo[row].height = h;
+		TUITableViewRowTreeAdd(rowTree, numberOfRows, row, delta);
+		sectionHeight += delta;
+	}
+}
+
+- (TUITableViewRowInfo)_rowInfoAtIndex:(NSUInteger)i
+{
+	return rowInfo[i];
+}
+
+- (BOOL)rowHeightIsEstimated:(NSUInteger)i
+{
+	return (i < numberOfRows) ? rowInfo[i].estimated : NO;
 }
 
 - (CGFloat)rowHeight:(NSInteger)i
@@ -103,7 +249,7 @@ typedef struct {
 - (CGFloat)sectionRowOffset:(NSInteger)i
 {
 	if(i >= 0 && i < numberOfRows){
-		return rowInfo[i].offset;
+		return rowsOffset + TUITableViewRowTreePrefix(rowTree, i);
 	}
 	return 0.0;
 }
@@ -113,6 +259,19 @@ typedef struct {
 	return sectionOffset + [self sectionRowOffset:i];
 }
 
+/**
+ * @brief Obtain the row containing an offset from the beginning of the section
+ * 
+ * A row spans the half-open range (offset, offset + height] so that offsets on
+ * a boundary resolve to the upper row, matching the table's flipped geometry.
+ * 
+ * @return row index, or numberOfRows if @p offset is past the last row
+ */
+- (NSUInteger)rowAtSectionOffset:(CGFloat)offset
+{
+	return TUITableViewRowTreeSearch(rowTree, numberOfRows, rowTreeMask, offset - rowsOffset);
+}
+
 - (CGFloat)sectionHeight
 {
 	return sectionHeight;
@@ -145,17 +304,27 @@ typedef struct {
 
 @end
 
-@interface TUITableView (Private)
-- (void)_updateSectionInfo;
-- (void)_updateDerepeaterViews;
-@end
-
 @interface TUITableView ()
 
-@property (nonatomic, strong) NSMutableDictionary *reusableCellClasses;
 @property (nonatomic, assign) NSInteger liveResizeLevels;
 @property (nonatomic, strong) TUITableViewFastLiveResizingContext * optimizedLiveResizeContext;
 
+// batched row updates, applied by the outermost -endUpdates
+@property (nonatomic, assign) NSInteger updatesLevel;
+@property (nonatomic, strong) NSMutableArray * pendingDeletedIndexPaths;
+@property (nonatomic, strong) NSMutableArray * pendingInsertedIndexPaths;
+@property (nonatomic, strong) NSMutableArray * pendingReloadedIndexPaths;
+@property (nonatomic, strong) NSMutableDictionary * pendingMovedIndexPaths; // destination -> source
+
+// bumped whenever index paths stop referring to the same rows
+@property (nonatomic, assign) NSUInteger rowGeometryGeneration;
+
+// prefetching
+@property (nonatomic, assign) TUIPackedIndexPath firstPrefetchedIndexPath; // TUIPackedIndexPathNotFound when nothing is prefetched
+@property (nonatomic, assign) TUIPackedIndexPath lastPrefetchedIndexPath;
+@property (nonatomic, strong) NSMutableSet * backgroundMeasuringIndexPaths;
+@property (nonatomic, assign) CGFloat lastPrefetchTopOffset;
+
 @end
 
 @implementation TUITableView
@@ -167,11 +336,14 @@ typedef struct {
 {
 	if((self = [super initWithFrame:frame])) {
 		_style = style;
-        _reusableCellClasses = NSMutableDictionary.dictionary;
-		_reusableTableCells = NSMutableDictionary.dictionary;
+		_reusePool = [[TUITableViewCellReusePool alloc] init];
 		_visibleSectionHeaders = NSMutableIndexSet.indexSet;
-		_visibleItems = NSMutableDictionary.dictionary;
+		_visibleItems = [[TUITableViewVisibleRows alloc] init];
+		_firstPrefetchedIndexPath = TUIPackedIndexPathNotFound;
+		_lastPrefetchedIndexPath = TUIPackedIndexPathNotFound;
+		_backgroundMeasuringIndexPaths = NSMutableSet.set;
 		_tableFlags.animateSelectionChanges = 1;
+		self.indexesSubviewsSpatially = YES; // cells are stacked without overlapping
 	}
 	return self;
 }
@@ -191,6 +363,7 @@ typedef struct {
 {
 	_tableFlags.delegateTableViewWillDisplayCellForRowAtIndexPath = [d respondsToSelector:@selector(tableView:willDisplayCell:forRowAtIndexPath:)];
     _tableFlags.delegateTableViewDidEndDisplayingCellForRowAtIndexPath = [d respondsToSelector:@selector(tableView:didEndDisplayingCell:forRowAtIndexPath:)];
+	_tableFlags.delegateTableViewEstimatedHeightForRowAtIndexPath = [d respondsToSelector:@selector(tableView:estimatedHeightForRowAtIndexPath:)];
 	[super setDelegate:d]; // must call super
 }
 
@@ -205,6 +378,15 @@ typedef struct {
 	_tableFlags.dataSourceNumberOfSectionsInTableView = [_dataSource respondsToSelector:@selector(numberOfSectionsInTableView:)];
 }
 
+- (void)setPrefetchDataSource:(id<TUITableViewDataSourcePrefetching>)d
+{
+	_prefetchDataSource = d;
+	_tableFlags.prefetchDataSourceCancelPrefetching = [d respondsToSelector:@selector(tableView:cancelPrefetchingForRowsAtIndexPaths:)];
+	_tableFlags.prefetchDataSourceHeightForRowInBackground = [d respondsToSelector:@selector(tableView:heightForRowAtIndexPathInBackground:)];
+	_firstPrefetchedIndexPath = TUIPackedIndexPathNotFound;
+	_lastPrefetchedIndexPath = TUIPackedIndexPathNotFound;
+}
+
 - (BOOL)animateSelectionChanges
 {
 	return _tableFlags.animateSelectionChanges;
@@ -250,9 +432,14 @@ typedef struct {
 
 - (CGRect)rectForRowAtIndexPath:(TUIFastIndexPath *)indexPath
 {
-	NSInteger section = indexPath.section;
-	NSInteger row = indexPath.row;
-	if(section >= 0 && section < [_sectionInfo count]) {
+	return [self _rectForRowAtPackedIndexPath:indexPath.packedIndexPath];
+}
+
+- (CGRect)_rectForRowAtPackedIndexPath:(TUIPackedIndexPath)indexPath
+{
+	NSUInteger section = TUIPackedIndexPathSection(indexPath);
+	NSUInteger row = TUIPackedIndexPathRow(indexPath);
+	if(section < [_sectionInfo count]) {
 		TUITableViewSection *s = [_sectionInfo objectAtIndex:section];
 		CGFloat offset = [s tableRowOffset:row];
 		CGFloat height = [s rowHeight:row];
@@ -304,52 +491,179 @@ typedef struct {
 	_contentHeight = offset;
 	_sectionInfo = sections;
 	
+	[self _invalidateRowGeometryGeneration];
+	
 }
 
-- (void)registerClass:(nullable Class)cellClass forCellReuseIdentifier:(NSString *)identifier {
-    if (!identifier) {
-        return;
-    }
+- (void)_updateSectionOffsets
+{
+	CGFloat offset = [_headerView bounds].size.height;
+	for(TUITableViewSection *section in _sectionInfo) {
+		section.sectionOffset = offset;
+		offset += [section sectionHeight];
+	}
+	_contentHeight = offset;
+}
 
-    _reusableCellClasses[identifier] = cellClass;
+#pragma mark - Estimated Row Heights
+
+- (BOOL)_estimatesRowHeights
+{
+	return _tableFlags.delegateTableViewEstimatedHeightForRowAtIndexPath || _estimatedRowHeight > 0.0;
 }
 
-- (void)_enqueueReusableCell:(TUITableViewCell *)cell
+/**
+ * @brief The estimate shared by every row, or 0 if rows are estimated individually or not at all
+ */
+- (CGFloat)_uniformEstimatedRowHeight
 {
-	NSString *identifier = cell.reuseIdentifier;
+	return _tableFlags.delegateTableViewEstimatedHeightForRowAtIndexPath ? 0.0 : round(MAX(_estimatedRowHeight, 0.0));
+}
+
+/**
+ * @brief Geometry for a row that has not been laid out before
+ * 
+ * When estimating, the row gets its estimated height and is measured later.
+ * An index path object is only created if the delegate has to be asked.
+ */
+- (TUITableViewRowInfo)_rowInfoForRowAtPackedIndexPath:(TUIPackedIndexPath)indexPath
+{
+	TUITableViewRowInfo info;
+	if(_tableFlags.delegateTableViewEstimatedHeightForRowAtIndexPath) {
+		info.height = round([self.delegate tableView:self estimatedHeightForRowAtIndexPath:[TUIFastIndexPath indexPathWithPackedIndexPath:indexPath]]);
+		info.estimated = YES;
+	} else if(_estimatedRowHeight > 0.0) {
+		info.height = round(_estimatedRowHeight);
+		info.estimated = YES;
+	} else {
+		info.height = round([self.delegate tableView:self heightForRowAtIndexPath:[TUIFastIndexPath indexPathWithPackedIndexPath:indexPath]]);
+		info.estimated = NO;
+	}
+	return info;
+}
+
+/**
+ * @brief Replace the estimated heights of some rows with measured ones
+ * 
+ * The content size is corrected and the topmost visible row keeps its position
+ * in the viewport, even when rows above it changed height.
+ * 
+ * @param indexPaths rows to measure; rows that are no longer estimated are skipped
+ * @param heights heights already measured for @p indexPaths, or nil to ask the delegate
+ * @return YES if any row was measured
+ */
+- (BOOL)_measureEstimatedRowsAtIndexPaths:(NSArray *)indexPaths heights:(NSArray *)heights
+{
+	CGRect visible = [self visibleRect];
+	TUIPackedIndexPath anchorIndexPath = [self _packedIndexPathForRowAtVerticalOffset:CGRectGetMaxY(visible)];
+	CGFloat anchorOffset = 0.0;
+	if(anchorIndexPath != TUIPackedIndexPathNotFound) {
+		anchorOffset = [[_sectionInfo objectAtIndex:TUIPackedIndexPathSection(anchorIndexPath)] tableRowOffset:TUIPackedIndexPathRow(anchorIndexPath)];
+	}
+	CGFloat topDistance = self.contentSize.height + self.contentOffset.y;
 	
-	if(!identifier)
-		return;
+	BOOL measured = NO;
+	NSUInteger index = 0;
+	for(TUIFastIndexPath *i in indexPaths) {
+		TUITableViewSection *section = (i.section < [_sectionInfo count]) ? [_sectionInfo objectAtIndex:i.section] : nil;
+		if([section rowHeightIsEstimated:i.row]) {
+			CGFloat h = (heights != nil) ? [[heights objectAtIndex:index] doubleValue] : [self.delegate tableView:self heightForRowAtIndexPath:i];
+			[section _setHeight:round(h) estimated:NO forRow:i.row];
+			measured = YES;
+		}
+		++index;
+	}
 	
-	NSMutableArray *array = [_reusableTableCells objectForKey:identifier];
-	if(!array) {
-		array = [[NSMutableArray alloc] init];
-		[_reusableTableCells setObject:array forKey:identifier];
+	if(measured) {
+		[self _updateSectionOffsets];
+		self.contentSize = CGSizeMake(self.bounds.size.width, _contentHeight);
+		if(anchorIndexPath != TUIPackedIndexPathNotFound) {
+			CGFloat newAnchorOffset = [[_sectionInfo objectAtIndex:TUIPackedIndexPathSection(anchorIndexPath)] tableRowOffset:TUIPackedIndexPathRow(anchorIndexPath)];
+			topDistance += newAnchorOffset - anchorOffset;
+		}
+		self.contentOffset = CGPointMake(self.contentOffset.x, topDistance - _contentHeight);
 	}
-	[array addObject:cell];
+	
+	return measured;
 }
 
-- (__kindof TUITableViewCell *)dequeueReusableCellWithIdentifier:(NSString *)identifier
+/**
+ * @brief Measure every estimated row within half a viewport of the visible rect
+ * 
+ * Measuring moves the rows below, so this repeats until the area around the
+ * viewport is covered by measured rows.
+ * 
+ * @return YES if any row changed geometry
+ */
+- (BOOL)_measureEstimatedRowsNearVisibleRect
 {
-	if(!identifier)
-		return nil;
+	if(![self _estimatesRowHeights] || _sectionInfo == nil)
+		return NO;
 	
-	NSMutableArray *array = [_reusableTableCells objectForKey:identifier];
-	if(array) {
-		TUITableViewCell *c = [array lastObject];
-		if(c) {
-			[array removeLastObject];
-			[c prepareForReuse];
-			return c;
-		}
+	BOOL measured = NO;
+	for(NSUInteger pass = 0; pass < 8; ++pass) {
+		CGRect visible = [self visibleRect];
+		visible = TUIEdgeInsetsInsetRect(visible, TUIEdgeInsetsInvert(self.safeAreaInsets));
+		CGRect area = CGRectInset(visible, 0, -round(visible.size.height / 2));
+		
+		NSMutableArray *estimatedIndexPaths = [NSMutableArray array];
+		CGFloat contentHeight = _contentHeight;
+		[self _enumerateRowsFromContentOffset:contentHeight - CGRectGetMaxY(area) toContentOffset:contentHeight - CGRectGetMinY(area) usingBlock:^(NSUInteger section, NSUInteger row, CGFloat offset, CGFloat height, BOOL *stop) {
+			if([(TUITableViewSection *)[self->_sectionInfo objectAtIndex:section] rowHeightIsEstimated:row]) {
+				[estimatedIndexPaths addObject:[TUIFastIndexPath indexPathForRow:row inSection:section]];
+			}
+		}];
+		
+		if(![self _measureEstimatedRowsAtIndexPaths:estimatedIndexPaths heights:nil])
+			break;
+		measured = YES;
 	}
+	
+	return measured;
+}
 
-    Class cellClass = _reusableCellClasses[identifier];
-    if ([cellClass isSubclassOfClass:TUITableViewCell.class]) {
-        return [[cellClass alloc] initWithStyle:TUITableViewCellStyleDefault reuseIdentifier:identifier];
-    }
+#pragma mark -
 
-	return nil;
+- (void)registerClass:(nullable Class)cellClass forCellReuseIdentifier:(NSString *)identifier {
+    [_reusePool registerClass:cellClass forIdentifier:identifier];
+}
+
+- (void)_enqueueReusableCell:(TUITableViewCell *)cell
+{
+	[_reusePool enqueueCell:cell];
+}
+
+- (__kindof TUITableViewCell *)dequeueReusableCellWithIdentifier:(NSString *)identifier
+{
+	return [_reusePool dequeueCellWithIdentifier:identifier];
+}
+
+- (TUITableViewCellReusePool *)reusePool
+{
+	return _reusePool;
+}
+
+- (void)prewarmReusableCellsWithIdentifier:(NSString *)identifier
+{
+	CGFloat visibleHeight = self.bounds.size.height;
+	CGFloat rowHeight = 0.0;
+	
+	// average the rows on screen, if any, otherwise fall back to the estimate
+	NSArray *visibleCells = [_visibleItems allCells];
+	if([visibleCells count] > 0) {
+		for(TUITableViewCell *cell in visibleCells)
+			rowHeight += cell.frame.size.height;
+		rowHeight /= [visibleCells count];
+	} else {
+		rowHeight = self.estimatedRowHeight;
+	}
+	
+	if(visibleHeight <= 0.0 || rowHeight <= 0.0)
+		return;
+	
+	// one extra for the row that's partially scrolled in
+	NSUInteger count = (NSUInteger)ceil(visibleHeight / rowHeight) + 1;
+	[_reusePool prewarmCellsWithIdentifier:identifier count:count];
 }
 
 /**
@@ -370,12 +684,12 @@ typedef struct {
 
 - (__kindof TUITableViewCell *)cellForRowAtIndexPath:(TUIFastIndexPath *)indexPath // returns nil if cell is not visible or index path is out of range
 {
-	return [_visibleItems objectForKey:indexPath];
+	return (indexPath != nil) ? [_visibleItems cellForIndexPath:indexPath.packedIndexPath] : nil;
 }
 
 - (NSArray *)visibleCells
 {
-	return [_visibleItems allValues];
+	return [_visibleItems allCells];
 }
 
 static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
@@ -395,7 +709,7 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 	}];
 }
 
-#define INDEX_PATHS_FOR_VISIBLE_ROWS [_visibleItems allKeys]
+#define INDEX_PATHS_FOR_VISIBLE_ROWS [_visibleItems allIndexPaths] // sorted
 
 - (NSArray *)indexPathsForVisibleRows
 {
@@ -404,12 +718,8 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 
 - (TUIFastIndexPath *)indexPathForCell:(TUITableViewCell *)c
 {
-	for(TUIFastIndexPath *i in _visibleItems) {
-		TUITableViewCell *cell = [_visibleItems objectForKey:i];
-		if(cell == c)
-			return i;
-	}
-	return nil;
+	TUIPackedIndexPath indexPath = [_visibleItems indexPathForCell:c];
+	return (indexPath != TUIPackedIndexPathNotFound) ? [TUIFastIndexPath indexPathWithPackedIndexPath:indexPath] : nil;
 }
 
 /**
@@ -450,23 +760,86 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 	return indexes;
 }
 
+/**
+ * @brief Obtain the index of the section containing an offset from the top of the content
+ * 
+ * Sections are ordered by offset, so this is a binary search.  Offsets above
+ * the first section resolve to section 0.
+ * 
+ * @param offset offset from the top of the table content
+ * @return section index, or NSNotFound if there are no sections
+ */
+- (NSUInteger)_sectionIndexAtContentOffset:(CGFloat)offset
+{
+	NSUInteger count = [_sectionInfo count];
+	if(count == 0)
+		return NSNotFound;
+	
+	NSUInteger low = 0;
+	NSUInteger high = count - 1;
+	while(low < high) {
+		NSUInteger mid = (low + high + 1) / 2;
+		if([(TUITableViewSection *)[_sectionInfo objectAtIndex:mid] sectionOffset] < offset) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return low;
+}
+
+/**
+ * @brief Enumerate the rows overlapping a vertical span of the table content
+ * 
+ * Offsets are measured from the top of the table content.  The first row is
+ * found with a logarithmic search; only the rows up to @p bottomOffset are
+ * visited after that.  Rows are visited top to bottom.
+ */
+- (void)_enumerateRowsFromContentOffset:(CGFloat)topOffset toContentOffset:(CGFloat)bottomOffset usingBlock:(void (^)(NSUInteger section, NSUInteger row, CGFloat offset, CGFloat height, BOOL *stop))block
+{
+	NSUInteger sectionCount = [_sectionInfo count];
+	NSUInteger sectionIndex = [self _sectionIndexAtContentOffset:topOffset];
+	if(sectionIndex == NSNotFound)
+		return;
+	
+	BOOL stop = NO;
+	BOOL firstSection = YES;
+	for(; sectionIndex < sectionCount; ++sectionIndex) {
+		TUITableViewSection *section = [_sectionInfo objectAtIndex:sectionIndex];
+		if(section.sectionOffset >= bottomOffset)
+			break;
+		
+		NSUInteger numberOfRows = [section numberOfRows];
+		NSUInteger row = firstSection ? [section rowAtSectionOffset:topOffset - section.sectionOffset] : 0;
+		firstSection = NO;
+		if(row >= numberOfRows)
+			continue;
+		
+		CGFloat offset = [section tableRowOffset:row];
+		for(; row < numberOfRows && offset < bottomOffset; ++row) {
+			CGFloat height = [section rowHeight:row];
+			block(sectionIndex, row, offset, height, &stop);
+			if(stop)
+				return;
+			offset += height;
+		}
+	}
+}
+
 - (NSArray *)indexPathsForRowsInRect:(CGRect)rect
 {
 	NSMutableArray *indexPaths = [NSMutableArray arrayWithCapacity:50];
-	NSInteger sectionIndex = 0;
-	for(TUITableViewSection *section in _sectionInfo) {
-		NSInteger numberOfRows = [section numberOfRows];
-		for(NSInteger row = 0; row < numberOfRows; ++row) {
-			TUIFastIndexPath *indexPath = [TUIFastIndexPath indexPathForRow:row inSection:sectionIndex];
-			CGRect cellRect = [self rectForRowAtIndexPath:indexPath];
-			if(CGRectIntersectsRect(cellRect, rect)) {
-				[indexPaths addObject:indexPath];
-			} else {
-				// not visible
-			}
+	if(CGRectIsNull(rect))
+		return indexPaths;
+	
+	CGFloat width = self.bounds.size.width;
+	CGFloat contentHeight = _contentHeight;
+	[self _enumerateRowsFromContentOffset:contentHeight - CGRectGetMaxY(rect) toContentOffset:contentHeight - CGRectGetMinY(rect) usingBlock:^(NSUInteger section, NSUInteger row, CGFloat offset, CGFloat height, BOOL *stop) {
+		CGRect cellRect = CGRectMake(0, contentHeight - offset - height, width, height);
+		if(CGRectIntersectsRect(cellRect, rect)) {
+			[indexPaths addObject:[TUIFastIndexPath indexPathForRow:row inSection:section]];
 		}
-		++sectionIndex;
-	}
+	}];
 	return indexPaths;
 }
 
@@ -480,18 +853,11 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
  * @return index path of the row at @p point
  */
 - (TUIFastIndexPath *)indexPathForRowAtPoint:(CGPoint)point {
-  
-	NSInteger sectionIndex = 0;
-  for(TUITableViewSection *section in _sectionInfo){
-    for(NSInteger row = 0; row < [section numberOfRows]; row++){
-      TUIFastIndexPath *indexPath = [TUIFastIndexPath indexPathForRow:row inSection:sectionIndex];
-      CGRect cellRect = [self rectForRowAtIndexPath:indexPath];
-      if(CGRectContainsPoint(cellRect, point)){
-        return indexPath;
-      }
-    }
-		++sectionIndex;
-  }
+	
+	TUIFastIndexPath *indexPath = [self indexPathForRowAtVerticalOffset:point.y];
+	if(indexPath != nil && CGRectContainsPoint([self rectForRowAtIndexPath:indexPath], point)) {
+		return indexPath;
+	}
 	
 	return nil;
 }
@@ -506,20 +872,25 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
  * @return index path of the row at @p offset
  */
 - (TUIFastIndexPath *)indexPathForRowAtVerticalOffset:(CGFloat)offset {
-  
-	NSInteger sectionIndex = 0;
-  for(TUITableViewSection *section in _sectionInfo){
-    for(NSInteger row = 0; row < [section numberOfRows]; row++){
-      TUIFastIndexPath *indexPath = [TUIFastIndexPath indexPathForRow:row inSection:sectionIndex];
-      CGRect cellRect = [self rectForRowAtIndexPath:indexPath];
-      if(offset >= cellRect.origin.y && offset <= (cellRect.origin.y + cellRect.size.height)){
-        return indexPath;
-      }
-    }
-		++sectionIndex;
-  }
 	
-	return nil;
+	TUIPackedIndexPath indexPath = [self _packedIndexPathForRowAtVerticalOffset:offset];
+	return (indexPath != TUIPackedIndexPathNotFound) ? [TUIFastIndexPath indexPathWithPackedIndexPath:indexPath] : nil;
+}
+
+- (TUIPackedIndexPath)_packedIndexPathForRowAtVerticalOffset:(CGFloat)offset
+{
+	__block TUIPackedIndexPath indexPath = TUIPackedIndexPathNotFound;
+	CGFloat contentOffset = _contentHeight - offset;
+	// a row's frame is closed at both ends here, so look one point either side
+	// of the boundary; the topmost row containing the offset wins
+	[self _enumerateRowsFromContentOffset:contentOffset toContentOffset:contentOffset + 1.0 usingBlock:^(NSUInteger section, NSUInteger row, CGFloat rowOffset, CGFloat height, BOOL *stop) {
+		if(contentOffset >= rowOffset && contentOffset <= rowOffset + height) {
+			indexPath = TUIPackedIndexPathMake(section, row);
+			*stop = YES;
+		}
+	}];
+	
+	return indexPath;
 }
 
 /**
@@ -609,31 +980,74 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
  * @param block the block to enumerate with
  */
 - (void)enumerateIndexPathsFromIndexPath:(TUIFastIndexPath *)fromIndexPath toIndexPath:(TUIFastIndexPath *)toIndexPath withOptions:(NSEnumerationOptions)options usingBlock:(void (^)(TUIFastIndexPath *indexPath, BOOL *stop))block {
-  NSInteger sectionLowerBound = (fromIndexPath != nil) ? fromIndexPath.section : 0;
-  NSInteger sectionUpperBound = (toIndexPath != nil) ? toIndexPath.section : [self numberOfSections] - 1;
-  NSInteger rowLowerBound = (fromIndexPath != nil) ? fromIndexPath.row : 0;
-  NSInteger rowUpperBound = (toIndexPath != nil) ? toIndexPath.row : -1;
+  // walk packed index paths, only the ones handed to the block are boxed
+  TUIPackedIndexPath from = (fromIndexPath != nil) ? fromIndexPath.packedIndexPath : TUIPackedIndexPathMake(0, 0);
+  TUIPackedIndexPath to = (toIndexPath != nil) ? toIndexPath.packedIndexPath : TUIPackedIndexPathNotFound;
+  [self _enumeratePackedIndexPathsFrom:from to:to usingBlock:^(TUIPackedIndexPath indexPath, BOOL *stop) {
+    block([TUIFastIndexPath indexPathWithPackedIndexPath:indexPath], stop);
+  }];
   
-  NSInteger irow = rowLowerBound; // start at the lower bound row for the first iteration...
-  for(NSInteger i = sectionLowerBound; i < [self numberOfSections] && i <= sectionUpperBound /* inclusive */; i++){
-    NSInteger rowCount = [self numberOfRowsInSection:i];
-    for(NSInteger j = irow; j < rowCount && j <= ((rowUpperBound < 0 || i < sectionUpperBound) ? rowCount - 1 : rowUpperBound) /* inclusive */; j++){
+}
+
+/**
+ * @brief Enumerate the valid index paths between two bounds, both inclusive
+ */
+- (void)_enumeratePackedIndexPathsFrom:(TUIPackedIndexPath)from to:(TUIPackedIndexPath)to usingBlock:(void (^)(TUIPackedIndexPath indexPath, BOOL *stop))block {
+  NSUInteger sectionCount = [_sectionInfo count];
+  NSUInteger row = TUIPackedIndexPathRow(from); // start at the lower bound row for the first iteration...
+  for(NSUInteger section = TUIPackedIndexPathSection(from); section < sectionCount; section++){
+    NSUInteger rowCount = [(TUITableViewSection *)[_sectionInfo objectAtIndex:section] numberOfRows];
+    for(; row < rowCount; row++){
+      TUIPackedIndexPath indexPath = TUIPackedIndexPathMake(section, row);
+      if(indexPath > to) return; // inclusive
       BOOL stop = NO;
-      block([TUIFastIndexPath indexPathForRow:j inSection:i], &stop);
+      block(indexPath, &stop);
       if(stop) return;
     }
-    irow = 0; // ...then use zero for subsequent iterations
+    row = 0; // ...then use zero for subsequent iterations
+  }
+  
+}
+
+/**
+ * @brief Enumerate the valid index paths from @p from to @p to that aren't between @p excludedFrom and @p excludedTo
+ * 
+ * All bounds are inclusive, and either range may be TUIPackedIndexPathNotFound
+ * for an empty one.  Only the rows outside the excluded range are visited.
+ */
+- (void)_enumeratePackedIndexPathsFrom:(TUIPackedIndexPath)from to:(TUIPackedIndexPath)to excludingFrom:(TUIPackedIndexPath)excludedFrom to:(TUIPackedIndexPath)excludedTo usingBlock:(void (^)(TUIPackedIndexPath indexPath))block {
+  if(from == TUIPackedIndexPathNotFound)
+    return;
+  if(excludedFrom == TUIPackedIndexPathNotFound){
+    [self _enumeratePackedIndexPathsFrom:from to:to usingBlock:^(TUIPackedIndexPath indexPath, BOOL *stop) {
+      block(indexPath);
+    }];
+    return;
+  }
+  
+  // before the excluded range...
+  if(from < excludedFrom){
+    [self _enumeratePackedIndexPathsFrom:from to:to usingBlock:^(TUIPackedIndexPath indexPath, BOOL *stop) {
+      if(indexPath >= excludedFrom){
+        *stop = YES;
+        return;
+      }
+      block(indexPath);
+    }];
+  }
+  // ...and after it
+  if(to > excludedTo){
+    [self _enumeratePackedIndexPathsFrom:MAX(from, excludedTo) to:to usingBlock:^(TUIPackedIndexPath indexPath, BOOL *stop) {
+      if(indexPath > excludedTo)
+        block(indexPath);
+    }];
   }
   
 }
 
 - (TUIFastIndexPath *)_topVisibleIndexPath
 {
-	TUIFastIndexPath *topVisibleIndex = nil;
-	NSArray *v = [INDEX_PATHS_FOR_VISIBLE_ROWS sortedArrayUsingSelector:@selector(compare:)];
-	if([v count])
-		topVisibleIndex = [v objectAtIndex:0];
-	return topVisibleIndex;
+	return [self indexPathForFirstVisibleRow];
 }
 
 - (void)setFrame:(CGRect)f
@@ -694,9 +1108,8 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 				_keepVisibleIndexPathForReload = nil;
 			}else if(_tableFlags.forceSaveScrollPosition || [self.nsView inLiveResize]) {
 				_tableFlags.forceSaveScrollPosition = 0;
-				NSArray *a = [INDEX_PATHS_FOR_VISIBLE_ROWS sortedArrayUsingSelector:@selector(compare:)];
-				if([a count]) {
-					savedIndexPath = [a objectAtIndex:0];
+				savedIndexPath = [self indexPathForFirstVisibleRow];
+				if(savedIndexPath) {
 					CGRect v = [self visibleRect];
 					CGRect r = [self rectForRowAtIndexPath:savedIndexPath];
 					relativeOffset = ((v.origin.y + v.size.height) - (r.origin.y + r.size.height));
@@ -742,10 +1155,21 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
             }
         }
 		
+		[self _measureEstimatedRowsNearVisibleRect];
+		_tableFlags.needsCellRelayout = 0;
+		
 		return YES; // needs visible cells to be redisplayed
 	}
 	
-	return NO; // just need to do the recycling
+	// rows coming into view trade their estimated height for a measured one,
+	// which moves every row below them
+	BOOL needsCellRelayout = _tableFlags.needsCellRelayout;
+	_tableFlags.needsCellRelayout = 0;
+	if([self _measureEstimatedRowsNearVisibleRect]) {
+		needsCellRelayout = YES;
+	}
+	
+	return needsCellRelayout; // if NO, just need to do the recycling
 }
 
 /**
@@ -821,99 +1245,166 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 	
 }
 
+/**
+ * @brief The first and last rows intersecting @p rect
+ * 
+ * Both are TUIPackedIndexPathNotFound if no row does.
+ */
+- (void)_packedIndexPathRangeForRowsInRect:(CGRect)rect first:(TUIPackedIndexPath *)first last:(TUIPackedIndexPath *)last
+{
+	__block TUIPackedIndexPath firstIndexPath = TUIPackedIndexPathNotFound;
+	__block TUIPackedIndexPath lastIndexPath = TUIPackedIndexPathNotFound;
+	if(!CGRectIsNull(rect)) {
+		CGFloat width = self.bounds.size.width;
+		CGFloat contentHeight = _contentHeight;
+		[self _enumerateRowsFromContentOffset:contentHeight - CGRectGetMaxY(rect) toContentOffset:contentHeight - CGRectGetMinY(rect) usingBlock:^(NSUInteger section, NSUInteger row, CGFloat offset, CGFloat height, BOOL *stop) {
+			CGRect cellRect = CGRectMake(0, contentHeight - offset - height, width, height);
+			if(CGRectIntersectsRect(cellRect, rect)) {
+				lastIndexPath = TUIPackedIndexPathMake(section, row);
+				if(firstIndexPath == TUIPackedIndexPathNotFound)
+					firstIndexPath = lastIndexPath;
+			}
+		}];
+	}
+	*first = firstIndexPath;
+	*last = lastIndexPath;
+}
+
+/**
+ * @brief Number of rows from @p from to @p to, both inclusive
+ */
+- (NSUInteger)_numberOfRowsFromPackedIndexPath:(TUIPackedIndexPath)from toPackedIndexPath:(TUIPackedIndexPath)to
+{
+	if(from == TUIPackedIndexPathNotFound || to == TUIPackedIndexPathNotFound || to < from)
+		return 0;
+	
+	NSUInteger fromSection = TUIPackedIndexPathSection(from);
+	NSUInteger toSection = TUIPackedIndexPathSection(to);
+	if(fromSection == toSection)
+		return TUIPackedIndexPathRow(to) - TUIPackedIndexPathRow(from) + 1;
+	
+	NSUInteger sectionCount = [_sectionInfo count];
+	NSUInteger count = 0;
+	if(fromSection < sectionCount)
+		count += [(TUITableViewSection *)[_sectionInfo objectAtIndex:fromSection] numberOfRows] - TUIPackedIndexPathRow(from);
+	for(NSUInteger s = fromSection + 1; s < toSection && s < sectionCount; ++s)
+		count += [(TUITableViewSection *)[_sectionInfo objectAtIndex:s] numberOfRows];
+	return count + TUIPackedIndexPathRow(to) + 1;
+}
+
+- (void)_addCellForRowAtPackedIndexPath:(TUIPackedIndexPath)indexPath
+{
+	TUIFastIndexPath *i = [TUIFastIndexPath indexPathWithPackedIndexPath:indexPath];
+	TUITableViewCell *cell = [_dataSource tableView:self cellForRowAtIndexPath:i];
+	[self.nsView invalidateHoverForView:cell];
+	
+	cell.frame = [self _rectForRowAtPackedIndexPath:indexPath];
+	cell.layer.zPosition = 0;
+	
+	[cell setNeedsLayout];
+	[cell prepareForDisplay];
+	
+	if([i isEqual:_selectedIndexPath]) {
+		[cell setSelected:YES animated:NO];
+	} else {
+		[cell setSelected:NO animated:NO];
+	}
+	
+	if(_tableFlags.delegateTableViewWillDisplayCellForRowAtIndexPath) {
+		[_delegate tableView:self willDisplayCell:cell forRowAtIndexPath:i];
+	}
+	
+	[self addSubview:cell];
+	
+	if([_indexPathShouldBeFirstResponder isEqual:i]) {
+	  // only make cells first responder if they accept it
+	  if([cell acceptsFirstResponder]){
+	    [self.nsWindow makeFirstResponderIfNotAlreadyInResponderChain:cell withFutureRequestToken:_futureMakeFirstResponderToken];
+	  }
+		_indexPathShouldBeFirstResponder = nil;
+	}
+	
+	[_visibleItems setCell:cell forIndexPath:indexPath];
+}
+
+- (void)_removeCellForRowAtPackedIndexPath:(TUIPackedIndexPath)indexPath
+{
+	TUITableViewCell *cell = [_visibleItems cellForIndexPath:indexPath];
+	// don't reuse the dragged cell
+	if(_dragToReorderCell != nil && [cell isEqual:_dragToReorderCell])
+		return;
+	
+	[self _enqueueReusableCell:cell];
+	[cell removeFromSuperview];
+	[_visibleItems removeCellForIndexPath:indexPath];
+	
+	if(_tableFlags.delegateTableViewDidEndDisplayingCellForRowAtIndexPath) {
+		[_delegate tableView:self didEndDisplayingCell:cell forRowAtIndexPath:[TUIFastIndexPath indexPathWithPackedIndexPath:indexPath]];
+	}
+}
+
 - (void)_layoutCells:(BOOL)visibleCellsNeedRelayout
 {
   
 	if(visibleCellsNeedRelayout) {
 		// update remaining visible cells if needed
-		for(TUIFastIndexPath *i in _visibleItems) {
-			TUITableViewCell *cell = [_visibleItems objectForKey:i];
-			cell.frame = [self rectForRowAtIndexPath:i];
+		[_visibleItems enumerateCellsWithOptions:0 usingBlock:^(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop) {
+			cell.frame = [self _rectForRowAtPackedIndexPath:indexPath];
 			cell.layer.zPosition = 0;
 			[cell setNeedsLayout];
-		}
+		}];
 	}
 	
 	CGRect visible = [self visibleRect];
     visible = TUIEdgeInsetsInsetRect(visible, TUIEdgeInsetsInvert(self.safeAreaInsets));
 	
-	// Example:
+	// Visible rows are one contiguous run of index paths, so the diff is the
+	// difference of two intervals:
 	// old:            0 1 2 3 4 5 6 7
 	// new:                2 3 4 5 6 7 8 9
 	// to remove:      0 1
 	// to add:                         8 9
 	
-	NSArray *oldVisibleIndexPaths = INDEX_PATHS_FOR_VISIBLE_ROWS;
-	NSArray *newVisibleIndexPaths = [self indexPathsForRowsInRect:visible];
-	
-	NSMutableArray *indexPathsToRemove = [oldVisibleIndexPaths mutableCopy];
-	[indexPathsToRemove removeObjectsInArray:newVisibleIndexPaths];
-    
-    BOOL enqueueReversly = NO;
-    if (indexPathsToRemove.lastObject == oldVisibleIndexPaths.lastObject) {
-        enqueueReversly = YES;
-    }
+	TUIPackedIndexPath newFirst, newLast;
+	[self _packedIndexPathRangeForRowsInRect:visible first:&newFirst last:&newLast];
+	TUIPackedIndexPath oldFirst = _visibleItems.firstIndexPath;
+	TUIPackedIndexPath oldLast = _visibleItems.lastIndexPath;
 	
-	NSMutableArray *indexPathsToAdd = [newVisibleIndexPaths mutableCopy];
-	[indexPathsToAdd removeObjectsInArray:oldVisibleIndexPaths];
+	// a kept drag cell or a batch update can leave holes in the old run, then every new row is checked
+	BOOL oldRunIsComplete = ([_visibleItems count] > 0 && [_visibleItems count] == [self _numberOfRowsFromPackedIndexPath:oldFirst toPackedIndexPath:oldLast]);
 	
-    NSEnumerator * removeEnumerator = enqueueReversly ? [indexPathsToRemove reverseObjectEnumerator] : [indexPathsToRemove objectEnumerator];
-    
-	// remove offscreen cells
-    for(TUIFastIndexPath *i in removeEnumerator) {
-        TUITableViewCell *cell = [self cellForRowAtIndexPath:i];
-        // don't reuse the dragged cell
-        if(_dragToReorderCell == nil || ![cell isEqual:_dragToReorderCell]){
-            [self _enqueueReusableCell:cell];
-            [cell removeFromSuperview];
-            [_visibleItems removeObjectForKey:i];
-            
-            if (_tableFlags.delegateTableViewDidEndDisplayingCellForRowAtIndexPath) {
-                [_delegate tableView:self didEndDisplayingCell:cell forRowAtIndexPath:i];
-            }
-        }
-    }
+	// remove offscreen cells from the outside in, so that the cell nearest to the
+	// viewport is dequeued first (FILO); when the bottom of the old run goes, walk
+	// everything bottom up
+	if(oldLast != TUIPackedIndexPathNotFound && (newLast == TUIPackedIndexPathNotFound || oldLast > newLast)) {
+		for(TUIPackedIndexPath i = oldLast; i != TUIPackedIndexPathNotFound && (newLast == TUIPackedIndexPathNotFound || i > newLast); i = [_visibleItems indexPathBeforeIndexPath:i])
+			[self _removeCellForRowAtPackedIndexPath:i];
+		if(newFirst != TUIPackedIndexPathNotFound) {
+			for(TUIPackedIndexPath i = [_visibleItems indexPathBeforeIndexPath:newFirst]; i != TUIPackedIndexPathNotFound; i = [_visibleItems indexPathBeforeIndexPath:i])
+				[self _removeCellForRowAtPackedIndexPath:i];
+		}
+	} else if(newFirst != TUIPackedIndexPathNotFound) {
+		for(TUIPackedIndexPath i = oldFirst; i != TUIPackedIndexPathNotFound && i < newFirst; i = [_visibleItems indexPathAfterIndexPath:i])
+			[self _removeCellForRowAtPackedIndexPath:i];
+	}
 	
-	// add new cells
-	for(TUIFastIndexPath *i in indexPathsToAdd) {
-		if([_visibleItems objectForKey:i]) {
-			NSLog(@"!!! Warning: already have a cell in place for index path %@\n\n\n", i);
-		} else {
-			TUITableViewCell *cell = [_dataSource tableView:self cellForRowAtIndexPath:i];
-			[self.nsView invalidateHoverForView:cell];
-			
-			cell.frame = [self rectForRowAtIndexPath:i];
-			cell.layer.zPosition = 0;
-			
-			[cell setNeedsLayout];
-			[cell prepareForDisplay];
-			
-			if([i isEqual:_selectedIndexPath]) {
-				[cell setSelected:YES animated:NO];
-			} else {
-				[cell setSelected:NO animated:NO];
+	// add new cells: the new run minus the old one
+	__block BOOL addedCells = NO;
+	if(newFirst != TUIPackedIndexPathNotFound) {
+		[self _enumeratePackedIndexPathsFrom:newFirst to:newLast usingBlock:^(TUIPackedIndexPath indexPath, BOOL *stop) {
+			if(oldRunIsComplete && indexPath >= oldFirst && indexPath <= oldLast)
+				return;
+			if([self->_visibleItems cellForIndexPath:indexPath] == nil) {
+				[self _addCellForRowAtPackedIndexPath:indexPath];
+				addedCells = YES;
 			}
-			
-			if(_tableFlags.delegateTableViewWillDisplayCellForRowAtIndexPath) {
-				[_delegate tableView:self willDisplayCell:cell forRowAtIndexPath:i];
-			}
-			
-			[self addSubview:cell];
-			
-			if([_indexPathShouldBeFirstResponder isEqual:i]) {
-			  // only make cells first responder if they accept it
-			  if([cell acceptsFirstResponder]){
-			    [self.nsWindow makeFirstResponderIfNotAlreadyInResponderChain:cell withFutureRequestToken:_futureMakeFirstResponderToken];
-			  }
-				_indexPathShouldBeFirstResponder = nil;
-			}
-			
-			[_visibleItems setObject:cell forKey:i];
-		}
+		}];
 	}
 	
+	[self _updatePrefetchingForVisibleRect:visible];
+	
   // if we have a dragged cell, make sure it's on top of the newly added cells
-  if([indexPathsToAdd count] > 0 && _dragToReorderCell != nil){
+  if(addedCells && _dragToReorderCell != nil){
     [[_dragToReorderCell superview] bringSubviewToFront:_dragToReorderCell];
   }
   
@@ -983,22 +1474,17 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
   
 	// need to recycle all visible cells, have them be regenerated on layoutSubviews
 	// because the same cells might have different content
-    NSArray * visibleItems = [[_visibleItems allKeys] sortedArrayUsingComparator:^NSComparisonResult(id  _Nonnull obj1, id  _Nonnull obj2) {
-        return [obj1 compare:obj2];
-    }];
-    
     // enqueue reversly, so the order will be remained when dequeu (FILO).
-	for(TUIFastIndexPath *i in [visibleItems reverseObjectEnumerator]) {
-		TUITableViewCell *cell = [_visibleItems objectForKey:i];
+	[_visibleItems enumerateCellsWithOptions:NSEnumerationReverse usingBlock:^(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop) {
 		[self _enqueueReusableCell:cell];
 		[cell removeFromSuperview];
-	}
+	}];
 	
 	// if we have a dragged cell, clear it
 	_dragToReorderCell = nil;
 	
 	// clear visible cells
-	[_visibleItems removeAllObjects];
+	[_visibleItems removeAllCells];
 	
 	// remove any visible headers, they should be re-added when the table is laid out
 	for(TUITableViewSection *section in _sectionInfo){
@@ -1060,6 +1546,11 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 
 - (void)scrollToRowAtIndexPath:(TUIFastIndexPath *)indexPath atScrollPosition:(TUITableViewScrollPosition)scrollPosition animated:(BOOL)animated
 {
+	// scroll to where the row really is, not where its estimate puts it
+	if([self _estimatesRowHeights] && indexPath != nil && indexPath.section < [_sectionInfo count]) {
+		[self _measureEstimatedRowsAtIndexPaths:@[indexPath] heights:nil];
+	}
+	
 	CGRect v = [self visibleRect];
 	CGRect r = [self rectForRowAtIndexPath:indexPath];
 	
@@ -1167,24 +1658,14 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 
 - (TUIFastIndexPath *)indexPathForFirstVisibleRow 
 {
-	TUIFastIndexPath *firstIndexPath = nil;
-	for(TUIFastIndexPath *indexPath in _visibleItems) {
-		if(firstIndexPath == nil || [indexPath compare:firstIndexPath] == NSOrderedAscending) {
-			firstIndexPath = indexPath;
-		}
-	}
-	return firstIndexPath;
+	TUIPackedIndexPath indexPath = _visibleItems.firstIndexPath;
+	return (indexPath != TUIPackedIndexPathNotFound) ? [TUIFastIndexPath indexPathWithPackedIndexPath:indexPath] : nil;
 }
 
 - (TUIFastIndexPath *)indexPathForLastVisibleRow 
 {
-	TUIFastIndexPath *lastIndexPath = nil;
-	for(TUIFastIndexPath *indexPath in _visibleItems) {
-		if(lastIndexPath == nil || [indexPath compare:lastIndexPath] == NSOrderedDescending) {
-			lastIndexPath = indexPath;
-		}
-	}
-	return lastIndexPath;
+	TUIPackedIndexPath indexPath = _visibleItems.lastIndexPath;
+	return (indexPath != TUIPackedIndexPathNotFound) ? [TUIFastIndexPath indexPathWithPackedIndexPath:indexPath] : nil;
 }
 
 - (void)selectPreviousRow:(NSEvent *)event
@@ -1281,6 +1762,424 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 	_tableFlags.maintainContentOffsetAfterReload = newValue;
 }
 
+#pragma mark - Prefetching
+
+- (void)_invalidateRowGeometryGeneration
+{
+	_rowGeometryGeneration++;
+	_firstPrefetchedIndexPath = TUIPackedIndexPathNotFound;
+	_lastPrefetchedIndexPath = TUIPackedIndexPathNotFound;
+	[_backgroundMeasuringIndexPaths removeAllObjects];
+}
+
+/**
+ * @brief Tell the prefetch data source about rows approaching the viewport
+ * 
+ * The lookahead covers a screen beyond the viewport in the scroll direction,
+ * extended by the current throw velocity.  The rows in it are one contiguous
+ * run, so only its bounds are remembered: nothing is built while the run
+ * stays put, and otherwise only the rows entering or leaving it are boxed.
+ * Previously prefetched rows that are no longer ahead of the viewport (and
+ * haven't become visible) are cancelled.
+ */
+- (void)_updatePrefetchingForVisibleRect:(CGRect)visible
+{
+	id<TUITableViewDataSourcePrefetching> prefetchDataSource = _prefetchDataSource;
+	if(prefetchDataSource == nil || _sectionInfo == nil)
+		return;
+	
+	CGFloat topOffset = _contentHeight - CGRectGetMaxY(visible);
+	CGFloat bottomOffset = _contentHeight - CGRectGetMinY(visible);
+	CGFloat scrolled = topOffset - _lastPrefetchTopOffset;
+	_lastPrefetchTopOffset = topOffset;
+	
+	// positive towards the end of the table; a throw moves the content offset by -vy
+	CGFloat velocity = _throw.throwing ? -_throw.vy : 0.0;
+	CGFloat direction = (velocity != 0.0) ? velocity : scrolled;
+	if(direction == 0.0)
+		return; // not moving, nothing new is approaching
+	
+	CGFloat screen = visible.size.height;
+	CGFloat lookahead = MIN(screen + fabs(velocity) * PREFETCH_VELOCITY_LOOKAHEAD, screen * PREFETCH_MAX_SCREENS);
+	CGFloat from = (direction > 0.0) ? bottomOffset : topOffset - lookahead;
+	CGFloat to = (direction > 0.0) ? bottomOffset + lookahead : topOffset;
+	
+	__block TUIPackedIndexPath first = TUIPackedIndexPathNotFound;
+	__block TUIPackedIndexPath last = TUIPackedIndexPathNotFound;
+	[self _enumerateRowsFromContentOffset:from toContentOffset:to usingBlock:^(NSUInteger section, NSUInteger row, CGFloat offset, CGFloat height, BOOL *stop) {
+		if(offset + height > from && (offset >= bottomOffset || offset + height <= topOffset)) {
+			last = TUIPackedIndexPathMake(section, row);
+			if(first == TUIPackedIndexPathNotFound)
+				first = last;
+		}
+	}];
+	
+	TUIPackedIndexPath previousFirst = _firstPrefetchedIndexPath;
+	TUIPackedIndexPath previousLast = _lastPrefetchedIndexPath;
+	if(first == previousFirst && last == previousLast)
+		return;
+	_firstPrefetchedIndexPath = first;
+	_lastPrefetchedIndexPath = last;
+	
+	__block NSMutableArray *toCancel = nil;
+	if(_tableFlags.prefetchDataSourceCancelPrefetching) {
+		[self _enumeratePackedIndexPathsFrom:previousFirst to:previousLast excludingFrom:first to:last usingBlock:^(TUIPackedIndexPath indexPath) {
+			if([self->_visibleItems cellForIndexPath:indexPath] == nil) {
+				if(toCancel == nil)
+					toCancel = [NSMutableArray array];
+				[toCancel addObject:[TUIFastIndexPath indexPathWithPackedIndexPath:indexPath]];
+			}
+		}];
+	}
+	
+	__block NSMutableArray *toPrefetch = nil;
+	[self _enumeratePackedIndexPathsFrom:first to:last excludingFrom:previousFirst to:previousLast usingBlock:^(TUIPackedIndexPath indexPath) {
+		if(toPrefetch == nil)
+			toPrefetch = [NSMutableArray array];
+		[toPrefetch addObject:[TUIFastIndexPath indexPathWithPackedIndexPath:indexPath]];
+	}];
+	if(direction < 0.0) {
+		// nearest to the viewport first
+		for(NSUInteger i = 0, j = [toPrefetch count]; i + 1 < j; i++, j--)
+			[toPrefetch exchangeObjectAtIndex:i withObjectAtIndex:j - 1];
+	}
+	
+	if(toCancel != nil) {
+		[prefetchDataSource tableView:self cancelPrefetchingForRowsAtIndexPaths:toCancel];
+	}
+	if(toPrefetch != nil) {
+		[prefetchDataSource tableView:self prefetchRowsAtIndexPaths:toPrefetch];
+		[self _measureEstimatedRowsInBackground:toPrefetch];
+	}
+}
+
+/**
+ * @brief Measure estimated rows on a background queue
+ * 
+ * The heights come back on the main thread and are only merged if the rows
+ * haven't moved in the meantime (no reload or batched update happened).
+ */
+- (void)_measureEstimatedRowsInBackground:(NSArray *)indexPaths
+{
+	if(!_tableFlags.prefetchDataSourceHeightForRowInBackground || ![self _estimatesRowHeights])
+		return;
+	
+	NSMutableArray *pending = [NSMutableArray array];
+	for(TUIFastIndexPath *i in indexPaths) {
+		if([(TUITableViewSection *)[_sectionInfo objectAtIndex:i.section] rowHeightIsEstimated:i.row] && ![_backgroundMeasuringIndexPaths containsObject:i]) {
+			[pending addObject:i];
+		}
+	}
+	if([pending count] == 0)
+		return;
+	
+	[_backgroundMeasuringIndexPaths addObjectsFromArray:pending];
+	
+	// both blocks retain the table view, the main thread one is released last
+	id<TUITableViewDataSourcePrefetching> prefetchDataSource = _prefetchDataSource;
+	NSUInteger generation = _rowGeometryGeneration;
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+		NSMutableArray *heights = [NSMutableArray arrayWithCapacity:[pending count]];
+		for(TUIFastIndexPath *i in pending) {
+			[heights addObject:@([prefetchDataSource tableView:self heightForRowAtIndexPathInBackground:i])];
+		}
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[self _mergeBackgroundHeights:heights forIndexPaths:pending generation:generation];
+		});
+	});
+}
+
+- (void)_mergeBackgroundHeights:(NSArray *)heights forIndexPaths:(NSArray *)indexPaths generation:(NSUInteger)generation
+{
+	if(generation != _rowGeometryGeneration || _sectionInfo == nil)
+		return; // rows were reloaded or moved, these heights may belong to other rows now
+	
+	[_backgroundMeasuringIndexPaths minusSet:[NSSet setWithArray:indexPaths]];
+	
+	if([self _measureEstimatedRowsAtIndexPaths:indexPaths heights:heights]) {
+		_tableFlags.needsCellRelayout = 1;
+		[self setNeedsLayout];
+	}
+}
+
+#pragma mark - Batched Row Updates
+
+- (void)beginUpdates
+{
+	if(_updatesLevel++ == 0) {
+		_pendingDeletedIndexPaths = [NSMutableArray array];
+		_pendingInsertedIndexPaths = [NSMutableArray array];
+		_pendingReloadedIndexPaths = [NSMutableArray array];
+		_pendingMovedIndexPaths = [NSMutableDictionary dictionary];
+	}
+}
+
+- (void)endUpdates
+{
+	NSAssert(_updatesLevel > 0, @"-endUpdates without a matching -beginUpdates");
+	if(_updatesLevel > 0 && --_updatesLevel == 0) {
+		[self _applyPendingRowUpdates];
+	}
+}
+
+- (void)insertRowsAtIndexPaths:(NSArray *)indexPaths
+{
+	[self beginUpdates];
+	[_pendingInsertedIndexPaths addObjectsFromArray:indexPaths];
+	[self endUpdates];
+}
+
+- (void)deleteRowsAtIndexPaths:(NSArray *)indexPaths
+{
+	[self beginUpdates];
+	[_pendingDeletedIndexPaths addObjectsFromArray:indexPaths];
+	[self endUpdates];
+}
+
+- (void)reloadRowsAtIndexPaths:(NSArray *)indexPaths
+{
+	[self beginUpdates];
+	[_pendingReloadedIndexPaths addObjectsFromArray:indexPaths];
+	[self endUpdates];
+}
+
+- (void)moveRowAtIndexPath:(TUIFastIndexPath *)indexPath toIndexPath:(TUIFastIndexPath *)newIndexPath
+{
+	if(indexPath == nil || newIndexPath == nil)
+		return;
+	
+	[self beginUpdates];
+	[_pendingMovedIndexPaths setObject:indexPath forKey:newIndexPath];
+	[self endUpdates];
+}
+
+/**
+ * @brief Map a row through the removals and insertions made to its section
+ * 
+ * Surviving rows keep their relative order and fill the slots not taken by
+ * inserted rows.
+ * 
+ * @return the row after the update, or NSNotFound if it was removed
+ */
+static NSUInteger TUITableViewRowAfterUpdates(NSUInteger row, NSIndexSet *removed, NSIndexSet *inserted)
+{
+	if([removed containsIndex:row])
+		return NSNotFound;
+	
+	NSUInteger newRow = row - [removed countOfIndexesInRange:NSMakeRange(0, row)];
+	for(NSUInteger i = [inserted firstIndex]; i != NSNotFound && i <= newRow; i = [inserted indexGreaterThanIndex:i]) {
+		newRow++;
+	}
+	return newRow;
+}
+
+static TUIFastIndexPath *TUITableViewIndexPathAfterUpdates(TUIFastIndexPath *indexPath, NSArray *removedRows, NSArray *insertedRows, NSDictionary *movedRows)
+{
+	if(indexPath == nil || indexPath.section >= [removedRows count])
+		return nil;
+	
+	TUIFastIndexPath *movedIndexPath = [movedRows objectForKey:indexPath];
+	if(movedIndexPath != nil)
+		return movedIndexPath;
+	
+	NSUInteger row = TUITableViewRowAfterUpdates(indexPath.row, [removedRows objectAtIndex:indexPath.section], [insertedRows objectAtIndex:indexPath.section]);
+	return (row != NSNotFound) ? [TUIFastIndexPath indexPathForRow:row inSection:indexPath.section] : nil;
+}
+
+/**
+ * @brief Apply the batched row updates
+ * 
+ * Only the row geometry of the sections involved is spliced; the delegate is
+ * asked for the heights of inserted and reloaded rows only.  Visible cells of
+ * surviving rows are kept and re-keyed, and the topmost surviving visible row
+ * keeps its position in the viewport.
+ */
+- (void)_applyPendingRowUpdates
+{
+	NSArray *deleted = _pendingDeletedIndexPaths;
+	NSArray *inserted = _pendingInsertedIndexPaths;
+	NSArray *reloaded = _pendingReloadedIndexPaths;
+	NSDictionary *moved = _pendingMovedIndexPaths;
+	
+	_pendingDeletedIndexPaths = nil;
+	_pendingInsertedIndexPaths = nil;
+	_pendingReloadedIndexPaths = nil;
+	_pendingMovedIndexPaths = nil;
+	
+	if([deleted count] == 0 && [inserted count] == 0 && [reloaded count] == 0 && [moved count] == 0)
+		return;
+	
+	// nothing has been laid out yet, the next layout builds everything from scratch
+	if(_sectionInfo == nil) {
+		[self setNeedsLayout];
+		return;
+	}
+	
+	NSUInteger sectionCount = [_sectionInfo count];
+	NSInteger numberOfSections = 1;
+	if(_tableFlags.dataSourceNumberOfSectionsInTableView) {
+		numberOfSections = [_dataSource numberOfSectionsInTableView:self];
+	}
+	
+	BOOL valid = (numberOfSections == (NSInteger)sectionCount);
+	
+	NSMutableArray *removedRows = [NSMutableArray arrayWithCapacity:sectionCount];
+	NSMutableArray *insertedRows = [NSMutableArray arrayWithCapacity:sectionCount];
+	for(NSUInteger s = 0; s < sectionCount; ++s) {
+		[removedRows addObject:[NSMutableIndexSet indexSet]];
+		[insertedRows addObject:[NSMutableIndexSet indexSet]];
+	}
+	
+	NSMutableDictionary *movedRows = [NSMutableDictionary dictionaryWithCapacity:[moved count]]; // source -> destination
+	for(TUIFastIndexPath *i in deleted) {
+		if(i.section >= sectionCount) { valid = NO; break; }
+		[[removedRows objectAtIndex:i.section] addIndex:i.row];
+	}
+	for(TUIFastIndexPath *i in inserted) {
+		if(i.section >= sectionCount) { valid = NO; break; }
+		[[insertedRows objectAtIndex:i.section] addIndex:i.row];
+	}
+	for(TUIFastIndexPath *to in moved) {
+		TUIFastIndexPath *from = [moved objectForKey:to];
+		if(from.section >= sectionCount || to.section >= sectionCount) { valid = NO; break; }
+		[[removedRows objectAtIndex:from.section] addIndex:from.row];
+		[[insertedRows objectAtIndex:to.section] addIndex:to.row];
+		[movedRows setObject:to forKey:from];
+	}
+	
+	// splice the row geometry of every section that changed shape
+	TUITableViewRowInfo **newRowInfo = (TUITableViewRowInfo **)calloc(sectionCount, sizeof(TUITableViewRowInfo *));
+	NSUInteger *newRowCounts = (NSUInteger *)calloc(sectionCount, sizeof(NSUInteger));
+	
+	for(NSUInteger s = 0; valid && s < sectionCount; ++s) {
+		TUITableViewSection *section = [_sectionInfo objectAtIndex:s];
+		NSIndexSet *removed = [removedRows objectAtIndex:s];
+		NSIndexSet *added = [insertedRows objectAtIndex:s];
+		NSUInteger oldCount = [section numberOfRows];
+		NSUInteger newCount = oldCount - [removed count] + [added count];
+		
+		if(([removed count] > 0 && [removed lastIndex] >= oldCount) ||
+		   ([added count] > 0 && [added lastIndex] >= newCount) ||
+		   (NSUInteger)[_dataSource tableView:self numberOfRowsInSection:s] != newCount) {
+			valid = NO;
+			break;
+		}
+		
+		if([removed count] == 0 && [added count] == 0)
+			continue;
+		
+		TUITableViewRowInfo *rows = (TUITableViewRowInfo *)calloc(MAX(newCount, 1), sizeof(TUITableViewRowInfo));
+		NSUInteger oldRow = 0;
+		for(NSUInteger newRow = 0; newRow < newCount; ++newRow) {
+			if([added containsIndex:newRow])
+				continue; // filled in below
+			while([removed containsIndex:oldRow])
+				++oldRow;
+			rows[newRow] = [section _rowInfoAtIndex:oldRow];
+			++oldRow;
+		}
+		newRowInfo[s] = rows;
+		newRowCounts[s] = newCount;
+	}
+	
+	if(!valid) {
+		for(NSUInteger s = 0; s < sectionCount; ++s) {
+			if(newRowInfo[s]) free(newRowInfo[s]);
+		}
+		free(newRowInfo);
+		free(newRowCounts);
+		NSLog(@"!!! Warning: row updates do not match the data source, reloading table view %@", self);
+		[self reloadData];
+		return;
+	}
+	
+	for(TUIFastIndexPath *from in movedRows) {
+		TUIFastIndexPath *to = [movedRows objectForKey:from];
+		newRowInfo[to.section][to.row] = [[_sectionInfo objectAtIndex:from.section] _rowInfoAtIndex:from.row];
+	}
+	for(TUIFastIndexPath *i in inserted) {
+		newRowInfo[i.section][i.row] = [self _rowInfoForRowAtPackedIndexPath:i.packedIndexPath];
+	}
+	
+	// remember where the topmost surviving visible row is, so it can be kept in place
+	TUIFastIndexPath *anchorIndexPath = nil;
+	CGFloat anchorOffset = 0.0;
+	CGFloat topDistance = self.contentSize.height + self.contentOffset.y;
+	for(TUIFastIndexPath *i in INDEX_PATHS_FOR_VISIBLE_ROWS) {
+		TUIFastIndexPath *mapped = TUITableViewIndexPathAfterUpdates(i, removedRows, insertedRows, movedRows);
+		if(mapped != nil && [movedRows objectForKey:i] == nil) {
+			anchorIndexPath = mapped;
+			anchorOffset = [[_sectionInfo objectAtIndex:i.section] tableRowOffset:i.row];
+			break;
+		}
+	}
+	
+	for(NSUInteger s = 0; s < sectionCount; ++s) {
+		if(newRowInfo[s]) {
+			[[_sectionInfo objectAtIndex:s] _setRowInfo:newRowInfo[s] numberOfRows:newRowCounts[s]];
+		}
+	}
+	free(newRowInfo);
+	free(newRowCounts);
+	
+	NSMutableSet *reloadedIndexPaths = [NSMutableSet setWithCapacity:[reloaded count]];
+	for(TUIFastIndexPath *i in reloaded) {
+		TUIFastIndexPath *mapped = TUITableViewIndexPathAfterUpdates(i, removedRows, insertedRows, movedRows);
+		if(mapped != nil) {
+			TUITableViewRowInfo info = [self _rowInfoForRowAtPackedIndexPath:mapped.packedIndexPath];
+			[[_sectionInfo objectAtIndex:mapped.section] _setHeight:info.height estimated:info.estimated forRow:mapped.row];
+			[reloadedIndexPaths addObject:i];
+		}
+	}
+	
+	[self _updateSectionOffsets];
+	
+	// re-key surviving cells, recycle the ones for removed or reloaded rows
+	TUITableViewVisibleRows *visibleItems = [[TUITableViewVisibleRows alloc] init];
+	[_visibleItems enumerateCellsWithOptions:0 usingBlock:^(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop) {
+		TUIFastIndexPath *i = [TUIFastIndexPath indexPathWithPackedIndexPath:indexPath];
+		TUIFastIndexPath *mapped = TUITableViewIndexPathAfterUpdates(i, removedRows, insertedRows, movedRows);
+		if(mapped != nil && ![reloadedIndexPaths containsObject:i]) {
+			[visibleItems setCell:cell forIndexPath:mapped.packedIndexPath];
+		} else {
+			if(cell == self->_dragToReorderCell)
+				self->_dragToReorderCell = nil;
+			[self _enqueueReusableCell:cell];
+			[cell removeFromSuperview];
+			if(self->_tableFlags.delegateTableViewDidEndDisplayingCellForRowAtIndexPath) {
+				[self->_delegate tableView:self didEndDisplayingCell:cell forRowAtIndexPath:i];
+			}
+		}
+	}];
+	_visibleItems = visibleItems;
+	
+	[self _invalidateRowGeometryGeneration];
+	
+	_selectedIndexPath = TUITableViewIndexPathAfterUpdates(_selectedIndexPath, removedRows, insertedRows, movedRows);
+	_indexPathShouldBeFirstResponder = TUITableViewIndexPathAfterUpdates(_indexPathShouldBeFirstResponder, removedRows, insertedRows, movedRows);
+	
+	[TUIView setAnimationsEnabled:NO block:^{
+		[CATransaction begin];
+		[CATransaction setDisableActions:YES];
+		
+		[self->_visibleItems enumerateCellsWithOptions:0 usingBlock:^(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop) {
+			cell.frame = [self _rectForRowAtPackedIndexPath:indexPath];
+		}];
+		
+		self.contentSize = CGSizeMake(self.bounds.size.width, self->_contentHeight);
+		if(anchorIndexPath != nil) {
+			CGFloat newAnchorOffset = [[self->_sectionInfo objectAtIndex:anchorIndexPath.section] tableRowOffset:anchorIndexPath.row];
+			self.contentOffset = CGPointMake(self.contentOffset.x, topDistance + (newAnchorOffset - anchorOffset) - self->_contentHeight);
+		} else {
+			self.contentOffset = CGPointMake(self.contentOffset.x, topDistance - self->_contentHeight);
+		}
+		
+		[CATransaction commit];
+	}];
+	
+	[self layoutSubviews];
+}
+
 #pragma mark - Optimized Live Resizing Mode
 
 - (void)viewWillStartLiveResize
@@ -0,0 +1,71 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class TUITableViewCell;
+
+/**
+ Per-identifier pools of reusable table view cells.
+
+ Each pool holds at most its maximum count of cells; cells enqueued beyond that are discarded, so a live resize or a big reload can't leave thousands of idle cells behind.  Pools can be filled ahead of time with -prewarmCellsWithIdentifier:count:, which creates cells one at a time while the run loop is idle.
+ */
+@interface TUITableViewCellReusePool : NSObject
+
+/**
+ High-water mark for identifiers without their own maximum.  Default is NSUIntegerMax (unbounded).
+ */
+@property (nonatomic, assign) NSUInteger defaultMaximumCount;
+
+- (void)setMaximumCount:(NSUInteger)count forIdentifier:(NSString *)identifier;
+- (NSUInteger)maximumCountForIdentifier:(NSString *)identifier;
+
+/**
+ Number of cells currently waiting in the pool for @p identifier.
+ */
+- (NSUInteger)countForIdentifier:(NSString *)identifier;
+
+/**
+ Cells for identifiers with a registered class are created on demand when their pool is empty, and can be prewarmed.
+ */
+- (void)registerClass:(Class)cellClass forIdentifier:(NSString *)identifier;
+
+/**
+ Returns a pooled cell (after sending it -prepareForReuse) or, if the pool is empty, a new instance of the registered class.  Returns nil if neither is available.
+ */
+- (TUITableViewCell *)dequeueCellWithIdentifier:(NSString *)identifier;
+
+/**
+ Returns NO if the cell has no reuse identifier or its pool is full, in which case the cell is dropped.
+ */
+- (BOOL)enqueueCell:(TUITableViewCell *)cell;
+
+/**
+ Fill the pool for @p identifier up to @p count cells during idle time.  Requires a registered class.
+ */
+- (void)prewarmCellsWithIdentifier:(NSString *)identifier count:(NSUInteger)count;
+
+- (void)removeAllCells;
+
+// statistics
+@property (nonatomic, readonly) NSUInteger hitCount;       // dequeues served from the pool
+@property (nonatomic, readonly) NSUInteger missCount;      // dequeues that found the pool empty
+@property (nonatomic, readonly) NSUInteger discardCount;   // enqueues dropped at the high-water mark
+@property (nonatomic, readonly) NSUInteger prewarmCount;   // cells created during idle time
+
+- (void)resetStatistics;
+
+@end
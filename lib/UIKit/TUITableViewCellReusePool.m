@@ -0,0 +1,201 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUITableViewCellReusePool.h"
+#import "TUITableViewCell.h"
+
+static NSString * const TUITableViewCellReusePoolPrewarmNotification = @"TUITableViewCellReusePoolPrewarmNotification";
+
+@interface TUITableViewCellReusePool ()
+
+@property (nonatomic, strong) NSMutableDictionary *cells;            // identifier -> NSMutableArray, last in first out
+@property (nonatomic, strong) NSMutableDictionary *cellClasses;      // identifier -> Class
+@property (nonatomic, strong) NSMutableDictionary *maximumCounts;    // identifier -> NSNumber
+@property (nonatomic, strong) NSMutableDictionary *prewarmCounts;    // identifier -> NSNumber
+
+@end
+
+@implementation TUITableViewCellReusePool
+
+- (instancetype)init
+{
+	if((self = [super init])) {
+		_cells = NSMutableDictionary.dictionary;
+		_cellClasses = NSMutableDictionary.dictionary;
+		_maximumCounts = NSMutableDictionary.dictionary;
+		_prewarmCounts = NSMutableDictionary.dictionary;
+		_defaultMaximumCount = NSUIntegerMax;
+
+		[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_prewarmNextCell:) name:TUITableViewCellReusePoolPrewarmNotification object:self];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[[NSNotificationCenter defaultCenter] removeObserver:self name:TUITableViewCellReusePoolPrewarmNotification object:self];
+}
+
+- (void)setMaximumCount:(NSUInteger)count forIdentifier:(NSString *)identifier
+{
+	if(!identifier)
+		return;
+
+	_maximumCounts[identifier] = @(count);
+
+	NSMutableArray *array = _cells[identifier];
+	if([array count] > count) {
+		[array removeObjectsInRange:NSMakeRange(0, [array count] - count)]; // drop the least recently used
+	}
+}
+
+- (NSUInteger)maximumCountForIdentifier:(NSString *)identifier
+{
+	NSNumber *count = identifier ? _maximumCounts[identifier] : nil;
+	return count ? [count unsignedIntegerValue] : _defaultMaximumCount;
+}
+
+- (NSUInteger)countForIdentifier:(NSString *)identifier
+{
+	return identifier ? [_cells[identifier] count] : 0;
+}
+
+- (void)registerClass:(Class)cellClass forIdentifier:(NSString *)identifier
+{
+	if(!identifier)
+		return;
+
+	_cellClasses[identifier] = cellClass;
+}
+
+- (TUITableViewCell *)_newCellWithIdentifier:(NSString *)identifier
+{
+	Class cellClass = _cellClasses[identifier];
+	if([cellClass isSubclassOfClass:TUITableViewCell.class]) {
+		return [[cellClass alloc] initWithStyle:TUITableViewCellStyleDefault reuseIdentifier:identifier];
+	}
+	return nil;
+}
+
+- (TUITableViewCell *)dequeueCellWithIdentifier:(NSString *)identifier
+{
+	if(!identifier)
+		return nil;
+
+	NSMutableArray *array = _cells[identifier];
+	TUITableViewCell *cell = [array lastObject];
+	if(cell) {
+		[array removeLastObject];
+		[cell prepareForReuse];
+		_hitCount++;
+		return cell;
+	}
+
+	_missCount++;
+	return [self _newCellWithIdentifier:identifier];
+}
+
+- (BOOL)enqueueCell:(TUITableViewCell *)cell
+{
+	NSString *identifier = cell.reuseIdentifier;
+	if(!identifier)
+		return NO;
+
+	NSMutableArray *array = _cells[identifier];
+	if([array count] >= [self maximumCountForIdentifier:identifier]) {
+		_discardCount++;
+		return NO;
+	}
+
+	if(!array) {
+		array = [[NSMutableArray alloc] init];
+		_cells[identifier] = array;
+	}
+	[array addObject:cell];
+	return YES;
+}
+
+- (void)removeAllCells
+{
+	[_cells removeAllObjects];
+	[_prewarmCounts removeAllObjects];
+}
+
+#pragma mark - Prewarming
+
+- (void)prewarmCellsWithIdentifier:(NSString *)identifier count:(NSUInteger)count
+{
+	if(!identifier || !_cellClasses[identifier])
+		return;
+
+	count = MIN(count, [self maximumCountForIdentifier:identifier]);
+	if([self countForIdentifier:identifier] >= count)
+		return;
+
+	_prewarmCounts[identifier] = @(MAX(count, [_prewarmCounts[identifier] unsignedIntegerValue]));
+	[self _schedulePrewarm];
+}
+
+- (void)_schedulePrewarm
+{
+	NSNotification *notification = [NSNotification notificationWithName:TUITableViewCellReusePoolPrewarmNotification object:self];
+	[[NSNotificationQueue defaultQueue] enqueueNotification:notification postingStyle:NSPostWhenIdle coalesceMask:(NSNotificationCoalescingOnName | NSNotificationCoalescingOnSender) forModes:nil];
+}
+
+/**
+ * @brief Create a single cell for the first pool that's still short
+ *
+ * Only one cell is created per idle pass so an incoming event never has to
+ * wait for a whole batch.
+ */
+- (void)_prewarmNextCell:(NSNotification *)notification
+{
+	NSString *identifier = [[_prewarmCounts allKeys] firstObject];
+	if(!identifier)
+		return;
+
+	NSUInteger target = MIN([_prewarmCounts[identifier] unsignedIntegerValue], [self maximumCountForIdentifier:identifier]);
+	TUITableViewCell *cell = nil;
+	if([self countForIdentifier:identifier] < target && (cell = [self _newCellWithIdentifier:identifier]) != nil) {
+		[self enqueueCell:cell];
+		_prewarmCount++;
+	}
+
+	if(cell == nil || [self countForIdentifier:identifier] >= target) {
+		[_prewarmCounts removeObjectForKey:identifier];
+	}
+
+	if([_prewarmCounts count] > 0) {
+		[self _schedulePrewarm];
+	}
+}
+
+#pragma mark - Statistics
+
+- (void)resetStatistics
+{
+	_hitCount = 0;
+	_missCount = 0;
+	_discardCount = 0;
+	_prewarmCount = 0;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %p hits=%lu misses=%lu discarded=%lu prewarmed=%lu pools=%@>", [self class], self, (unsigned long)_hitCount, (unsigned long)_missCount, (unsigned long)_discardCount, (unsigned long)_prewarmCount, _cells];
+}
+
+@end
@@ -0,0 +1,61 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+#import "TUIFastIndexPath.h"
+
+@class TUITableViewCell;
+
+/**
+ The cells a table view has on screen, keyed by packed index path.
+
+ Visible rows form a contiguous run within each section, so every section with visible rows keeps its first row and a dense array of cells indexed by the offset from that row.  Lookups, inserts and removals at either end are O(1) apart from finding the section, and enumeration is always in index path order.  Rows inside a run may be empty (a dragged cell kept off screen, or rows dropped by a batch update until the next layout).
+ */
+@interface TUITableViewVisibleRows : NSObject
+
+@property (nonatomic, readonly) NSUInteger count;
+
+// TUIPackedIndexPathNotFound when empty
+@property (nonatomic, readonly) TUIPackedIndexPath firstIndexPath;
+@property (nonatomic, readonly) TUIPackedIndexPath lastIndexPath;
+
+- (TUITableViewCell *)cellForIndexPath:(TUIPackedIndexPath)indexPath;
+
+/**
+ The nearest index path with a cell before or after @p indexPath, which need not have a cell itself.  Returns TUIPackedIndexPathNotFound at either end.  Lets callers walk the visible cells while removing them.
+ */
+- (TUIPackedIndexPath)indexPathBeforeIndexPath:(TUIPackedIndexPath)indexPath;
+- (TUIPackedIndexPath)indexPathAfterIndexPath:(TUIPackedIndexPath)indexPath;
+
+- (void)setCell:(TUITableViewCell *)cell forIndexPath:(TUIPackedIndexPath)indexPath;
+- (void)removeCellForIndexPath:(TUIPackedIndexPath)indexPath;
+- (void)removeAllCells;
+
+/**
+ Linear in the number of visible cells.  Returns TUIPackedIndexPathNotFound if @p cell isn't visible.
+ */
+- (TUIPackedIndexPath)indexPathForCell:(TUITableViewCell *)cell;
+
+// in index path order
+- (NSArray *)allCells;
+- (NSArray *)allIndexPaths; // TUIFastIndexPath objects
+
+/**
+ Visits cells in index path order, or in reverse with NSEnumerationReverse.  The receiver must not be mutated from @p block.
+ */
+- (void)enumerateCellsWithOptions:(NSEnumerationOptions)options usingBlock:(void (^)(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop))block;
+
+@end
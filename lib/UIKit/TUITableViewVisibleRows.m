@@ -0,0 +1,297 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUITableViewVisibleRows.h"
+#import "TUITableViewCell.h"
+
+/**
+ The visible run of one section.  The first and last entries of cells are always real cells; rows in between without one hold NSNull.
+ */
+@interface TUITableViewVisibleSectionRows : NSObject
+{
+@public
+	NSUInteger section;
+	NSUInteger firstRow;
+	NSUInteger count; // cells, not counting the holes
+	NSMutableArray *cells;
+}
+@end
+
+@implementation TUITableViewVisibleSectionRows
+@end
+
+@implementation TUITableViewVisibleRows
+{
+	NSMutableArray *_sections; // TUITableViewVisibleSectionRows, ordered by section
+	NSUInteger _count;
+}
+
+- (instancetype)init
+{
+	if((self = [super init])) {
+		_sections = [[NSMutableArray alloc] init];
+	}
+	return self;
+}
+
+- (NSUInteger)count
+{
+	return _count;
+}
+
+// index of the run for section, or the index it would be inserted at
+- (NSUInteger)_indexOfSection:(NSUInteger)section found:(BOOL *)found
+{
+	NSUInteger low = 0;
+	NSUInteger high = [_sections count];
+	while(low < high) {
+		NSUInteger mid = (low + high) / 2;
+		TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:mid];
+		if(rows->section == section) {
+			*found = YES;
+			return mid;
+		}
+		if(rows->section < section) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	*found = NO;
+	return low;
+}
+
+- (TUIPackedIndexPath)firstIndexPath
+{
+	TUITableViewVisibleSectionRows *rows = [_sections firstObject];
+	return (rows != nil) ? TUIPackedIndexPathMake(rows->section, rows->firstRow) : TUIPackedIndexPathNotFound;
+}
+
+- (TUIPackedIndexPath)lastIndexPath
+{
+	TUITableViewVisibleSectionRows *rows = [_sections lastObject];
+	return (rows != nil) ? TUIPackedIndexPathMake(rows->section, rows->firstRow + [rows->cells count] - 1) : TUIPackedIndexPathNotFound;
+}
+
+- (TUITableViewCell *)cellForIndexPath:(TUIPackedIndexPath)indexPath
+{
+	BOOL found;
+	NSUInteger index = [self _indexOfSection:TUIPackedIndexPathSection(indexPath) found:&found];
+	if(!found)
+		return nil;
+	
+	TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:index];
+	NSUInteger row = TUIPackedIndexPathRow(indexPath);
+	if(row < rows->firstRow || row - rows->firstRow >= [rows->cells count])
+		return nil;
+	
+	id cell = [rows->cells objectAtIndex:row - rows->firstRow];
+	return (cell != [NSNull null]) ? cell : nil;
+}
+
+- (TUIPackedIndexPath)indexPathBeforeIndexPath:(TUIPackedIndexPath)indexPath
+{
+	BOOL found;
+	NSUInteger index = [self _indexOfSection:TUIPackedIndexPathSection(indexPath) found:&found];
+	if(found) {
+		TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:index];
+		NSUInteger row = TUIPackedIndexPathRow(indexPath);
+		if(row > rows->firstRow) {
+			NSNull *hole = [NSNull null];
+			NSUInteger offset = MIN(row - rows->firstRow, [rows->cells count]);
+			while(offset-- > 0) {
+				if([rows->cells objectAtIndex:offset] != hole)
+					return TUIPackedIndexPathMake(rows->section, rows->firstRow + offset);
+			}
+		}
+	}
+	
+	// the last entry of the previous run is always a cell
+	if(index == 0)
+		return TUIPackedIndexPathNotFound;
+	TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:index - 1];
+	return TUIPackedIndexPathMake(rows->section, rows->firstRow + [rows->cells count] - 1);
+}
+
+- (TUIPackedIndexPath)indexPathAfterIndexPath:(TUIPackedIndexPath)indexPath
+{
+	BOOL found;
+	NSUInteger index = [self _indexOfSection:TUIPackedIndexPathSection(indexPath) found:&found];
+	if(found) {
+		TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:index];
+		NSUInteger row = TUIPackedIndexPathRow(indexPath);
+		NSNull *hole = [NSNull null];
+		NSUInteger rowCount = [rows->cells count];
+		for(NSUInteger offset = (row >= rows->firstRow) ? row - rows->firstRow + 1 : 0; offset < rowCount; ++offset) {
+			if([rows->cells objectAtIndex:offset] != hole)
+				return TUIPackedIndexPathMake(rows->section, rows->firstRow + offset);
+		}
+		index++;
+	}
+	
+	// the first entry of the next run is always a cell
+	if(index >= [_sections count])
+		return TUIPackedIndexPathNotFound;
+	TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:index];
+	return TUIPackedIndexPathMake(rows->section, rows->firstRow);
+}
+
+- (void)setCell:(TUITableViewCell *)cell forIndexPath:(TUIPackedIndexPath)indexPath
+{
+	if(cell == nil) {
+		[self removeCellForIndexPath:indexPath];
+		return;
+	}
+	
+	NSUInteger section = TUIPackedIndexPathSection(indexPath);
+	NSUInteger row = TUIPackedIndexPathRow(indexPath);
+	
+	BOOL found;
+	NSUInteger index = [self _indexOfSection:section found:&found];
+	if(!found) {
+		TUITableViewVisibleSectionRows *rows = [[TUITableViewVisibleSectionRows alloc] init];
+		rows->section = section;
+		rows->firstRow = row;
+		rows->count = 1;
+		rows->cells = [[NSMutableArray alloc] initWithObjects:cell, nil];
+		[_sections insertObject:rows atIndex:index];
+		_count++;
+		return;
+	}
+	
+	TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:index];
+	NSNull *hole = [NSNull null];
+	if(row < rows->firstRow) {
+		NSUInteger gap = rows->firstRow - row;
+		NSMutableArray *prefix = [[NSMutableArray alloc] initWithCapacity:gap];
+		[prefix addObject:cell];
+		while([prefix count] < gap)
+			[prefix addObject:hole];
+		[rows->cells replaceObjectsInRange:NSMakeRange(0, 0) withObjectsFromArray:prefix];
+		rows->firstRow = row;
+	} else {
+		NSUInteger offset = row - rows->firstRow;
+		if(offset < [rows->cells count]) {
+			id existing = [rows->cells objectAtIndex:offset];
+			[rows->cells replaceObjectAtIndex:offset withObject:cell];
+			if(existing != hole)
+				return; // replaced, count unchanged
+		} else {
+			while([rows->cells count] < offset)
+				[rows->cells addObject:hole];
+			[rows->cells addObject:cell];
+		}
+	}
+	rows->count++;
+	_count++;
+}
+
+- (void)removeCellForIndexPath:(TUIPackedIndexPath)indexPath
+{
+	BOOL found;
+	NSUInteger index = [self _indexOfSection:TUIPackedIndexPathSection(indexPath) found:&found];
+	if(!found)
+		return;
+	
+	TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:index];
+	NSUInteger row = TUIPackedIndexPathRow(indexPath);
+	if(row < rows->firstRow || row - rows->firstRow >= [rows->cells count])
+		return;
+	
+	NSNull *hole = [NSNull null];
+	NSUInteger offset = row - rows->firstRow;
+	if([rows->cells objectAtIndex:offset] == hole)
+		return;
+	
+	_count--;
+	if(--rows->count == 0) {
+		[_sections removeObjectAtIndex:index];
+		return;
+	}
+	
+	[rows->cells replaceObjectAtIndex:offset withObject:hole];
+	
+	// keep real cells at both ends
+	NSUInteger leading = 0;
+	while([rows->cells objectAtIndex:leading] == hole)
+		leading++;
+	if(leading > 0) {
+		[rows->cells removeObjectsInRange:NSMakeRange(0, leading)];
+		rows->firstRow += leading;
+	}
+	while([rows->cells lastObject] == hole)
+		[rows->cells removeLastObject];
+}
+
+- (void)removeAllCells
+{
+	[_sections removeAllObjects];
+	_count = 0;
+}
+
+- (TUIPackedIndexPath)indexPathForCell:(TUITableViewCell *)cell
+{
+	__block TUIPackedIndexPath indexPath = TUIPackedIndexPathNotFound;
+	[self enumerateCellsWithOptions:0 usingBlock:^(TUIPackedIndexPath i, TUITableViewCell *c, BOOL *stop) {
+		if(c == cell) {
+			indexPath = i;
+			*stop = YES;
+		}
+	}];
+	return indexPath;
+}
+
+- (NSArray *)allCells
+{
+	NSMutableArray *cells = [NSMutableArray arrayWithCapacity:_count];
+	[self enumerateCellsWithOptions:0 usingBlock:^(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop) {
+		[cells addObject:cell];
+	}];
+	return cells;
+}
+
+- (NSArray *)allIndexPaths
+{
+	NSMutableArray *indexPaths = [NSMutableArray arrayWithCapacity:_count];
+	[self enumerateCellsWithOptions:0 usingBlock:^(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop) {
+		[indexPaths addObject:[TUIFastIndexPath indexPathWithPackedIndexPath:indexPath]];
+	}];
+	return indexPaths;
+}
+
+- (void)enumerateCellsWithOptions:(NSEnumerationOptions)options usingBlock:(void (^)(TUIPackedIndexPath indexPath, TUITableViewCell *cell, BOOL *stop))block
+{
+	BOOL reverse = (options & NSEnumerationReverse) != 0;
+	NSNull *hole = [NSNull null];
+	BOOL stop = NO;
+	
+	NSUInteger sectionCount = [_sections count];
+	for(NSUInteger s = 0; s < sectionCount; ++s) {
+		TUITableViewVisibleSectionRows *rows = [_sections objectAtIndex:reverse ? sectionCount - 1 - s : s];
+		NSUInteger rowCount = [rows->cells count];
+		for(NSUInteger r = 0; r < rowCount; ++r) {
+			NSUInteger offset = reverse ? rowCount - 1 - r : r;
+			id cell = [rows->cells objectAtIndex:offset];
+			if(cell == hole)
+				continue;
+			block(TUIPackedIndexPathMake(rows->section, rows->firstRow + offset), cell, &stop);
+			if(stop)
+				return;
+		}
+	}
+}
+
+@end
@@ -7,6 +7,8 @@
 //
 
 #import "TUITextComposedSequence.h"
+#import "TUITextStorage_Private.h"
+#import <objc/runtime.h>
 
 NSString * const TUITextComposedSequenceAttributeName = @"TUITextComposedSequenceAttributeName";
 
@@ -76,6 +78,308 @@ NSString * const TUITextComposedSequenceAttributeName = @"TUITextComposedSequenc
 
 @end
 
+#define TUITextComposedSequenceReplacementTypeCount 3
+
+static inline NSUInteger TUITextComposedSequenceReplacementTypeIndex(TUITextComposedSequenceReplacementType type)
+{
+    return (type >= 0 && type < TUITextComposedSequenceReplacementTypeCount) ? type : TUITextComposedSequenceReplacementTypeNormal;
+}
+
+typedef struct {
+    NSUInteger location; // composed 文本中的位置
+    NSUInteger length;
+    NSUInteger replacementLength[TUITextComposedSequenceReplacementTypeCount];
+    NSInteger deltaBefore[TUITextComposedSequenceReplacementTypeCount]; // 之前所有 sequence 的 (replacementLength - length) 之和
+} TUITextComposedSequenceRun;
+
+/**
+ *  composed sequence 的偏移索引
+ *
+ *  按位置记录每个 sequence 的范围和各种替换方式下的长度，以及长度差的前缀和，
+ *  plain 和 composed 之间的位置转换因此只需要二分查找，而不用每次从头遍历属性。
+ *  通过 tui_setComposedSequence:forRange: 的修改会就地更新索引。
+ */
+@interface TUITextComposedSequenceIndex : NSObject
+{
+    TUITextComposedSequenceRun * _runs;
+    NSUInteger _count;
+    NSUInteger _capacity;
+    NSMutableArray * _sequences; // 和 _runs 一一对应
+    NSInteger _totalDelta[TUITextComposedSequenceReplacementTypeCount];
+}
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)attributedString;
+
+// 建立或最后更新索引时 TUITextStorage 的 editCount
+@property (nonatomic, assign) NSUInteger editCount;
+
+- (NSRange)plainTextRangeForComposedRange:(NSRange)composedRange replacementType:(TUITextComposedSequenceReplacementType)type;
+- (NSRange)composedRangeForPlainTextRange:(NSRange)plainTextRange replacementType:(TUITextComposedSequenceReplacementType)type;
+
+- (void)setComposedSequence:(TUITextComposedSequence *)sequence forRange:(NSRange)range;
+
+@end
+
+@implementation TUITextComposedSequenceIndex
+
+- (void)dealloc
+{
+    if (_runs) free(_runs);
+}
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)attributedString
+{
+    if (self = [super init]) {
+        _sequences = [NSMutableArray array];
+        
+        [attributedString tui_enumerateComposedSequencesWithBlock:^(TUITextComposedSequence *sequence, NSRange range, BOOL *stop) {
+            [self _insertSequence:sequence range:range atIndex:self->_count];
+        }];
+        
+        [self _updateDeltasFromIndex:0];
+    }
+    return self;
+}
+
+- (void)_insertSequence:(TUITextComposedSequence *)sequence range:(NSRange)range atIndex:(NSUInteger)index
+{
+    if (_count == _capacity) {
+        _capacity = MAX(_capacity * 2, 8);
+        _runs = (TUITextComposedSequenceRun *)realloc(_runs, _capacity * sizeof(TUITextComposedSequenceRun));
+    }
+    if (index < _count) {
+        memmove(&_runs[index + 1], &_runs[index], (_count - index) * sizeof(TUITextComposedSequenceRun));
+    }
+    
+    TUITextComposedSequenceRun * run = &_runs[index];
+    run->location = range.location;
+    run->length = range.length;
+    for (NSUInteger type = 0; type < TUITextComposedSequenceReplacementTypeCount; type++) {
+        run->replacementLength[type] = [sequence replacementCharactersForType:type].length;
+        run->deltaBefore[type] = 0;
+    }
+    
+    [_sequences insertObject:sequence atIndex:index];
+    _count++;
+}
+
+- (void)_removeRunsInRange:(NSRange)range
+{
+    if (!range.length) return;
+    
+    if (NSMaxRange(range) < _count) {
+        memmove(&_runs[range.location], &_runs[NSMaxRange(range)], (_count - NSMaxRange(range)) * sizeof(TUITextComposedSequenceRun));
+    }
+    [_sequences removeObjectsInRange:range];
+    _count -= range.length;
+}
+
+- (void)_updateDeltasFromIndex:(NSUInteger)index
+{
+    for (NSUInteger type = 0; type < TUITextComposedSequenceReplacementTypeCount; type++) {
+        NSInteger delta = index > 0 ? _runs[index - 1].deltaBefore[type] + (NSInteger)_runs[index - 1].replacementLength[type] - (NSInteger)_runs[index - 1].length : 0;
+        for (NSUInteger i = index; i < _count; i++) {
+            _runs[i].deltaBefore[type] = delta;
+            delta += (NSInteger)_runs[i].replacementLength[type] - (NSInteger)_runs[i].length;
+        }
+        _totalDelta[type] = delta;
+    }
+}
+
+- (NSInteger)_deltaBeforeRunAtIndex:(NSUInteger)index type:(NSUInteger)type
+{
+    return index < _count ? _runs[index].deltaBefore[type] : _totalDelta[type];
+}
+
+/**
+ *  二分查找第一个不满足 predicate 的 run，predicate 对 run 序列必须是单调的（先真后假）
+ */
+- (NSUInteger)_countOfRunsPassingTest:(BOOL (^)(const TUITextComposedSequenceRun * run))predicate
+{
+    NSUInteger low = 0, high = _count;
+    while (low < high) {
+        NSUInteger mid = (low + high) / 2;
+        if (predicate(&_runs[mid])) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+- (NSRange)plainTextRangeForComposedRange:(NSRange)composedRange replacementType:(TUITextComposedSequenceReplacementType)type
+{
+    NSUInteger t = TUITextComposedSequenceReplacementTypeIndex(type);
+    NSUInteger start = composedRange.location;
+    NSUInteger end = NSMaxRange(composedRange);
+    
+    // range 之前的 sequence 影响 location，range 之中的 sequence 影响 length
+    NSUInteger before = [self _countOfRunsPassingTest:^BOOL(const TUITextComposedSequenceRun *run) {
+        return run->location < start;
+    }];
+    NSUInteger inside = [self _countOfRunsPassingTest:^BOOL(const TUITextComposedSequenceRun *run) {
+        return run->location < end;
+    }];
+    inside = MAX(inside, before);
+    
+    NSInteger deltaBefore = [self _deltaBeforeRunAtIndex:before type:t];
+    NSInteger deltaInside = [self _deltaBeforeRunAtIndex:inside type:t] - deltaBefore;
+    
+    return NSMakeRange(start + deltaBefore, composedRange.length + deltaInside);
+}
+
+- (NSRange)composedRangeForPlainTextRange:(NSRange)plainTextRange replacementType:(TUITextComposedSequenceReplacementType)type
+{
+    NSUInteger t = TUITextComposedSequenceReplacementTypeIndex(type);
+    NSUInteger plainStart = plainTextRange.location;
+    NSUInteger plainEnd = NSMaxRange(plainTextRange);
+    
+    // 在 plain 文本中完全位于 range 之前的 sequence，只影响 location
+    NSUInteger index = [self _countOfRunsPassingTest:^BOOL(const TUITextComposedSequenceRun *run) {
+        return run->location + run->deltaBefore[t] + run->replacementLength[t] <= plainStart;
+    }];
+    
+    NSRange composedRange = plainTextRange;
+    composedRange.location -= [self _deltaBeforeRunAtIndex:index type:t];
+    
+    // 在和 sequence 部分重叠之前，composedRange 和 plainTextRange 一一对应，可以按 plain 位置二分跳过 range 内的 sequence
+    BOOL mapsToPlainTextRange = YES;
+    
+    while (index < _count) {
+        
+        const TUITextComposedSequenceRun * run = &_runs[index];
+        const NSRange sequenceRange = NSMakeRange(run->location, run->length);
+        const NSRange replacementRange = NSMakeRange(sequenceRange.location, run->replacementLength[t]);
+        
+        if (NSMaxRange(replacementRange) <= composedRange.location) {
+            
+            composedRange.location -= (replacementRange.length - sequenceRange.length);
+            index++;
+            
+        } else if (replacementRange.location >= NSMaxRange(composedRange)) {
+            
+            // 之后的 sequence 都不影响 composedRange
+            break;
+            
+        } else if (replacementRange.location >= composedRange.location && NSMaxRange(replacementRange) <= NSMaxRange(composedRange)) {
+            
+            // composedRange 完整包含的 sequence，影响 composedRange 的 length
+            if (mapsToPlainTextRange) {
+                NSUInteger end = [self _countOfRunsPassingTest:^BOOL(const TUITextComposedSequenceRun *run) {
+                    NSUInteger runPlainStart = run->location + run->deltaBefore[t];
+                    return runPlainStart < plainEnd && runPlainStart + run->replacementLength[t] <= plainEnd;
+                }];
+                end = MAX(end, index + 1);
+                composedRange.length -= [self _deltaBeforeRunAtIndex:end type:t] - [self _deltaBeforeRunAtIndex:index type:t];
+                index = end;
+            } else {
+                composedRange.length -= (replacementRange.length - sequenceRange.length);
+                index++;
+            }
+            
+        } else {
+            
+            // composedRange 和 sequence 部分重叠，此时 composedRange 在 sequence 里面
+            if (composedRange.length > 0) {
+                composedRange = sequenceRange;
+            } else {
+                composedRange = NSMakeRange(NSMaxRange(sequenceRange), 0);
+            }
+            mapsToPlainTextRange = NO;
+            index++;
+        }
+    }
+    
+    return composedRange;
+}
+
+- (void)setComposedSequence:(TUITextComposedSequence *)sequence forRange:(NSRange)range
+{
+    NSUInteger start = range.location;
+    NSUInteger end = NSMaxRange(range);
+    if (start == end) return;
+    
+    // [first, last) 是和 range 相交的 sequence
+    NSUInteger first = [self _countOfRunsPassingTest:^BOOL(const TUITextComposedSequenceRun *run) {
+        return run->location + run->length <= start;
+    }];
+    NSUInteger last = [self _countOfRunsPassingTest:^BOOL(const TUITextComposedSequenceRun *run) {
+        return run->location < end;
+    }];
+    last = MAX(last, first);
+    
+    // 被部分覆盖的 sequence 保留 range 外的部分
+    TUITextComposedSequence * leftSequence = nil, * rightSequence = nil;
+    NSRange leftRange = NSMakeRange(NSNotFound, 0), rightRange = NSMakeRange(NSNotFound, 0);
+    if (last > first) {
+        if (_runs[first].location < start) {
+            leftSequence = _sequences[first];
+            leftRange = NSMakeRange(_runs[first].location, start - _runs[first].location);
+        }
+        NSUInteger lastEnd = _runs[last - 1].location + _runs[last - 1].length;
+        if (lastEnd > end) {
+            rightSequence = _sequences[last - 1];
+            rightRange = NSMakeRange(end, lastEnd - end);
+        }
+    }
+    
+    [self _removeRunsInRange:NSMakeRange(first, last - first)];
+    
+    NSUInteger index = first;
+    if (leftSequence) {
+        [self _insertSequence:leftSequence range:leftRange atIndex:index++];
+    }
+    if (sequence) {
+        [self _insertSequence:sequence range:range atIndex:index++];
+    }
+    if (rightSequence) {
+        [self _insertSequence:rightSequence range:rightRange atIndex:index++];
+    }
+    
+    // 相邻且相同的 sequence 在属性遍历时是一段，这里同样合并
+    NSUInteger mergeStart = first > 0 ? first - 1 : 0;
+    NSUInteger mergeEnd = MIN(index + 1, _count);
+    for (NSUInteger i = mergeStart; i + 1 < mergeEnd; ) {
+        TUITextComposedSequenceRun * run = &_runs[i];
+        TUITextComposedSequenceRun * next = &_runs[i + 1];
+        if (run->location + run->length == next->location && [_sequences[i] isEqual:_sequences[i + 1]]) {
+            run->length += next->length;
+            [self _removeRunsInRange:NSMakeRange(i + 1, 1)];
+            mergeEnd--;
+        } else {
+            i++;
+        }
+    }
+    
+    [self _updateDeltasFromIndex:mergeStart];
+}
+
+@end
+
+static char TUITextComposedSequenceIndexKey;
+
+/**
+ *  不可变的 attributedString 和 TUITextStorage 会缓存索引，其他可变的 attributedString 无法得知何时被修改，每次重新建立
+ */
+static TUITextComposedSequenceIndex * TUITextComposedSequenceIndexForAttributedString(NSAttributedString * attributedString)
+{
+    NSUInteger editCount = 0;
+    if ([attributedString isKindOfClass:[TUITextStorage class]]) {
+        editCount = [(TUITextStorage *)attributedString editCount];
+    } else if ([attributedString isKindOfClass:[NSMutableAttributedString class]]) {
+        return [[TUITextComposedSequenceIndex alloc] initWithAttributedString:attributedString];
+    }
+    
+    TUITextComposedSequenceIndex * index = objc_getAssociatedObject(attributedString, &TUITextComposedSequenceIndexKey);
+    if (!index || index.editCount != editCount) {
+        index = [[TUITextComposedSequenceIndex alloc] initWithAttributedString:attributedString];
+        index.editCount = editCount;
+        objc_setAssociatedObject(attributedString, &TUITextComposedSequenceIndexKey, index, OBJC_ASSOCIATION_RETAIN);
+    }
+    return index;
+}
+
 @implementation NSAttributedString (TUITextComposedSequence)
 
 - (TUITextComposedSequence *)tui_composedSequenceAtIndex:(NSUInteger)index effectiveRange:(NSRangePointer)effectiveRange
@@ -249,19 +553,8 @@ NSString * const TUITextComposedSequenceAttributeName = @"TUITextComposedSequenc
 - (NSRange)tui_plainTextRangeByRemovingComposedSequencesForComposedRange:(NSRange)composedRange replacementType:(TUITextComposedSequenceReplacementType)type
 {
     composedRange = [self tui_effectiveRangeByRoundingToComposedSequencesForRange:composedRange];
-    NSRange __block plainTextRange = composedRange;
     
-    // range 之前的 sequence 会影响 plainTextRange 的 location
-    [self tui_enumerateComposedSequencesInRange:NSMakeRange(0, composedRange.location) options:0 block:^(TUITextComposedSequence *sequence, NSRange range, BOOL *stop) {
-        plainTextRange.location += ([sequence replacementCharactersForType:type].length - range.length);
-    }];
-    
-    // range 之中的 sequence 会影响 plainTextRange 的 length
-    [self tui_enumerateComposedSequencesInRange:composedRange options:0 block:^(TUITextComposedSequence *sequence, NSRange range, BOOL *stop) {
-        plainTextRange.length += ([sequence replacementCharactersForType:type].length - range.length);
-    }];
-    
-    return plainTextRange;
+    return [TUITextComposedSequenceIndexForAttributedString(self) plainTextRangeForComposedRange:composedRange replacementType:type];
 }
 
 - (NSRange)tui_composedRangeByAddingComposedSequencesForPlainTextRange:(NSRange)plainTextRange
@@ -271,67 +564,7 @@ NSString * const TUITextComposedSequenceAttributeName = @"TUITextComposedSequenc
 
 - (NSRange)tui_composedRangeByAddingComposedSequencesForPlainTextRange:(NSRange)plainTextRange replacementType:(TUITextComposedSequenceReplacementType)type
 {
-    NSRange __block composedRange = plainTextRange;
-    
-    [self tui_enumerateComposedSequencesWithBlock:^(TUITextComposedSequence *sequence, NSRange range, BOOL *stop) {
-        
-        const NSRange sequenceRange = range;
-        const NSString * replacement = [sequence replacementCharactersForType:type];
-        const NSUInteger replacementLength = replacement.length;
-        const NSRange replacementRange = NSMakeRange(sequenceRange.location, replacementLength);
-        
-        if (NSMaxRange(replacementRange) <= composedRange.location) {
-            
-            // composedRange 之前的 sequence，影响 composedRange 的 location
-            composedRange.location -= (replacementRange.length - sequenceRange.length);
-            
-        } else if (replacementRange.location >= NSMaxRange(composedRange)) {
-            
-            // composedRange 之后的 sequence，不影响 composedRange，
-            // 由于是有序遍历，说明没有可以影响 composedRange 的 sequence 了
-            *stop = YES;
-            
-        } else if (replacementRange.location >= composedRange.location && NSMaxRange(replacementRange) <= NSMaxRange(composedRange)) {
-            
-            // composedRange 完整包含的 sequence，影响 composedRange 的 length
-            composedRange.length -= (replacementRange.length - sequenceRange.length);
-            
-        } else {
-            
-            // 否则 sequence 至少有一部分在 composedRange 外，一部分在 composedRange 里
-            // 这里把 sequence 分成 3 部分：
-            // left:   sequence 在 composedRange 外面左边的长度，影响 composedRange 的 location
-            // inside: sequence 在 composedRange 之中的长度，影响 composedRange 的 length
-            // right:  sequence 在 composedRange 外面右边的长度，不影响 composedRange
-            
-            NSInteger left = composedRange.location - replacementRange.location;
-            left = MAX(left, 0);
-            
-            NSInteger right = NSMaxRange(replacementRange) - NSMaxRange(composedRange);
-            right = MAX(right, 0);
-            
-            NSInteger inside = replacementRange.length - left - right;
-            
-            if (left >= 0 && right >= 0) {
-                // composedRange 完全在 sequence 里面
-                if (composedRange.length > 0) {
-                    composedRange = sequenceRange;
-                } else {
-                    composedRange = NSMakeRange(NSMaxRange(sequenceRange), 0);
-                }
-            } else if (left > 0) {
-                // composedRange 左边缘和 sequence 重合，则将左边缘移到 sequence 右边即可
-                composedRange.location = NSMaxRange(sequenceRange);
-                composedRange.length -= inside;
-            } else {
-                NSAssert(right > 0, @"right must not 0 at this point");
-                // composedRange 右边缘和 sequence 重合，则将右边缘移到 sequence 右边即可
-                composedRange.length += right;
-            }
-        }
-    }];
-    
-    return composedRange;
+    return [TUITextComposedSequenceIndexForAttributedString(self) composedRangeForPlainTextRange:plainTextRange replacementType:type];
 }
 
 @end
@@ -353,11 +586,25 @@ NSString * const TUITextComposedSequenceAttributeName = @"TUITextComposedSequenc
         range.length = stringLength - range.location;
     }
     
+    // 修改前索引有效的话，修改后就地更新，不用重新遍历
+    TUITextComposedSequenceIndex * index = nil;
+    if ([self isKindOfClass:[TUITextStorage class]]) {
+        index = objc_getAssociatedObject(self, &TUITextComposedSequenceIndexKey);
+        if (index.editCount != [(TUITextStorage *)self editCount]) {
+            index = nil;
+        }
+    }
+    
     if (sequence) {
         [self addAttribute:TUITextComposedSequenceAttributeName value:sequence range:range];
     } else {
         [self removeAttribute:TUITextComposedSequenceAttributeName range:range];
     }
+    
+    if (index) {
+        [index setComposedSequence:sequence forRange:range];
+        index.editCount = [(TUITextStorage *)self editCount];
+    }
 }
 
 @end
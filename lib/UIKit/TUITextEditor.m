@@ -34,6 +34,8 @@
 		inputContext = [[NSTextInputContext alloc] initWithClient:self];
 		inputContext.acceptsGlyphInfo = YES; // fucker
 		
+		// the backing store is edited in place; keep our layout out of the shared cache so edits relayout incrementally
+		self.textLayout.usesSharedLayoutCache = NO;
 		self.attributedString = backingStore;
         
         wasValidKeyEquivalentSelector = YES;
@@ -78,6 +80,15 @@
 	[self.eventDelegateContextView performSelector:@selector(_textDidChange)];
 }
 
+// faster than -_textDidChange when only part of the backing store changed
+- (void)_textDidChangeInRange:(NSRange)editedRange changeInLength:(NSInteger)delta
+{
+	[inputContext invalidateCharacterCoordinates];
+	[self.textLayout setNeedsLayoutForEditedCharacterRange:editedRange changeInLength:delta];
+	[self.eventDelegateContextView setNeedsDisplay];
+	[self.eventDelegateContextView performSelector:@selector(_textDidChange)];
+}
+
 - (void)reset
 {
     self.attributedString = nil;
@@ -175,7 +186,7 @@
 	selectedRange.location = range.location;
 	selectedRange.length = 0;
 	self.selectedRange = selectedRange;
-	[self _textDidChange];
+	[self _textDidChangeInRange:NSMakeRange(range.location, 0) changeInLength:-(NSInteger)range.length];
 }
 
 
@@ -237,7 +248,7 @@
 	selectedRange.length = 0;
     [self unmarkText];
 	self.selectedRange = selectedRange;
-	[self _textDidChange];
+	[self _textDidChangeInRange:NSMakeRange(replacementRange.location, [aString length]) changeInLength:(NSInteger)[aString length] - (NSInteger)replacementRange.length];
 }
 
 /* The receiver inserts aString replacing the content specified by replacementRange. 
@@ -279,7 +290,7 @@
     selectedRange.location = replacementRange.location + newSelection.location; // Just for now, only select the marked text
     selectedRange.length = newSelection.length;
 	self.selectedRange = selectedRange;
-	[self _textDidChange];
+	[self _textDidChangeInRange:NSMakeRange(replacementRange.location, [aString length]) changeInLength:(NSInteger)[aString length] - (NSInteger)replacementRange.length];
 }
 
 /* The receiver unmarks the marked text. If no marked text, the invocation of this 
@@ -28,10 +28,45 @@
 
 - (void)setNeedsLayout;
 
+/**
+ *  attributedString 被原地修改后调用，下次排版时只重新排版被修改的段落
+ *
+ *  @param editedRange 修改后字符串中被修改的范围
+ *  @param delta       修改造成的长度变化
+ */
+- (void)setNeedsLayoutForEditedCharacterRange:(NSRange)editedRange changeInLength:(NSInteger)delta;
+
 @property (nonatomic, weak) id<TUITextLayoutDelegate> delegate;
 
 @property (nonatomic, assign) BOOL retriveFontMetricsAutomatically;
 
+/**
+ *  是否使用共享的布局缓存，默认 YES
+ *  原地编辑 attributedString 的 layout（例如 TUITextEditor 的）应设为 NO，否则每次编辑都会向缓存插入新条目，缓存中的 frame 也无法增量排版
+ */
+@property (nonatomic, assign) BOOL usesSharedLayoutCache;
+
+@end
+
+/**
+ *  已完成的布局结果会按 attributedString、宽度、maximumNumberOfLines、truncationString 以及字体 metrics 缓存在一个进程内共享的 LRU 缓存中，
+ *  只要新的高度放得下缓存的 layoutSize，就复用缓存的结果，所以同样的文字先用一个很大的高度计算尺寸、再按实际高度绘制时只需排版一次。设置了 exclusionPaths、实现了截断宽度 delegate 方法或 usesSharedLayoutCache 为 NO 的 layout 不会使用缓存。
+ *  所有方法都是线程安全的。
+ */
+@interface TUITextLayout (LayoutCache)
+
+/**
+ *  缓存最多保留的布局数，默认 256，设为 0 则关闭缓存
+ */
++ (NSUInteger)layoutCacheCountLimit;
++ (void)setLayoutCacheCountLimit:(NSUInteger)countLimit;
+
++ (NSUInteger)layoutCacheHitCount;
++ (NSUInteger)layoutCacheMissCount;
++ (void)resetLayoutCacheStatistics;
+
++ (void)removeAllCachedLayouts;
+
 @end
 
 @protocol TUITextLayoutDelegate <NSObject>
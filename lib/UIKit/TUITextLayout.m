@@ -11,6 +11,7 @@
 #import "TUITextLayoutLine_Private.h"
 #import "TUITextStorage.h"
 #import "TUITextLayoutLine.h"
+#import <pthread.h>
 
 TUI_EXTERN_C_BEGIN
 
@@ -50,12 +51,201 @@ BOOL TUINSRangeContainsIndex(NSRange range, NSUInteger index)
 }
 
 TUI_EXTERN_C_END
-        
+
+#pragma mark - Layout Cache
+
+// 太长的文字（一般是编辑中的文本）不进缓存，避免每次排版都复制、比较整段字符串
+#define TUITextLayoutCacheMaximumStringLength 4096
+
+@interface TUITextLayoutCacheKey : NSObject <NSCopying>
+{
+    @public
+    NSAttributedString * _attributedString;
+    NSAttributedString * _truncationString;
+    CGFloat _width; // 高度不在 key 里，frame 能否用于别的高度见 -canBeReusedForContainerHeight:
+    NSUInteger _maximumNumberOfLines;
+    TUIFontMetrics _baselineFontMetrics;
+    TUIFontMetrics _fixedFontMetrics;
+    NSUInteger _hash;
+}
+@end
+
+@implementation TUITextLayoutCacheKey
+
+static inline NSUInteger TUITextLayoutCacheHashCombine(NSUInteger hash, NSUInteger value)
+{
+    return (hash * 31) ^ value;
+}
+
+static inline NSUInteger TUITextLayoutCacheHashFloat(CGFloat value)
+{
+    return (NSUInteger)(value * 64.0);
+}
+
+- (void)updateHash
+{
+    // NSString 的 hash 只取首尾若干字符，所以把长度也混进来；真正的判等由 -isEqual: 完成
+    NSUInteger hash = _attributedString.string.hash;
+    hash = TUITextLayoutCacheHashCombine(hash, _attributedString.length);
+    hash = TUITextLayoutCacheHashCombine(hash, TUITextLayoutCacheHashFloat(_width));
+    hash = TUITextLayoutCacheHashCombine(hash, _maximumNumberOfLines);
+    _hash = hash;
+}
+
+- (NSUInteger)hash
+{
+    return _hash;
+}
+
+- (BOOL)isEqual:(id)object
+{
+    TUITextLayoutCacheKey * other = object;
+    if (self == other) {
+        return YES;
+    }
+    if (![other isKindOfClass:[TUITextLayoutCacheKey class]] || _hash != other->_hash) {
+        return NO;
+    }
+    return _width == other->_width &&
+    _maximumNumberOfLines == other->_maximumNumberOfLines &&
+    TUIFontMetricsEqual(_baselineFontMetrics, other->_baselineFontMetrics) &&
+    TUIFontMetricsEqual(_fixedFontMetrics, other->_fixedFontMetrics) &&
+    (_truncationString == other->_truncationString || [_truncationString isEqualToAttributedString:other->_truncationString]) &&
+    [_attributedString isEqualToAttributedString:other->_attributedString];
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    TUITextLayoutCacheKey * key = [[TUITextLayoutCacheKey alloc] init];
+    // 可变字符串之后可能被原地修改，缓存里要保留一份快照
+    key->_attributedString = [_attributedString copy];
+    key->_truncationString = [_truncationString copy];
+    key->_width = _width;
+    key->_maximumNumberOfLines = _maximumNumberOfLines;
+    key->_baselineFontMetrics = _baselineFontMetrics;
+    key->_fixedFontMetrics = _fixedFontMetrics;
+    key->_hash = _hash;
+    return key;
+}
+
+@end
+
+@interface TUITextLayoutCacheEntry : NSObject
+{
+    @public
+    TUITextLayoutCacheKey * _key;
+    TUITextLayoutFrame * _layoutFrame;
+    __unsafe_unretained TUITextLayoutCacheEntry * _previous; // 更近使用的
+    __unsafe_unretained TUITextLayoutCacheEntry * _next;     // 更久未用的
+}
+@end
+
+@implementation TUITextLayoutCacheEntry
+@end
+
+static pthread_mutex_t TUITextLayoutCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary * TUITextLayoutCacheEntries = nil; // key -> entry, 持有所有 entry
+static __unsafe_unretained TUITextLayoutCacheEntry * TUITextLayoutCacheHead = nil;
+static __unsafe_unretained TUITextLayoutCacheEntry * TUITextLayoutCacheTail = nil;
+static NSUInteger TUITextLayoutCacheCountLimit = 256;
+static NSUInteger TUITextLayoutCacheHits = 0;
+static NSUInteger TUITextLayoutCacheMisses = 0;
+
+// 以下函数都需要在持有 TUITextLayoutCacheLock 时调用
+
+static void TUITextLayoutCacheUnlinkEntry(TUITextLayoutCacheEntry * entry)
+{
+    if (entry->_previous) {
+        entry->_previous->_next = entry->_next;
+    } else {
+        TUITextLayoutCacheHead = entry->_next;
+    }
+    if (entry->_next) {
+        entry->_next->_previous = entry->_previous;
+    } else {
+        TUITextLayoutCacheTail = entry->_previous;
+    }
+    entry->_previous = nil;
+    entry->_next = nil;
+}
+
+static void TUITextLayoutCacheLinkEntryAtHead(TUITextLayoutCacheEntry * entry)
+{
+    entry->_next = TUITextLayoutCacheHead;
+    if (TUITextLayoutCacheHead) {
+        TUITextLayoutCacheHead->_previous = entry;
+    }
+    TUITextLayoutCacheHead = entry;
+    if (!TUITextLayoutCacheTail) {
+        TUITextLayoutCacheTail = entry;
+    }
+}
+
+static void TUITextLayoutCacheTrimToCount(NSUInteger count)
+{
+    while (TUITextLayoutCacheEntries.count > count && TUITextLayoutCacheTail) {
+        TUITextLayoutCacheEntry * entry = TUITextLayoutCacheTail;
+        TUITextLayoutCacheUnlinkEntry(entry);
+        [TUITextLayoutCacheEntries removeObjectForKey:entry->_key];
+    }
+}
+
+/**
+ *  返回能用于 height 的 frame，高度可能与请求的不同，需要用 -frameByMovingToContainerHeight:layout: 平移
+ */
+static TUITextLayoutFrame * TUITextLayoutCacheLookup(TUITextLayoutCacheKey * key, CGFloat height)
+{
+    TUITextLayoutFrame * layoutFrame = nil;
+    
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    TUITextLayoutCacheEntry * entry = TUITextLayoutCacheEntries[key];
+    if (entry && [entry->_layoutFrame canBeReusedForContainerHeight:height]) {
+        if (entry != TUITextLayoutCacheHead) {
+            TUITextLayoutCacheUnlinkEntry(entry);
+            TUITextLayoutCacheLinkEntryAtHead(entry);
+        }
+        layoutFrame = entry->_layoutFrame;
+        TUITextLayoutCacheHits++;
+    } else {
+        TUITextLayoutCacheMisses++;
+    }
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+    
+    return layoutFrame;
+}
+
+static void TUITextLayoutCacheInsert(TUITextLayoutCacheKey * key, TUITextLayoutFrame * layoutFrame)
+{
+    // 复制 key 可能要复制整段字符串，放在锁外面做
+    TUITextLayoutCacheEntry * entry = [[TUITextLayoutCacheEntry alloc] init];
+    entry->_key = [key copy];
+    entry->_layoutFrame = layoutFrame;
+    
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    if (TUITextLayoutCacheCountLimit > 0) {
+        if (!TUITextLayoutCacheEntries) {
+            TUITextLayoutCacheEntries = [[NSMutableDictionary alloc] init];
+        }
+        TUITextLayoutCacheEntry * existingEntry = TUITextLayoutCacheEntries[entry->_key];
+        if (existingEntry) {
+            TUITextLayoutCacheUnlinkEntry(existingEntry);
+        }
+        TUITextLayoutCacheEntries[entry->_key] = entry;
+        TUITextLayoutCacheLinkEntryAtHead(entry);
+        TUITextLayoutCacheTrimToCount(TUITextLayoutCacheCountLimit);
+    }
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+}
+
 @interface TUITextLayout ()
 {
     struct {
         unsigned int needsLayout: 1;
+        unsigned int hasPendingEdit: 1; // needsLayout only because of the edits below
     } _flags;
+    
+    NSRange _pendingEditedRange;
+    NSInteger _pendingChangeInLength;
 }
 
 @end
@@ -66,8 +256,10 @@ TUI_EXTERN_C_END
 {
     if (self = [super init]) {
         _flags.needsLayout = YES;
+        _flags.hasPendingEdit = NO;
         _baselineFontMetrics = TUIFontMetricsNull;
         _fixedFontMetrics = TUIFontMetricsNull;
+        _usesSharedLayoutCache = YES;
     }
     return self;
 }
@@ -92,6 +284,7 @@ TUI_EXTERN_C_END
             self.baselineFontMetrics = TUIFontMetricsNull;
         }
         _flags.needsLayout = YES;
+        _flags.hasPendingEdit = NO;
     }
 }
 
@@ -100,6 +293,7 @@ TUI_EXTERN_C_END
     if (!CGSizeEqualToSize(_size, size)) {
         _size = size;
         _flags.needsLayout = YES;
+        _flags.hasPendingEdit = NO;
     }
 }
 
@@ -108,6 +302,7 @@ TUI_EXTERN_C_END
     if (_exclusionPaths != exclusionPaths) {
         _exclusionPaths = exclusionPaths;
         _flags.needsLayout = YES;
+        _flags.hasPendingEdit = NO;
     }
 }
 
@@ -116,6 +311,7 @@ TUI_EXTERN_C_END
     if (_maximumNumberOfLines != maximumNumberOfLines) {
         _maximumNumberOfLines = maximumNumberOfLines;
         _flags.needsLayout = YES;
+        _flags.hasPendingEdit = NO;
     }
 }
 
@@ -124,6 +320,7 @@ TUI_EXTERN_C_END
     if (!TUIFontMetricsEqual(_baselineFontMetrics, baselineFontMetrics)) {
         _baselineFontMetrics = baselineFontMetrics;
         _flags.needsLayout = YES;
+        _flags.hasPendingEdit = NO;
     }
 }
 
@@ -132,6 +329,7 @@ TUI_EXTERN_C_END
     if (!TUIFontMetricsEqual(_fixedFontMetrics, fixedFontMetrics)) {
         _fixedFontMetrics = fixedFontMetrics;
         _flags.needsLayout = YES;
+        _flags.hasPendingEdit = NO;
     }
 }
 
@@ -140,19 +338,120 @@ TUI_EXTERN_C_END
 - (void)setNeedsLayout
 {
     _flags.needsLayout = YES;
+    _flags.hasPendingEdit = NO;
+}
+
+- (void)setNeedsLayoutForEditedCharacterRange:(NSRange)editedRange changeInLength:(NSInteger)delta
+{
+    if (!_layoutFrame || (_flags.needsLayout && !_flags.hasPendingEdit)) {
+        // 已经需要完整排版了
+        [self setNeedsLayout];
+        return;
+    }
+    
+    if (_flags.hasPendingEdit) {
+        // 与之前未排版的编辑合并成一段：先把之前的范围映射到这次编辑之后的坐标上
+        const NSUInteger replacedEnd = NSMaxRange(editedRange) - delta; // 这次编辑替换掉的范围在编辑前的终点
+        NSUInteger pendingEnd = NSMaxRange(_pendingEditedRange);
+        if (pendingEnd > editedRange.location) {
+            pendingEnd = pendingEnd >= replacedEnd ? pendingEnd + delta : NSMaxRange(editedRange);
+        }
+        const NSUInteger start = MIN(_pendingEditedRange.location, editedRange.location);
+        const NSUInteger end = MAX(pendingEnd, NSMaxRange(editedRange));
+        _pendingEditedRange = NSMakeRange(start, end - start);
+        _pendingChangeInLength += delta;
+    } else {
+        _pendingEditedRange = editedRange;
+        _pendingChangeInLength = delta;
+    }
+    
+    _flags.needsLayout = YES;
+    _flags.hasPendingEdit = YES;
 }
 
 - (TUITextLayoutFrame *)layoutFrame
 {
     if (!_layoutFrame || _flags.needsLayout) {
         @synchronized(self) {
-            _layoutFrame = [self createLayoutFrame];
+            // check again, another thread may have finished the layout while we waited
+            if (!_layoutFrame || _flags.needsLayout) {
+                TUITextLayoutFrame * layoutFrame = [self cachedOrCreatedLayoutFrame];
+                _flags.needsLayout = NO;
+                _layoutFrame = layoutFrame;
+            }
         }
-        _flags.needsLayout = NO;
     }
     return _layoutFrame;
 }
 
+/**
+ *  返回描述当前布局输入的缓存 key，无法缓存时返回 nil
+ */
+- (TUITextLayoutCacheKey *)layoutCacheKey
+{
+    NSAttributedString * attributedString = _attributedString;
+    
+    if (!_usesSharedLayoutCache) {
+        return nil;
+    }
+    if (!attributedString || attributedString.length > TUITextLayoutCacheMaximumStringLength) {
+        return nil;
+    }
+    if (_exclusionPaths.count) {
+        return nil;
+    }
+    if ([_delegate respondsToSelector:@selector(textLayout:maximumWidthForLineTruncationAtIndex:)]) {
+        return nil; // 截断结果取决于 delegate
+    }
+    
+    TUITextLayoutCacheKey * key = [[TUITextLayoutCacheKey alloc] init];
+    key->_attributedString = attributedString;
+    key->_truncationString = _truncationString;
+    key->_width = _size.width;
+    key->_maximumNumberOfLines = _maximumNumberOfLines;
+    key->_baselineFontMetrics = _baselineFontMetrics;
+    key->_fixedFontMetrics = _fixedFontMetrics;
+    [key updateHash];
+    return key;
+}
+
+- (TUITextLayoutFrame *)cachedOrCreatedLayoutFrame
+{
+    if (_flags.hasPendingEdit) {
+        _flags.hasPendingEdit = NO;
+        TUITextLayoutFrame * layoutFrame = [_layoutFrame frameByRelayoutingEditedCharacterRange:_pendingEditedRange changeInLength:_pendingChangeInLength];
+        if (layoutFrame) {
+            return layoutFrame;
+        }
+    }
+    
+    if (TUITextLayoutCacheCountLimit == 0) {
+        return [self createLayoutFrame];
+    }
+    
+    TUITextLayoutCacheKey * key = [self layoutCacheKey];
+    if (!key) {
+        return [self createLayoutFrame];
+    }
+    
+    TUITextLayoutFrame * layoutFrame = TUITextLayoutCacheLookup(key, _size.height);
+    if (layoutFrame) {
+        // 先量高度再按实际高度绘制时命中这里：排版结果相同，只是整体平移
+        layoutFrame = [layoutFrame frameByMovingToContainerHeight:_size.height layout:self];
+        if (self.retriveFontMetricsAutomatically && TUIFontMetricsEqual(_baselineFontMetrics, TUIFontMetricsNull)) {
+            // 排版时 line 会顺带把 metrics 写回 layout，命中缓存时补上这一步
+            _baselineFontMetrics = layoutFrame.baselineMetrics;
+        }
+        return layoutFrame;
+    }
+    
+    layoutFrame = [self createLayoutFrame];
+    if (layoutFrame) {
+        TUITextLayoutCacheInsert(key, layoutFrame);
+    }
+    return layoutFrame;
+}
+
 - (TUITextLayoutFrame *)createLayoutFrame
 {
     const NSAttributedString * attributedString = _attributedString;
@@ -186,6 +485,57 @@ TUI_EXTERN_C_END
 @synthesize layoutFrame = _layoutFrame;
 @end
 
+@implementation TUITextLayout (LayoutCache)
+
++ (NSUInteger)layoutCacheCountLimit
+{
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    NSUInteger countLimit = TUITextLayoutCacheCountLimit;
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+    return countLimit;
+}
+
++ (void)setLayoutCacheCountLimit:(NSUInteger)countLimit
+{
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    TUITextLayoutCacheCountLimit = countLimit;
+    TUITextLayoutCacheTrimToCount(countLimit);
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+}
+
++ (NSUInteger)layoutCacheHitCount
+{
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    NSUInteger hits = TUITextLayoutCacheHits;
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+    return hits;
+}
+
++ (NSUInteger)layoutCacheMissCount
+{
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    NSUInteger misses = TUITextLayoutCacheMisses;
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+    return misses;
+}
+
++ (void)resetLayoutCacheStatistics
+{
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    TUITextLayoutCacheHits = 0;
+    TUITextLayoutCacheMisses = 0;
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+}
+
++ (void)removeAllCachedLayouts
+{
+    pthread_mutex_lock(&TUITextLayoutCacheLock);
+    TUITextLayoutCacheTrimToCount(0);
+    pthread_mutex_unlock(&TUITextLayoutCacheLock);
+}
+
+@end
+
 @implementation TUITextLayout (LayoutResult)
 
 - (BOOL)layoutUpToDate
@@ -343,41 +693,42 @@ TUI_EXTERN_C_END
 {
     const NSString * string = self.attributedString.string;
     const NSUInteger stringLength = string.length;
-    const NSArray * lines = self.layoutFrame.lineFragments;
+    TUITextLayoutFrame * layoutFrame = self.layoutFrame;
+    const NSArray * lines = layoutFrame.lineFragments;
     const NSUInteger lineCount = lines.count;
     
-    CGFloat previousLineY = self.size.height;
+    if (lineCount == 0) {
+        return 0;
+    }
+    
+    if (point.y > CGRectGetMaxY(((TUITextLayoutLine *)lines[0]).fragmentRect)) {
+        return 0; // 在第一行之上
+    }
     
-    for (NSInteger i = 0; i < lineCount; i++) {
-        TUITextLayoutLine * line = lines[i];
-        CGRect fragmentRect = line.fragmentRect;
-        
-        if (i == 0 && point.y > CGRectGetMaxY(fragmentRect)) {
-            return 0; // 在第一行之上
-        }
+    // 行从上往下排列，找到第一个底部不高于 point 的行
+    const NSUInteger i = [layoutFrame lineFragmentIndexForVerticalPosition:point.y];
+    if (i >= lineCount) {
+        return stringLength; // 在最后一行之下
+    }
+    
+    TUITextLayoutLine * line = lines[i];
+    const CGFloat previousLineY = (i == 0) ? self.size.height : CGRectGetMinY(((TUITextLayoutLine *)lines[i - 1]).fragmentRect);
+    
+    if (point.y < previousLineY) {
+        // 命中！
+        point.x -= line.baselineOrigin.x;
+        point.y -= line.baselineOrigin.y;
         
-        if (i == lineCount - 1 && point.y < CGRectGetMinY(fragmentRect)) {
-            return stringLength; // 在最后一行之下
-        }
+        NSUInteger index = [line characterIndexForBoundingPosition:point];
         
-        if (point.y < previousLineY && point.y >= CGRectGetMinY(fragmentRect)) {
-            // 命中！
-            point.x -= line.baselineOrigin.x;
-            point.y -= line.baselineOrigin.y;
-            
-            NSUInteger index = [line characterIndexForBoundingPosition:point];
-            
-            NSRange stringRange = line.stringRange;
-            if (index == NSMaxRange(stringRange) && index > 0) {
-                if ([string characterAtIndex:index - 1] == '\n') {
-                    index--;
-                }
+        NSRange stringRange = line.stringRange;
+        if (index == NSMaxRange(stringRange) && index > 0) {
+            if ([string characterAtIndex:index - 1] == '\n') {
+                index--;
             }
-            
-            return index;
         }
         
-        previousLineY = CGRectGetMinY(fragmentRect);
+        return index;
     }
     
     return 0;
@@ -25,6 +25,11 @@
 
 - (NSUInteger)lineFragmentIndexForCharacterAtIndex:(NSUInteger)characterIndex;
 
+/**
+ *  第一个底部不高于 y 的行，也就是 y 落在它和上一行之间；y 在所有行之下时返回行数
+ */
+- (NSUInteger)lineFragmentIndexForVerticalPosition:(CGFloat)y;
+
 - (CGRect)firstSelectionRectForCharacterRange:(NSRange)characterRange;
 
 - (void)enumerateLineFragmentsForCharacterRange:(NSRange)characterRange usingBlock:(void (^)(NSUInteger idx, CGRect rect, NSRange characterRange, BOOL *stop))block;
@@ -15,18 +15,49 @@
 @interface TUITextLayoutFrame ()
 
 @property (nonatomic, weak) TUITextLayout * layout;
+@property (nonatomic, assign) CGSize containerSize;
+@property (nonatomic, assign) CGFloat topOverflowOffset; // applied to every line when the first one sticks out of the top
+@property (nonatomic, assign) BOOL clippedByContainerHeight; // a taller container would have held more lines
 
 @property (nonatomic, assign) TUIFontMetrics baselineMetrics;
 @property (nonatomic, strong) NSArray * lineFragments;
+@property (nonatomic, assign) NSUInteger generation;
 
 @end
 
+/**
+ *  每一行的字符范围和纵向位置，连续存放，用于二分查找
+ */
+typedef struct {
+    NSUInteger location;
+    NSUInteger end;
+    CGFloat minY; // 行越靠下越小
+} TUITextLayoutFrameLineEntry;
+
+static inline CGPoint TUITextLayoutFrameFixedLineOrigin(TUIFontMetrics fixedFontMetrics, CGFloat height, NSUInteger index)
+{
+    const CGFloat lineHeight = fixedFontMetrics.ascent + fixedFontMetrics.descent + fixedFontMetrics.leading;
+    return CGPointMake(0, height - fixedFontMetrics.ascent - index * lineHeight);
+}
+
 @implementation TUITextLayoutFrame
+{
+    TUITextLayoutFrameLineEntry * _lineEntries;
+}
+
+- (void)dealloc
+{
+    if (_lineEntries) {
+        free(_lineEntries);
+        _lineEntries = NULL;
+    }
+}
 
 - (instancetype)initWithCTFrame:(CTFrameRef)frameRef layout:(TUITextLayout *)layout
 {
     if (self = [self init]) {
         _layout = layout;
+        _containerSize = layout.size; // frames may outlive their layout in the layout cache
         if (frameRef) {
             [self setupWithCTFrame:frameRef];
         }
@@ -46,12 +77,8 @@
     if (TUIFontMetricsEqual(fixedFontMetrics, TUIFontMetricsNull)) {
         CTFrameGetLineOrigins(frameRef, CFRangeMake(0, lineCount), lineOrigins);
     } else {
-        CGFloat y = _layout.size.height;
         for (NSUInteger i = 0; i < lineCount; i++) {
-            y -= fixedFontMetrics.ascent;
-            lineOrigins[i] = CGPointMake(0, y);
-            y -= fixedFontMetrics.descent;
-            y -= fixedFontMetrics.leading;
+            lineOrigins[i] = TUITextLayoutFrameFixedLineOrigin(fixedFontMetrics, _layout.size.height, i);
         }
     }
     
@@ -85,18 +112,71 @@
         CGFloat layoutMaxY = _layout.size.height;
         if (maxY > layoutMaxY) {
             CGPoint delta = CGPointMake(0, layoutMaxY - maxY);
+            _topOverflowOffset = delta.y;
             [lineFragments enumerateObjectsUsingBlock:^(TUITextLayoutLine * line, NSUInteger idx, BOOL * _Nonnull stop) {
                 [line _offsetBaselineOriginWithDelta:delta];
             }];
         }
     }
     
+    // 行数限制之内还有字没排下，说明是高度不够
+    const BOOL reachedLineLimit = maximumNumberOfLines && lineCount >= maximumNumberOfLines;
+    _clippedByContainerHeight = !reachedLineLimit && (NSUInteger)CTFrameGetVisibleStringRange(frameRef).length < _layout.attributedString.length;
+    
     self.baselineMetrics = _layout.baselineFontMetrics;
     self.lineFragments = lineFragments;
     
     [self updateLayoutSize];
 }
 
+- (void)setLineFragments:(NSArray *)lineFragments
+{
+    _lineFragments = lineFragments;
+    _generation++;
+    [self updateLineEntries];
+}
+
+- (void)updateLineEntries
+{
+    const NSUInteger lineCount = _lineFragments.count;
+    
+    if (_lineEntries) {
+        free(_lineEntries);
+        _lineEntries = NULL;
+    }
+    if (!lineCount) {
+        return;
+    }
+    
+    _lineEntries = malloc(lineCount * sizeof(TUITextLayoutFrameLineEntry));
+    
+    NSUInteger i = 0;
+    for (TUITextLayoutLine * line in _lineFragments) {
+        NSRange stringRange = line.stringRange;
+        _lineEntries[i].location = stringRange.location;
+        _lineEntries[i].end = NSMaxRange(stringRange);
+        _lineEntries[i].minY = CGRectGetMinY(line.fragmentRect);
+        i++;
+    }
+}
+
+/**
+ *  第一个 end 不小于 characterIndex 的行
+ */
+- (NSUInteger)firstLineIndexEndingAtOrAfterCharacterIndex:(NSUInteger)characterIndex
+{
+    NSUInteger low = 0, high = _lineFragments.count;
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if (_lineEntries[mid].end < characterIndex) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
 - (void)updateLayoutSize
 {
     CGFloat __block minY = _layout.size.height, __block width = 0.0;
@@ -122,6 +202,223 @@
     _layoutSize = CGSizeMake(ceil(width), ceil(maxY - minY + 1));
 }
 
+#pragma mark - Container Height
+
+- (BOOL)canBeReusedForContainerHeight:(CGFloat)height
+{
+    if (height == _containerSize.height) {
+        return YES;
+    }
+    return !_clippedByContainerHeight && height >= _layoutSize.height;
+}
+
+- (TUITextLayoutFrame *)frameByMovingToContainerHeight:(CGFloat)height layout:(TUITextLayout *)layout
+{
+    if (height == _containerSize.height) {
+        return self;
+    }
+    
+    // 行可能正被别处读取，平移的是副本
+    const CGFloat delta = height - _containerSize.height;
+    NSMutableArray * lineFragments = [NSMutableArray arrayWithCapacity:_lineFragments.count];
+    for (TUITextLayoutLine * line in _lineFragments) {
+        [lineFragments addObject:[line _lineOffsetByVerticalDelta:delta]];
+    }
+    
+    TUITextLayoutFrame * layoutFrame = [[TUITextLayoutFrame alloc] initWithCTFrame:NULL layout:layout];
+    layoutFrame.containerSize = CGSizeMake(_containerSize.width, height);
+    layoutFrame.baselineMetrics = _baselineMetrics;
+    layoutFrame.topOverflowOffset = _topOverflowOffset;
+    layoutFrame.clippedByContainerHeight = _clippedByContainerHeight;
+    layoutFrame.lineFragments = lineFragments;
+    [layoutFrame updateLayoutSize];
+    
+    return layoutFrame;
+}
+
+#pragma mark - Incremental Layout
+
+/**
+ *  characterIndex 必须是某一行的开头（或是整段文字的末尾），否则返回 NSNotFound
+ */
+- (NSUInteger)lineIndexStartingAtCharacterIndex:(NSUInteger)characterIndex stringLength:(NSUInteger)stringLength
+{
+    const NSUInteger lineCount = _lineFragments.count;
+    NSUInteger low = 0, high = lineCount;
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if (_lineEntries[mid].location < characterIndex) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < lineCount) {
+        return _lineEntries[low].location == characterIndex ? low : NSNotFound;
+    }
+    return characterIndex == stringLength ? low : NSNotFound;
+}
+
+- (TUITextLayoutFrame *)frameByRelayoutingEditedCharacterRange:(NSRange)editedRange changeInLength:(NSInteger)delta
+{
+    TUITextLayout * layout = _layout;
+    NSAttributedString * attributedString = layout.attributedString;
+    NSString * string = attributedString.string;
+    const NSUInteger length = string.length;
+    const NSUInteger oldLength = length - delta;
+    const CGSize size = layout.size;
+    const TUIFontMetrics fixedFontMetrics = layout.fixedFontMetrics;
+    const BOOL usesFixedFontMetrics = !TUIFontMetricsEqual(fixedFontMetrics, TUIFontMetricsNull);
+    
+    if (!layout || layout.maximumNumberOfLines || layout.exclusionPaths.count) {
+        return nil;
+    }
+    if (!CGSizeEqualToSize(size, _containerSize) || !TUIFontMetricsEqual(_baselineMetrics, layout.baselineFontMetrics)) {
+        return nil;
+    }
+    if (NSMaxRange(editedRange) > length || (NSInteger)length - delta < 0) {
+        return nil;
+    }
+    
+    // 原来的排版必须放下了全部文字，否则无法确定后面的行
+    NSArray * oldLines = _lineFragments;
+    TUITextLayoutLine * lastLine = oldLines.lastObject;
+    if (!lastLine || NSMaxRange(lastLine.stringRange) != oldLength) {
+        return nil;
+    }
+    
+    // 受影响的段落；把编辑之后的第一个字也算进来，保证两端都落在换行处
+    const NSUInteger editEnd = MIN(NSMaxRange(editedRange) + 1, length);
+    const NSRange paragraphRange = [string paragraphRangeForRange:NSMakeRange(editedRange.location, editEnd - editedRange.location)];
+    const NSUInteger paragraphStart = paragraphRange.location;
+    const NSUInteger paragraphEnd = NSMaxRange(paragraphRange);
+    
+    // 前后各多排一段，用来对齐新行的纵向位置
+    const NSUInteger contextStart = paragraphStart > 0 ? [string paragraphRangeForRange:NSMakeRange(paragraphStart - 1, 0)].location : 0;
+    const NSUInteger contextEnd = paragraphEnd < length ? NSMaxRange([string paragraphRangeForRange:NSMakeRange(paragraphEnd, 0)]) : paragraphEnd;
+    
+    // 在旧的行里找到对应的位置，编辑之前的部分位置不变，之后的部分要减去 delta
+    const NSUInteger firstReplacedLine = [self lineIndexStartingAtCharacterIndex:contextStart stringLength:oldLength];
+    const NSUInteger firstFollowingLine = [self lineIndexStartingAtCharacterIndex:contextEnd - delta stringLength:oldLength];
+    const NSUInteger firstAfterParagraphLine = [self lineIndexStartingAtCharacterIndex:paragraphEnd - delta stringLength:oldLength];
+    if (firstReplacedLine == NSNotFound || firstFollowingLine == NSNotFound || firstAfterParagraphLine == NSNotFound) {
+        return nil;
+    }
+    
+    // 只排版这几段
+    const NSRange contextRange = NSMakeRange(contextStart, contextEnd - contextStart);
+    CTFrameRef ctFrame = NULL;
+    {
+        NSAttributedString * substring = [attributedString attributedSubstringFromRange:contextRange];
+        CTFramesetterRef framesetter = CTFramesetterCreateWithAttributedString((CFAttributedStringRef)substring);
+        CGMutablePathRef path = CGPathCreateMutable();
+        CGPathAddRect(path, NULL, CGRectMake(0, 0, size.width, size.height));
+        ctFrame = CTFramesetterCreateFrame(framesetter, CFRangeMake(0, 0), path, NULL);
+        CFRelease(path);
+        CFRelease(framesetter);
+    }
+    if (!ctFrame) {
+        return nil;
+    }
+    if ((NSUInteger)CTFrameGetVisibleStringRange(ctFrame).length != contextRange.length) {
+        CFRelease(ctFrame);
+        return nil;
+    }
+    
+    NSArray * ctLines = (NSArray *)CTFrameGetLines(ctFrame);
+    const NSUInteger ctLineCount = ctLines.count;
+    CGPoint ctLineOrigins[MAX(ctLineCount, 1)];
+    CTFrameGetLineOrigins(ctFrame, CFRangeMake(0, ctLineCount), ctLineOrigins);
+    
+    // 子串是从顶部开始排的；第一段没有变化，用它在旧排版中的位置把新行整体平移过去
+    CGFloat dy = 0;
+    if (!usesFixedFontMetrics && contextStart > 0 && ctLineCount > 0) {
+        TUITextLayoutLine * anchorLine = oldLines[firstReplacedLine];
+        dy = anchorLine.originalBaselineOrigin.y - ctLineOrigins[0].y;
+    }
+    
+    NSMutableArray * newLines = [NSMutableArray arrayWithCapacity:ctLineCount];
+    CGFloat followingShift = 0;
+    BOOL foundAfterParagraphLine = (paragraphEnd == length);
+    TUITextLayoutLine * oldAfterParagraphLine = firstAfterParagraphLine < oldLines.count ? oldLines[firstAfterParagraphLine] : nil;
+    
+    for (NSUInteger i = 0; i < ctLineCount; i++) {
+        CTLineRef lineRef = (__bridge CTLineRef)ctLines[i];
+        CGPoint origin = ctLineOrigins[i];
+        if (usesFixedFontMetrics) {
+            origin = TUITextLayoutFrameFixedLineOrigin(fixedFontMetrics, size.height, firstReplacedLine + i);
+        } else {
+            origin.y += dy;
+        }
+        
+        TUITextLayoutLine * line = [[TUITextLayoutLine alloc] initWithCTLine:lineRef origin:origin layout:layout];
+        [line _offsetStringLocationWithDelta:contextStart];
+        [newLines addObject:line];
+        
+        if (line.stringRange.location == paragraphEnd && oldAfterParagraphLine) {
+            // 编辑之后的那一段内容没变，它移动了多少，后面所有的行就移动多少
+            followingShift = origin.y - oldAfterParagraphLine.originalBaselineOrigin.y;
+            foundAfterParagraphLine = YES;
+        }
+    }
+    CFRelease(ctFrame);
+    
+    if (!foundAfterParagraphLine) {
+        return nil;
+    }
+    
+    // 整体超出顶部时的修正：第一行重排过的话需要重新计算，结果不一致就放弃
+    CGFloat topOverflowOffset = _topOverflowOffset;
+    if (firstReplacedLine == 0) {
+        TUITextLayoutLine * firstLine = newLines.firstObject;
+        CGFloat maxY = firstLine ? CGRectGetMaxY(firstLine.fragmentRect) : 0;
+        CGFloat offset = maxY > size.height ? size.height - maxY : 0;
+        if (offset != topOverflowOffset) {
+            return nil;
+        }
+    }
+    
+    // 后面的行复用 CTLine，只平移位置和字符范围；旧的行可能正被别处读取（后台绘制、持有旧 frame 的人），所以平移的是副本
+    const NSInteger lineCountDelta = (NSInteger)ctLineCount - (NSInteger)(firstFollowingLine - firstReplacedLine);
+    NSMutableArray * followingLines = [NSMutableArray arrayWithCapacity:oldLines.count - firstFollowingLine];
+    for (NSUInteger i = firstFollowingLine; i < oldLines.count; i++) {
+        TUITextLayoutLine * line = [oldLines[i] _lineOffsetByStringLocationDelta:delta];
+        [followingLines addObject:line];
+        
+        CGPoint origin = line.originalBaselineOrigin;
+        if (usesFixedFontMetrics) {
+            origin = TUITextLayoutFrameFixedLineOrigin(fixedFontMetrics, size.height, i + lineCountDelta);
+        } else {
+            origin.y += followingShift;
+        }
+        if (!CGPointEqualToPoint(origin, line.originalBaselineOrigin)) {
+            [line _setOriginalBaselineOrigin:origin];
+            if (topOverflowOffset != 0) {
+                [line _offsetBaselineOriginWithDelta:CGPointMake(0, topOverflowOffset)];
+            }
+        }
+    }
+    
+    if (topOverflowOffset != 0) {
+        for (TUITextLayoutLine * line in newLines) {
+            [line _offsetBaselineOriginWithDelta:CGPointMake(0, topOverflowOffset)];
+        }
+    }
+    
+    NSMutableArray * lineFragments = [NSMutableArray arrayWithCapacity:firstReplacedLine + newLines.count + followingLines.count];
+    [lineFragments addObjectsFromArray:[oldLines subarrayWithRange:NSMakeRange(0, firstReplacedLine)]];
+    [lineFragments addObjectsFromArray:newLines];
+    [lineFragments addObjectsFromArray:followingLines];
+    
+    TUITextLayoutFrame * layoutFrame = [[TUITextLayoutFrame alloc] initWithCTFrame:NULL layout:layout];
+    layoutFrame.baselineMetrics = _baselineMetrics;
+    layoutFrame.topOverflowOffset = topOverflowOffset;
+    layoutFrame.lineFragments = lineFragments;
+    [layoutFrame updateLayoutSize];
+    
+    return layoutFrame;
+}
+
 #pragma mark - Line Truncating
 
 - (id)textLayout:(TUITextLayout *)textLayout truncateLine:(CTLineRef)lineRef atIndex:(NSUInteger)index truncated:(BOOL *)truncated
@@ -202,6 +499,9 @@
     if (_layout.truncationString) {
         tokenString = _layout.truncationString;
     }
+    NSMutableAttributedString * markedTokenString = [tokenString mutableCopy];
+    [markedTokenString addAttribute:TUITextTruncationTokenAttributeName value:@YES range:NSMakeRange(0, markedTokenString.length)];
+    tokenString = markedTokenString;
     CTLineRef truncationToken = CTLineCreateWithAttributedString((CFAttributedStringRef)tokenString);
     
     // Append truncationToken to the string
@@ -258,17 +558,27 @@
 
 - (NSUInteger)lineFragmentIndexForCharacterAtIndex:(NSUInteger)characterIndex
 {
-    NSUInteger __block lineIndex = NSNotFound;
+    // 第一个 end 大于 characterIndex 的行，跳过空行
+    NSUInteger lineIndex = [self firstLineIndexEndingAtOrAfterCharacterIndex:characterIndex + 1];
     
-    [self.lineFragments enumerateObjectsUsingBlock:^(TUITextLayoutLine * line, NSUInteger idx, BOOL *stop) {
-        if (TUINSRangeContainsIndex(line.stringRange, characterIndex) &&
-            characterIndex != NSMaxRange(line.stringRange)) {
-            lineIndex = idx;
-            *stop = YES;
+    if (lineIndex < _lineFragments.count && _lineEntries[lineIndex].location <= characterIndex) {
+        return lineIndex;
+    }
+    return NSNotFound;
+}
+
+- (NSUInteger)lineFragmentIndexForVerticalPosition:(CGFloat)y
+{
+    NSUInteger low = 0, high = _lineFragments.count;
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if (_lineEntries[mid].minY > y) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
-    }];
-    
-    return lineIndex;
+    }
+    return low;
 }
 
 - (CGRect)firstSelectionRectForCharacterRange:(NSRange)characterRange
@@ -301,7 +611,14 @@
     NSArray * lineFragments = self.lineFragments;
     const NSUInteger lineCount = lineFragments.count;
     
-    [lineFragments enumerateObjectsUsingBlock:^(TUITextLayoutLine * line, NSUInteger idx, BOOL *stop) {
+    // 在请求的 range 之前结束的行不会产生任何 rect，直接从第一个可能相关的行开始
+    const NSUInteger firstLineIndex = [self firstLineIndexEndingAtOrAfterCharacterIndex:characterRange.location];
+    if (firstLineIndex >= lineCount) {
+        return;
+    }
+    NSIndexSet * lineIndexes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(firstLineIndex, lineCount - firstLineIndex)];
+    
+    [lineFragments enumerateObjectsAtIndexes:lineIndexes options:0 usingBlock:^(TUITextLayoutLine * line, NSUInteger idx, BOOL *stop) {
         
         const NSRange lineRange = line.stringRange;
         const CGRect lineFragmentRect = line.fragmentRect;
@@ -366,7 +683,7 @@
 
 - (CGRect)enumerateSelectionRectsForCharacterRange:(NSRange)characterRange usingBlock:(void (^)(CGRect, NSRange, BOOL *))block
 {
-    CGSize containerSize = self.layout.size;
+    CGSize containerSize = self.containerSize;
     CGRect __block boundingRect = CGRectNull;
     
     [self enumerateEnclosingRectsForCharacterRange:characterRange usingBlock:^(CGRect rect, NSRange lineRange, BOOL *stop) {
@@ -29,6 +29,11 @@
 
 @property (nonatomic, readonly) BOOL truncated;
 
+/**
+ *  截断行中截断符之前实际绘制出来的文字范围，未截断时等于 stringRange
+ */
+@property (nonatomic, readonly) NSRange visibleStringRange;
+
 @end
 
 @interface TUITextLayoutLine (LayoutResult)
@@ -10,10 +10,13 @@
 #import "TUITextLayoutLine_Private.h"
 #import "TUITextLayout_Private.h"
 
+NSString * const TUITextTruncationTokenAttributeName = @"TUITextTruncationToken";
+
 @interface TUITextLayoutLine ()
 {
     CTLineRef _lineRef;
     CFRange _lineRefRange;
+    NSUInteger _visibleStringLength;
 }
 
 @property (nonatomic, weak) TUITextLayout * layout;
@@ -52,6 +55,7 @@
             }
             _stringRange = NSMakeRange(range.location, range.length);
             _lineRefRange = CTLineGetStringRange(_lineRef);
+            _visibleStringLength = truncatedLineRef ? TUITextLayoutLineGetVisibleStringLength(truncatedLineRef) : _stringRange.length;
             
             [self setupWithCTLine];
         }
@@ -59,6 +63,32 @@
     return self;
 }
 
+/**
+ *  截断后的 CTLine 由这一行的子串加截断符排出，不属于截断符的 run 中最靠后的字符就是实际显示的最后一个字符
+ */
+static NSUInteger TUITextLayoutLineGetVisibleStringLength(CTLineRef truncatedLineRef)
+{
+    const CFIndex lineLocation = CTLineGetStringRange(truncatedLineRef).location;
+    CFIndex visibleEnd = lineLocation;
+    
+    for (id obj in (NSArray *)CTLineGetGlyphRuns(truncatedLineRef)) {
+        CTRunRef run = (__bridge CTRunRef)obj;
+        NSDictionary * attributes = (NSDictionary *)CTRunGetAttributes(run);
+        if (attributes[TUITextTruncationTokenAttributeName]) {
+            continue;
+        }
+        CFRange range = CTRunGetStringRange(run);
+        visibleEnd = MAX(visibleEnd, range.location + range.length);
+    }
+    
+    return (NSUInteger)(visibleEnd - lineLocation);
+}
+
+- (NSRange)visibleStringRange
+{
+    return NSMakeRange(_stringRange.location, _visibleStringLength);
+}
+
 - (void)setupWithCTLine
 {
     const CTLineRef lineRef = _lineRef;
@@ -120,6 +150,49 @@
     _baselineOrigin.y += delta.y;
 }
 
+- (void)_offsetStringLocationWithDelta:(NSInteger)delta
+{
+    _stringRange.location += delta;
+}
+
+- (TUITextLayoutLine *)_lineCopy
+{
+    TUITextLayoutLine * line = [[TUITextLayoutLine alloc] init];
+    line->_lineRef = _lineRef ? (CTLineRef)CFRetain(_lineRef) : NULL;
+    line->_lineRefRange = _lineRefRange;
+    line->_visibleStringLength = _visibleStringLength;
+    line->_layout = _layout;
+    line->_width = _width;
+    line->_truncated = _truncated;
+    line->_stringRange = _stringRange;
+    line->_originalBaselineOrigin = _originalBaselineOrigin;
+    line->_baselineOrigin = _baselineOrigin;
+    line->_originalLineMetrics = _originalLineMetrics;
+    line->_lineMetrics = _lineMetrics;
+    return line;
+}
+
+- (TUITextLayoutLine *)_lineOffsetByStringLocationDelta:(NSInteger)delta
+{
+    TUITextLayoutLine * line = [self _lineCopy];
+    line->_stringRange.location += delta;
+    return line;
+}
+
+- (TUITextLayoutLine *)_lineOffsetByVerticalDelta:(CGFloat)delta
+{
+    TUITextLayoutLine * line = [self _lineCopy];
+    line->_originalBaselineOrigin.y += delta;
+    line->_baselineOrigin.y += delta;
+    return line;
+}
+
+- (void)_setOriginalBaselineOrigin:(CGPoint)origin
+{
+    _originalBaselineOrigin = origin;
+    [self setupWithCTLine];
+}
+
 static CGRect TUITextGetLineFragmentRect(CGPoint baselineOrigin, TUIFontMetrics lineMetrics, CGFloat width)
 {
     return CGRectIntegral(CGRectMake(baselineOrigin.x, baselineOrigin.y - lineMetrics.descent - lineMetrics.leading, width, TUIFontMetricsGetLineHeight(lineMetrics)));
@@ -135,10 +208,10 @@ static CGRect TUITextGetLineFragmentRect(CGPoint baselineOrigin, TUIFontMetrics
         return 0;
     }
     
-    // 当 _lineRef 是被截断过的，它包含的 stringRange 可能是错误的，在这里要修正这个错误
+    // 当 _lineRef 是被截断过的，或是由增量排版从子串排出、之后又随编辑平移过的，它包含的 stringRange 可能是错误的，在这里要修正这个错误
+    // 平移后 delta 可能为负
     CFRange lineRange = _lineRefRange;
-    NSInteger locationDelta = _stringRange.location - lineRange.location;
-    locationDelta = MAX(locationDelta, 0);
+    NSInteger locationDelta = (NSInteger)_stringRange.location - lineRange.location;
     
     return locationDelta;
 }
@@ -151,7 +224,7 @@ static CGRect TUITextGetLineFragmentRect(CGPoint baselineOrigin, TUIFontMetrics
     }
     
     NSInteger locationDelta = [self locationDeltaFromRealRangeToLineRefRange];
-    locationDelta = MIN(characterIndex, locationDelta);
+    locationDelta = MIN((NSInteger)characterIndex, locationDelta);
     characterIndex -= locationDelta;
     
     CGFloat offset = CTLineGetOffsetForStringIndex(_lineRef, characterIndex, NULL);
@@ -9,10 +9,22 @@
 #import "TUITextLayoutLine.h"
 #import <CoreText/CoreText.h>
 
+// 截断时加在截断符上的属性，用来从截断后的 CTLine 中区分出截断符的 run
+extern NSString * const TUITextTruncationTokenAttributeName;
+
 @interface TUITextLayoutLine ()
 
 @property (nonatomic, assign) CTLineRef lineRef;
 
 - (void)_offsetBaselineOriginWithDelta:(CGPoint)delta;
 
+// used by incremental layout to move a line without typesetting it again;
+// lines already handed out may be read concurrently, so only ever move a fresh line or a copy
+- (void)_offsetStringLocationWithDelta:(NSInteger)delta;
+- (void)_setOriginalBaselineOrigin:(CGPoint)origin;
+
+// copies sharing the same CTLine, with the string range or the vertical position moved by delta
+- (TUITextLayoutLine *)_lineOffsetByStringLocationDelta:(NSInteger)delta;
+- (TUITextLayoutLine *)_lineOffsetByVerticalDelta:(CGFloat)delta;
+
 @end
@@ -17,6 +17,35 @@
 
 @end
 
+@interface TUITextLayoutFrame ()
+
+// bumped whenever lineFragments changes
+@property (nonatomic, assign, readonly) NSUInteger generation;
+
+/**
+ *  只重新排版受编辑影响的段落，其余行平移后复用，结果是一个新的 frame
+ *  frame 创建后就不再改变，可以被缓存、后台绘制等同时读取
+ *
+ *  @param editedRange 编辑后字符串中被修改的范围
+ *  @param delta       编辑造成的长度变化
+ *
+ *  @return 无法增量排版时返回 nil，需要完整排版
+ */
+- (TUITextLayoutFrame *)frameByRelayoutingEditedCharacterRange:(NSRange)editedRange changeInLength:(NSInteger)delta;
+
+/**
+ *  行的位置都是从容器顶部算起的，容器高度改变时整体平移即可，前提是原来的排版没有因为高度不够而少排了行
+ *  新的高度至少要放得下 layoutSize.height
+ */
+- (BOOL)canBeReusedForContainerHeight:(CGFloat)height;
+
+/**
+ *  高度相同时返回 self，否则返回一个把所有行平移到新高度下的新 frame
+ */
+- (TUITextLayoutFrame *)frameByMovingToContainerHeight:(CGFloat)height layout:(TUITextLayout *)layout;
+
+@end
+
 @interface TUITextLayout (Coordinates)
 
 - (CGPoint)convertPointFromCoreText:(CGPoint)point;
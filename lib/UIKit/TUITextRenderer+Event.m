@@ -89,17 +89,7 @@
 - (id<ABActiveTextRange>)fast_rangeAtLocalPoint:(CGPoint)location
 {
     location = [self convertPointToLayout:location];
-    NSDictionary * map = self.activeRangeToRectsMap;
-    for (id<ABActiveTextRange>key in map) {
-        NSArray * rects = map[key];
-        for (NSValue * value in rects) {
-            CGRect rect = [value rectValue];
-            if (CGRectContainsPoint(rect, location)) {
-                return key;
-            }
-        }
-    }
-    return nil;
+    return [self.activeRangeRectTable activeRangeAtPoint:location];
 }
 
 - (id<ABActiveTextRange>)fast_rangeForEvent:(NSEvent *)event
@@ -541,17 +541,14 @@
 
 - (void)updateActiveRangeFrameMapWithAttributedString:(NSAttributedString *)attributedString layoutFrame:(TUITextLayoutFrame *)layoutFrame
 {
-    NSMutableDictionary * dictionary = [NSMutableDictionary dictionary];
-    for (id<ABActiveTextRange>activeRange in [[self activeRanges] reverseObjectEnumerator]) {
-        NSRange rangeValue = activeRange.rangeValue;
-        id key = activeRange;
-        NSMutableArray * value = [NSMutableArray array];
-        [layoutFrame enumerateEnclosingRectsForCharacterRange:rangeValue usingBlock:^(CGRect rect, NSRange characterRange, BOOL *stop) {
-            [value addObject:[NSValue valueWithRect:(NSRect)rect]];
-        }];
-        dictionary[key] = value;
+    NSArray * activeRanges = [self activeRanges];
+    TUITextActiveRangeRectTable * table = self.activeRangeRectTable;
+    if ([table isValidForActiveRanges:activeRanges layoutFrame:layoutFrame]) {
+        // 代理每次可能返回新建的 range 对象，范围没变就不用重新建表，只换成最新的对象
+        table.activeRanges = activeRanges;
+        return;
     }
-    self.activeRangeToRectsMap = dictionary;
+    self.activeRangeRectTable = [[TUITextActiveRangeRectTable alloc] initWithActiveRanges:activeRanges layoutFrame:layoutFrame];
 }
 
 @end
@@ -616,3 +613,120 @@
 
 @end
 
+typedef struct {
+    CGRect rect;
+    CGFloat reach;          // 到这一项为止最大的 maxY，单调不减
+    NSUInteger rangeIndex;  // 在 activeRanges 中的位置，越大越优先
+} TUITextActiveRangeRectEntry;
+
+static int TUITextActiveRangeRectEntryCompare(const void * a, const void * b)
+{
+    CGFloat y1 = CGRectGetMinY(((const TUITextActiveRangeRectEntry *)a)->rect);
+    CGFloat y2 = CGRectGetMinY(((const TUITextActiveRangeRectEntry *)b)->rect);
+    return (y1 < y2) ? -1 : (y1 > y2) ? 1 : 0;
+}
+
+@implementation TUITextActiveRangeRectTable
+{
+    TUITextLayoutFrame * _layoutFrame;
+    NSUInteger _generation;
+    
+    NSUInteger _rangeCount;
+    NSRange * _ranges; // 建表时的 rangeValue，range 对象本身可能是可变的
+    
+    TUITextActiveRangeRectEntry * _entries;
+    NSUInteger _entryCount;
+}
+
+- (void)dealloc
+{
+    free(_ranges);
+    free(_entries);
+}
+
+- (instancetype)initWithActiveRanges:(NSArray *)activeRanges layoutFrame:(TUITextLayoutFrame *)layoutFrame
+{
+    if (self = [super init]) {
+        _layoutFrame = layoutFrame;
+        _generation = layoutFrame.generation;
+        self.activeRanges = activeRanges;
+        
+        const NSUInteger rangeCount = activeRanges.count;
+        _rangeCount = rangeCount;
+        if (rangeCount) {
+            _ranges = malloc(rangeCount * sizeof(NSRange));
+        }
+        
+        __block NSUInteger capacity = 0;
+        for (NSUInteger i = 0; i < rangeCount; i++) {
+            id<ABActiveTextRange> activeRange = activeRanges[i];
+            _ranges[i] = activeRange.rangeValue;
+            [layoutFrame enumerateEnclosingRectsForCharacterRange:_ranges[i] usingBlock:^(CGRect rect, NSRange characterRange, BOOL *stop) {
+                if (_entryCount == capacity) {
+                    capacity = MAX(capacity * 2, 16);
+                    _entries = realloc(_entries, capacity * sizeof(TUITextActiveRangeRectEntry));
+                }
+                _entries[_entryCount].rect = rect;
+                _entries[_entryCount].rangeIndex = i;
+                _entryCount++;
+            }];
+        }
+        
+        if (_entryCount) {
+            qsort(_entries, _entryCount, sizeof(TUITextActiveRangeRectEntry), TUITextActiveRangeRectEntryCompare);
+            CGFloat reach = -CGFLOAT_MAX;
+            for (NSUInteger i = 0; i < _entryCount; i++) {
+                reach = MAX(reach, CGRectGetMaxY(_entries[i].rect));
+                _entries[i].reach = reach;
+            }
+        }
+    }
+    return self;
+}
+
+- (BOOL)isValidForActiveRanges:(NSArray *)activeRanges layoutFrame:(TUITextLayoutFrame *)layoutFrame
+{
+    if (layoutFrame != _layoutFrame || layoutFrame.generation != _generation) {
+        return NO;
+    }
+    
+    // 按内容比较：矩形只取决于每个 range 的 rangeValue 和顺序
+    const NSUInteger rangeCount = activeRanges.count;
+    if (rangeCount != _rangeCount) {
+        return NO;
+    }
+    for (NSUInteger i = 0; i < rangeCount; i++) {
+        id<ABActiveTextRange> activeRange = activeRanges[i];
+        if (!NSEqualRanges(activeRange.rangeValue, _ranges[i])) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (id<ABActiveTextRange>)activeRangeAtPoint:(CGPoint)point
+{
+    // 第一个 minY 大于 point.y 的项，之后的矩形都不可能包含 point
+    NSUInteger low = 0, high = _entryCount;
+    while (low < high) {
+        NSUInteger mid = (low + high) / 2;
+        if (CGRectGetMinY(_entries[mid].rect) > point.y) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    
+    // 往回找，直到前面所有矩形的 maxY 都在 point 之下
+    NSUInteger hitIndex = NSNotFound;
+    for (NSUInteger i = low; i > 0 && _entries[i - 1].reach >= point.y; i--) {
+        const TUITextActiveRangeRectEntry * entry = &_entries[i - 1];
+        if (CGRectContainsPoint(entry->rect, point) && (hitIndex == NSNotFound || entry->rangeIndex > hitIndex)) {
+            hitIndex = entry->rangeIndex;
+        }
+    }
+    
+    return hitIndex == NSNotFound ? nil : self.activeRanges[hitIndex];
+}
+
+@end
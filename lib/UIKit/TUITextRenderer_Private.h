@@ -8,6 +8,32 @@
 
 #import "TUITextRenderer.h"
 
+@class TUITextLayoutFrame;
+
+/**
+ *  active range 在某一代 layout frame 上的矩形，按 minY 排序，供鼠标命中测试二分查找
+ */
+@interface TUITextActiveRangeRectTable : NSObject
+
+- (instancetype)initWithActiveRanges:(NSArray *)activeRanges layoutFrame:(TUITextLayoutFrame *)layoutFrame;
+
+/**
+ *  命中测试返回的 range 对象；范围相同的新对象可以直接替换进来，不用重新建表
+ */
+@property (atomic, copy) NSArray * activeRanges;
+
+/**
+ *  frame 没有重新排版、每个 active range 的范围也没有变化时，表可以继续使用
+ */
+- (BOOL)isValidForActiveRanges:(NSArray *)activeRanges layoutFrame:(TUITextLayoutFrame *)layoutFrame;
+
+/**
+ *  point 为 layout 坐标；多个 range 重叠时返回 activeRanges 中靠后的那个
+ */
+- (id<ABActiveTextRange>)activeRangeAtPoint:(CGPoint)point;
+
+@end
+
 @interface TUITextRenderer ()
 {
 @protected
@@ -41,7 +67,7 @@
 @property (nonatomic, strong) id<ABActiveTextRange> pressingActiveRange;
 @property (nonatomic, strong) id<ABActiveTextRange> savedPressingActiveRange;
 @property (nonatomic, strong) id<ABActiveTextRange> hoveringActiveRange;
-@property (atomic, copy) NSDictionary * activeRangeToRectsMap;
+@property (atomic, strong) TUITextActiveRangeRectTable * activeRangeRectTable;
 
 #pragma mark - Rendering Overrides
 
@@ -6,10 +6,12 @@
 //
 //
 
-#import "TUITextStorage.h"
+#import "TUITextStorage_Private.h"
 
 @interface TUITextStorage ()
 {
+    NSUInteger _editCount;
+
     CFMutableAttributedStringRef _attributedString;
     
     struct {
@@ -21,6 +23,8 @@
 
 @implementation TUITextStorage
 
+@synthesize editCount = _editCount;
+
 - (void)dealloc
 {
     if (_attributedString)
@@ -87,6 +91,7 @@
     }
     
     CFAttributedStringReplaceString(_attributedString, CFRangeMake(range.location, range.length), (CFStringRef)str);
+    _editCount++;
     
     if (_delegateHas.didProcessEditing)
     {
@@ -99,6 +104,7 @@
     range = NSIntersectionRange(range, NSMakeRange(0, self.length));
     
     CFAttributedStringSetAttributes(_attributedString, CFRangeMake(range.location, range.length), (CFDictionaryRef)attrs, true);
+    _editCount++;
     
     if (_delegateHas.didProcessEditing)
     {
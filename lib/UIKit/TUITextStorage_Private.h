@@ -0,0 +1,26 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUITextStorage.h"
+
+@interface TUITextStorage ()
+
+/**
+ *  每次字符或属性修改后递增，用于判断依附在 textStorage 上的缓存是否过期
+ */
+@property (nonatomic, assign, readonly) NSUInteger editCount;
+
+@end
@@ -99,7 +99,8 @@
 		}
 		
 		NSArray *s = [self sortedSubviews];
-		for(TUIView *v in [s reverseObjectEnumerator]) {
+		for(NSInteger i = (NSInteger)[s count] - 1; i >= 0; --i) {
+			TUIView *v = [s objectAtIndex:i];
 			TUIView *hit = [v accessibilityHitTest:[self convertPoint:point toView:v]];
 			if(hit)
 				return hit;
@@ -214,7 +215,7 @@
 		[accessibleSubviews addObject:renderer];
 	}
 	
-	for(TUIView *view in self.subviews) {
+	for(TUIView *view in [self sortedSubviews]) {
 		if([view isAccessibilityElement]) {
 			[accessibleSubviews addObject:view];
 		}
@@ -192,11 +192,8 @@
 	if([name isEqual:@"superview"])
 		return [self superview];
 	
-	NSArray *siblings = [[self superview] subviews];
-	for(TUIView *view in siblings)
-		if([view.layoutName isEqual:name])
-			return (view == self ? nil : view);
-	return nil;
+	TUIView *view = [[TUILayoutManager sharedLayoutManager] subviewNamed:name inView:[self superview]];
+	return (view == self ? nil : view);
 }
 
 @end
@@ -25,6 +25,12 @@
 - (void)_updateDisplayID;
 - (void)_superSetNextResponder:(NSResponder *)responder;
 
+// rendering, see TUIViewRenderQueue
+- (BOOL)_drawsContent;
+- (TUIViewDirtyRegion)_takeDirtyRegion;        // main thread
+- (NSUInteger)_renderGeneration;               // main thread
+- (id)_contentsByDrawingDirtyRegion:(TUIViewDirtyRegion)region; // layer contents, a CGImage or an IOSurface with cachesCGContext; any thread, one at a time per view
+
 @end
 
 TUI_EXTERN_C_BEGIN
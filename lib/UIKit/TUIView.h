@@ -89,6 +89,17 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 
 @protocol TUIViewDelegate;
 
+#define TUIViewMaximumDirtyRects 8
+
+/**
+ Rects invalidated since the last draw.  Past TUIViewMaximumDirtyRects rects the closest ones get merged.
+ */
+typedef struct TUIViewDirtyRegion {
+	CGRect rects[TUIViewMaximumDirtyRects];
+	NSUInteger count;
+	BOOL everything; // -setNeedsDisplay, ignore rects
+} TUIViewDirtyRegion;
+
 /**
  Root view class
  */
@@ -112,6 +123,11 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 	NSString *toolTip;
 	NSTimeInterval toolTipDelay;
 	
+	// back to front, rebuilt when subviews or their zPositions change
+	NSArray		*_sortedSubviews;
+	CGFloat		*_sortedSubviewsZPositions;
+	struct TUIViewSubviewIndex *_subviewIndex; // frames of _sortedSubviews, see indexesSubviewsSpatially
+	
 	@public
 	__weak TUINSView *_nsView; // keep this updated, fast way of getting .nsView
 	
@@ -120,7 +136,8 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 		NSInteger lastHeight;
 		BOOL lastOpaque;
 		CGContextRef context;
-		CGRect dirtyRect;
+		TUIViewDirtyRegion dirtyRegion;
+		NSUInteger renderGeneration; // bumped on every invalidation, background renders of an older one are dropped
 		CGFloat lastContentsScale;
         CGDirectDisplayID lastDisplayID;
 	} _context;
@@ -143,6 +160,8 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 		unsigned int delegateMouseEntered:1;
 		unsigned int delegateMouseExited:1;
 		unsigned int delegateWillDisplayLayer:1;
+		
+		unsigned int indexesSubviewsSpatially:1;
 	} _viewFlags;
 
 	BOOL isAccessibilityElement;
@@ -242,7 +261,7 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
  */
 @property (nonatomic, assign) BOOL needsDisplayWhenWindowsKeyednessChanges;
 
-@property (nonatomic, assign) BOOL cachesCGContext; // Default to NO, if you want dirty drawing, you should enable this.
+@property (nonatomic, assign) BOOL cachesCGContext; // Default to NO, if you want dirty drawing, you should enable this. Keeps the last drawing in a pair of IOSurfaces so a dirty rect redraws only that rect.
 
 @property (nonatomic, strong) TUIAppearance * appearance;
 
@@ -302,8 +321,18 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 - (CGSize)sizeThatFits:(CGSize)size;
 - (void)sizeToFit;                       // calls sizeThatFits: with current view bounds and changes bounds size.
 
+/**
+ Subviews in back to front order by layer.zPosition.  The result is cached until subviews are added or removed or a subview's zPosition changes.
+ */
 - (NSArray *)sortedSubviews;
 
+/**
+ Hit-test subviews through an index of their frames instead of asking each one in turn, so a hit test only visits the subviews under the point.  Meant for containers with many children, like table views.
+ 
+ Only opt in if no subview overrides -pointInside:withEvent: to accept points outside its bounds, and subview geometry is changed through the view (frame, bounds, center, transform) rather than on its layer directly.  If any subview has a transform the index is ignored and every subview is tested as usual.  Default is NO.
+ */
+@property (nonatomic, assign) BOOL indexesSubviewsSpatially;
+
 @end
 
 @interface TUIView (TUIViewHierarchy)
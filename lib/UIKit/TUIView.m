@@ -18,6 +18,7 @@
 #import <pthread.h>
 #import "TUICGAdditions.h"
 #import "TUIColor.h"
+#import "TUIGraphicsContextPool.h"
 #import "TUIImage.h"
 #import "TUILayoutManager.h"
 #import "TUINSView.h"
@@ -25,7 +26,9 @@
 #import "TUITextRenderer.h"
 #import "TUIView+Private.h"
 #import "TUIView+TUIBridgedView.h"
+#import "TUIViewBackingStore.h"
 #import "TUIViewController.h"
+#import "TUIViewRenderQueue.h"
 
 static NSString * TUIViewBlendingModeToString[TUIViewBlendingModeCount] = {
     [TUIViewBlendingModeNormal] = @"normalBlendMode",
@@ -123,6 +126,9 @@ TUI_EXTERN_C_END
 
 
 @interface TUIView ()
+{
+	TUIViewBackingStore *_backingStore; // cachesCGContext only
+}
 @property (nonatomic, strong) NSMutableArray *subviews;
 
 /*
@@ -131,8 +137,34 @@ TUI_EXTERN_C_END
  * layer.
  */
 - (void)prepareSubview:(TUIView *)view insertionBlock:(void (^)(void))block;
+
+- (void)_invalidateSortedSubviews;
+- (void)_invalidateSubviewIndex;
 @end
 
+typedef struct {
+	CGRect frame;
+	NSUInteger zIndex; // into -sortedSubviews
+	CGFloat reach;     // max y of this and every earlier entry
+} TUIViewSubviewIndexEntry;
+
+typedef struct TUIViewSubviewIndex {
+	NSUInteger count;
+	BOOL usable;       // NO if any subview is transformed
+	TUIViewSubviewIndexEntry entries[];
+} TUIViewSubviewIndex;
+
+static int TUIViewSubviewIndexEntryCompare(const void *a, const void *b)
+{
+	CGFloat ya = CGRectGetMinY(((const TUIViewSubviewIndexEntry *)a)->frame);
+	CGFloat yb = CGRectGetMinY(((const TUIViewSubviewIndexEntry *)b)->frame);
+	if(ya < yb)
+		return -1;
+	else if(ya > yb)
+		return 1;
+	return 0;
+}
+
 @implementation TUIView
 
 @synthesize layout;
@@ -193,10 +225,8 @@ TUI_EXTERN_C_END
     
 	[self setTextRenderers:nil];
 	_layer.delegate = nil;
-	if(_context.context) {
-		CGContextRelease(_context.context);
-		_context.context = NULL;
-	}
+	[self _invalidateSortedSubviews];
+	[self _releaseCGContext];
     
     for (TUIView * view in _subviews) {
         if (view.nextResponder == self) {
@@ -368,8 +398,7 @@ TUI_EXTERN_C_END
            displayID != _context.lastDisplayID ||
 		   fabs(currentScale - _context.lastContentsScale) > 0.1f) 
 		{
-			CGContextRelease(_context.context);
-			_context.context = NULL;
+			[self _releaseCGContext];
 		}
 	}
 	
@@ -385,13 +414,21 @@ TUI_EXTERN_C_END
 		b.size.height *= currentScale;
 		if(b.size.width < 1) b.size.width = 1;
 		if(b.size.height < 1) b.size.height = 1;
-		CGContextRef ctx = TUICreateGraphicsContextWithOptions(b.size, o);
+		CGContextRef ctx = [[TUIGraphicsContextPool sharedPool] copyGraphicsContextWithPixelSize:b.size opaque:o];
 		_context.context = ctx;
 	}
 	
 	return _context.context;
 }
 
+- (void)_releaseCGContext
+{
+	if(_context.context) {
+		CGContextRelease(_context.context);
+		_context.context = NULL;
+	}
+}
+
 void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 {
     CGDirectDisplayID *v = (CGDirectDisplayID *)pthread_getspecific(TUICurrentContextDisplayIDTLSKey);
@@ -402,95 +439,168 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
     *v = displayID;
 }
 
-- (void)displayLayer:(CALayer *)layer
+- (BOOL)_drawsContent
 {
-	if (_viewFlags.delegateWillDisplayLayer) {
-		[_viewDelegate viewWillDisplayLayer:self];
-	}
-	
 	typedef void (*DrawRectIMP)(id,SEL,CGRect);
 	SEL drawRectSEL = @selector(drawRect:);
 	DrawRectIMP drawRectIMP = (DrawRectIMP)[self methodForSelector:drawRectSEL];
 	DrawRectIMP dontCallThisBasicDrawRectIMP = (DrawRectIMP)[TUIView instanceMethodForSelector:drawRectSEL];
 
-	if (!self.drawRect && (drawRectIMP == dontCallThisBasicDrawRectIMP || [self _disableDrawRect])) {
-		// drawRect isn't overridden by subclass, don't call, let the CA machinery just handle backgroundColor (fast path)
-		return;
-	}
+	return self.drawRect || (drawRectIMP != dontCallThisBasicDrawRectIMP && ![self _disableDrawRect]);
+}
 
-	CGRect rectToDraw = self.bounds;
-	if (!CGRectIsEmpty(_context.dirtyRect)) {
-		rectToDraw = _context.dirtyRect;
-		_context.dirtyRect = CGRectZero;
-	}
+- (TUIViewDirtyRegion)_takeDirtyRegion
+{
+	TUIViewDirtyRegion dirtyRegion = _context.dirtyRegion;
+	_context.dirtyRegion.count = 0;
+	_context.dirtyRegion.everything = NO;
+	return dirtyRegion;
+}
 
-	void (^drawBlock)(void) = ^{
-        CGDirectDisplayID displayID = self.displayID;
-        if (displayID) {
-            TUISetCurrentContextDisplayID(displayID);
-        }
+- (NSUInteger)_renderGeneration
+{
+	return _context.renderGeneration;
+}
 
-		CGContextRef context = [self _CGContext];
-		TUIGraphicsPushContext(context);
-        
-        CGFloat scale = [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
-		TUISetCurrentContextScaleFactor(scale);
-        
-		CGContextScaleCTM(context, scale, scale);
-        
-        if (self->_viewFlags.clearsContextBeforeDrawing) {
-			CGContextClearRect(context, rectToDraw);
+- (TUIViewBackingStore *)_backingStore
+{
+	CGFloat scale = [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
+	CGSize pixelSize = CGSizeMake(MAX(1, floor(self.bounds.size.width * scale)), MAX(1, floor(self.bounds.size.height * scale)));
+	BOOL o = self.opaque;
+	
+	if(!_backingStore ||
+	   !CGSizeEqualToSize(_backingStore.pixelSize, pixelSize) ||
+	   _backingStore.opaque != o ||
+	   _backingStore.displayID != TUICurrentContextDisplayID())
+	{
+		_backingStore = [[TUIViewBackingStore alloc] initWithPixelSize:pixelSize opaque:o];
+	}
+	
+	return _backingStore;
+}
+
+- (void)_drawDirtyRegion:(TUIViewDirtyRegion)region partial:(BOOL)partial inContext:(CGContextRef)context scale:(CGFloat)scale
+{
+	typedef void (*DrawRectIMP)(id,SEL,CGRect);
+	SEL drawRectSEL = @selector(drawRect:);
+	DrawRectIMP drawRectIMP = (DrawRectIMP)[self methodForSelector:drawRectSEL];
+	DrawRectIMP dontCallThisBasicDrawRectIMP = (DrawRectIMP)[TUIView instanceMethodForSelector:drawRectSEL];
+	
+	TUIGraphicsPushContext(context);
+	TUISetCurrentContextScaleFactor(scale);
+	
+	CGContextScaleCTM(context, scale, scale);
+	CGContextSaveGState(context);
+	
+	CGRect rectToDraw = self.bounds;
+	if (partial) {
+		rectToDraw = CGRectNull;
+		for (NSUInteger i = 0; i < region.count; i++) {
+			rectToDraw = CGRectUnion(rectToDraw, region.rects[i]);
 		}
-        
-		CGContextSetAllowsAntialiasing(context, true);
-		CGContextSetShouldAntialias(context, true);
-        CGContextSetShouldSmoothFonts(context, !self->_viewFlags.disableSubpixelTextRendering);
-        
-		if (self.drawRect) {
-			// drawRect is implemented via a block
-			self.drawRect(self, rectToDraw);
-		} else if ((drawRectIMP != dontCallThisBasicDrawRectIMP) && ![self _disableDrawRect]) {
-			// drawRect is overridden by subclass
-			drawRectIMP(self, drawRectSEL, rectToDraw);
+		if (CGRectIsNull(rectToDraw)) {
+			rectToDraw = CGRectZero;
 		}
-
-		#if CA_COLOR_OVERLAY_DEBUG
-		if (self.opaque) {
-			CGContextSetRGBFillColor(context, 0, 1, 0, 0.3);
+		CGContextClipToRects(context, region.rects, region.count);
+	}
+	
+	if (_viewFlags.clearsContextBeforeDrawing) {
+		if (partial) {
+			for (NSUInteger i = 0; i < region.count; i++) {
+				CGContextClearRect(context, region.rects[i]);
+			}
 		} else {
-			CGContextSetRGBFillColor(context, 1, 0, 0, 0.3);
-			CGContextFillRect(context, rectToDraw);
+			CGContextClearRect(context, rectToDraw);
 		}
-		#endif
+	}
+	
+	CGContextSetAllowsAntialiasing(context, true);
+	CGContextSetShouldAntialias(context, true);
+	CGContextSetShouldSmoothFonts(context, !_viewFlags.disableSubpixelTextRendering);
+	
+	if (self.drawRect) {
+		// drawRect is implemented via a block
+		self.drawRect(self, rectToDraw);
+	} else if ((drawRectIMP != dontCallThisBasicDrawRectIMP) && ![self _disableDrawRect]) {
+		// drawRect is overridden by subclass
+		drawRectIMP(self, drawRectSEL, rectToDraw);
+	}
 
-		TUIImage *image = TUIGraphicsGetImageFromCurrentImageContext();
-		layer.contents = (id)image.CGImage;
-		CGContextScaleCTM(context, 1.0f / scale, 1.0f / scale);
-		TUIGraphicsPopContext();
-        
-        if (!self.cachesCGContext)
-        {
-            if (self->_context.context)
-            {
-                CGContextRelease(self->_context.context);
-                self->_context.context = NULL;
-            }
-        }
-        
-		if (self.drawInBackground) [CATransaction flush];
-	};
+	#if CA_COLOR_OVERLAY_DEBUG
+	if (self.opaque) {
+		CGContextSetRGBFillColor(context, 0, 1, 0, 0.3);
+	} else {
+		CGContextSetRGBFillColor(context, 1, 0, 0, 0.3);
+		CGContextFillRect(context, rectToDraw);
+	}
+	#endif
+
+	CGContextRestoreGState(context);
+	CGContextScaleCTM(context, 1.0f / scale, 1.0f / scale);
+	TUIGraphicsPopContext();
+}
+
+- (id)_contentsByDrawingDirtyRegion:(TUIViewDirtyRegion)region
+{
+	CGDirectDisplayID displayID = self.displayID;
+	if (displayID) {
+		TUISetCurrentContextDisplayID(displayID);
+	}
 	
-	if (self.drawInBackground) {
-		layer.contents = nil;
+	CGFloat scale = [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
+	
+	if (self.cachesCGContext) {
+		// only redraw the dirty region, the backing store keeps the rest of the last drawing
+		TUIViewBackingStore *backingStore = [self _backingStore];
+		BOOL partial = backingStore.hasContents && !region.everything && region.count > 0;
+		CGRect pixelRects[TUIViewMaximumDirtyRects];
+		if (partial) {
+			CGRect bounds = self.bounds;
+			for (NSUInteger i = 0; i < region.count; i++) {
+				region.rects[i] = CGRectIntersection(region.rects[i], bounds);
+				pixelRects[i] = CGRectIsNull(region.rects[i]) ? CGRectZero : CGRectIntegral(CGRectMake(region.rects[i].origin.x * scale, region.rects[i].origin.y * scale, region.rects[i].size.width * scale, region.rects[i].size.height * scale));
+			}
+		}
 		
-		if (self.drawQueue != nil) {
-			[self.drawQueue addOperationWithBlock:drawBlock];
-		} else {
-			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), drawBlock);
+		CGContextRef context = [backingStore beginDrawingInPixelRects:pixelRects count:partial ? region.count : 0];
+		if (!context) {
+			return nil;
 		}
-	} else {
-		drawBlock();
+		[self _drawDirtyRegion:region partial:partial inContext:context scale:scale];
+		return (__bridge id)[backingStore endDrawing];
 	}
+	
+	_backingStore = nil;
+	
+	CGContextRef context = [self _CGContext];
+	[self _drawDirtyRegion:region partial:NO inContext:context scale:scale];
+	CGImageRef image = [[TUIGraphicsContextPool sharedPool] copyImageFromGraphicsContext:context];
+	
+	// the image now holds the pooled bitmap, which goes back to the pool once the layer lets go of it
+	[self _releaseCGContext];
+	
+	return CFBridgingRelease(image);
+}
+
+- (void)displayLayer:(CALayer *)layer
+{
+	if (_viewFlags.delegateWillDisplayLayer) {
+		[_viewDelegate viewWillDisplayLayer:self];
+	}
+	
+	if (![self _drawsContent]) {
+		// drawRect isn't overridden by subclass, don't call, let the CA machinery just handle backgroundColor (fast path)
+		return;
+	}
+
+	if (self.drawInBackground) {
+		// the current contents stay up until the new bitmap is ready
+		_context.renderGeneration++;
+		[[TUIViewRenderQueue sharedQueue] scheduleRenderForView:self];
+		return;
+	}
+
+	layer.contents = [self _contentsByDrawingDirtyRegion:[self _takeDirtyRegion]];
 }
 
 - (void)_blockLayout
@@ -682,6 +792,8 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
     view.appearance = self.appearance;
     
 	block();
+	[self _invalidateSortedSubviews];
+	[[TUILayoutManager sharedLayoutManager] subviewsDidChangeInView:self];
 
 	[self didAddSubview:view];
 	[view didMoveToSuperview];
@@ -724,9 +836,17 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 	return self.layer.frame;
 }
 
+- (void)_invalidateSuperviewSubviewIndex
+{
+	TUIView *superview = self.superview;
+	if(superview && superview->_subviewIndex)
+		[superview _invalidateSubviewIndex];
+}
+
 - (void)setFrame:(CGRect)f
 {
 	self.layer.frame = f;
+	[self _invalidateSuperviewSubviewIndex];
 	[self.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
 }
 
@@ -738,6 +858,7 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 - (void)setBounds:(CGRect)b
 {
 	self.layer.bounds = b;
+	[self _invalidateSuperviewSubviewIndex];
 	[self.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
 }
 
@@ -764,11 +885,59 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 - (void)setTransform:(CGAffineTransform)t
 {
 	[self.layer setAffineTransform:t];
+	[self _invalidateSuperviewSubviewIndex];
+}
+
+- (void)_invalidateSortedSubviews
+{
+	_sortedSubviews = nil;
+	if(_sortedSubviewsZPositions) {
+		free(_sortedSubviewsZPositions);
+		_sortedSubviewsZPositions = NULL;
+	}
+	[self _invalidateSubviewIndex];
+}
+
+/**
+ * @brief Check the cached order against the current zPositions
+ *
+ * zPosition lives on the layer and is set directly all over the place, so
+ * there is no setter to hook.  Instead the cache remembers the value it was
+ * sorted with for each view; if none of them moved, the order still holds.
+ * This walks the array without allocating anything.
+ */
+- (BOOL)_sortedSubviewsAreValid
+{
+	if(_sortedSubviews == nil)
+		return NO;
+	
+	NSUInteger i = 0;
+	for(TUIView *v in _sortedSubviews) {
+		if(v.layer.zPosition != _sortedSubviewsZPositions[i++])
+			return NO;
+	}
+	return YES;
 }
 
 - (NSArray *)sortedSubviews // back to front order
 {
-	return [self.subviews sortedArrayWithOptions:NSSortStable usingComparator:(NSComparator)^NSComparisonResult(TUIView *a, TUIView *b) {
+	if([self _sortedSubviewsAreValid])
+		return _sortedSubviews;
+	
+	[self _invalidateSortedSubviews];
+	
+	// leaves have no subviews array at all; cache an empty order without a z position buffer
+	if([_subviews count] == 0) {
+		static NSArray *noSubviews = nil;
+		static dispatch_once_t onceToken;
+		dispatch_once(&onceToken, ^{
+			noSubviews = [[NSArray alloc] init];
+		});
+		_sortedSubviews = noSubviews;
+		return _sortedSubviews;
+	}
+	
+	NSArray *sorted = [self.subviews sortedArrayWithOptions:NSSortStable usingComparator:(NSComparator)^NSComparisonResult(TUIView *a, TUIView *b) {
 		CGFloat x = a.layer.zPosition;
 		CGFloat y = b.layer.zPosition;
 		if(x > y)
@@ -777,8 +946,116 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 			return NSOrderedAscending;
 		return NSOrderedSame;
 	}];
+	
+	NSUInteger count = [sorted count];
+	_sortedSubviewsZPositions = malloc(count * sizeof(CGFloat));
+	NSUInteger i = 0;
+	for(TUIView *v in sorted)
+		_sortedSubviewsZPositions[i++] = v.layer.zPosition;
+	_sortedSubviews = sorted;
+	
+	return _sortedSubviews;
 }
 
+- (BOOL)indexesSubviewsSpatially
+{
+	return _viewFlags.indexesSubviewsSpatially;
+}
+
+- (void)setIndexesSubviewsSpatially:(BOOL)b
+{
+	_viewFlags.indexesSubviewsSpatially = b;
+	if(!b)
+		[self _invalidateSubviewIndex];
+}
+
+- (void)_invalidateSubviewIndex
+{
+	if(_subviewIndex) {
+		free(_subviewIndex);
+		_subviewIndex = NULL;
+	}
+}
+
+/**
+ * @brief Build the frame index for the given back to front subviews
+ *
+ * Entries are sorted by minimum y.  Each one also records the largest
+ * maximum y seen up to and including it, so a lookup can stop walking
+ * back as soon as nothing earlier can reach the point.
+ */
+- (TUIViewSubviewIndex *)_subviewIndexForSortedSubviews:(NSArray *)sorted
+{
+	if(_subviewIndex)
+		return _subviewIndex;
+	
+	NSUInteger count = [sorted count];
+	_subviewIndex = malloc(sizeof(TUIViewSubviewIndex) + count * sizeof(TUIViewSubviewIndexEntry));
+	_subviewIndex->count = count;
+	_subviewIndex->usable = CATransform3DIsIdentity(self.layer.sublayerTransform);
+	
+	NSUInteger i = 0;
+	for(TUIView *v in sorted) {
+		if(!CATransform3DIsIdentity(v.layer.transform))
+			_subviewIndex->usable = NO;
+		_subviewIndex->entries[i].frame = v.layer.frame;
+		_subviewIndex->entries[i].zIndex = i;
+		i++;
+	}
+	
+	if(_subviewIndex->usable) {
+		qsort(_subviewIndex->entries, count, sizeof(TUIViewSubviewIndexEntry), TUIViewSubviewIndexEntryCompare);
+		CGFloat reach = -CGFLOAT_MAX;
+		for(i = 0; i < count; ++i) {
+			reach = MAX(reach, CGRectGetMaxY(_subviewIndex->entries[i].frame));
+			_subviewIndex->entries[i].reach = reach;
+		}
+	}
+	
+	return _subviewIndex;
+}
+
+/**
+ * @brief Collect the z indexes of indexed subviews whose frame contains @p point
+ *
+ * Fills @p zIndexes front to back.  Returns NSNotFound if there are more than
+ * @p capacity candidates, in which case the caller falls back to a full scan.
+ */
+static NSUInteger TUIViewSubviewIndexCandidates(TUIViewSubviewIndex *index, CGPoint point, NSUInteger *zIndexes, NSUInteger capacity)
+{
+	// last entry starting at or below the point
+	NSUInteger lo = 0, hi = index->count;
+	while(lo < hi) {
+		NSUInteger mid = lo + (hi - lo) / 2;
+		if(CGRectGetMinY(index->entries[mid].frame) <= point.y)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	
+	NSUInteger n = 0;
+	for(NSUInteger i = lo; i-- > 0;) {
+		TUIViewSubviewIndexEntry *e = &index->entries[i];
+		if(e->reach <= point.y)
+			break;
+		if(point.y < CGRectGetMaxY(e->frame) && point.x >= CGRectGetMinX(e->frame) && point.x < CGRectGetMaxX(e->frame)) {
+			if(n == capacity)
+				return NSNotFound;
+			
+			// insertion sort, highest z first
+			NSUInteger j = n++;
+			while(j > 0 && zIndexes[j - 1] < e->zIndex) {
+				zIndexes[j] = zIndexes[j - 1];
+				j--;
+			}
+			zIndexes[j] = e->zIndex;
+		}
+	}
+	return n;
+}
+
+#define SUBVIEW_INDEX_MAX_CANDIDATES 16
+
 - (TUIView *)hitTest:(CGPoint)point withEvent:(id)event
 {
 	if((self.userInteractionEnabled == NO) || (self.hidden == YES) || (self.alpha <= 0.0f))
@@ -786,7 +1063,24 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 	
 	if([self pointInside:point withEvent:event]) {
 		NSArray *s = [self sortedSubviews];
-		for(TUIView *v in [s reverseObjectEnumerator]) {
+		
+		if(_viewFlags.indexesSubviewsSpatially) {
+			TUIViewSubviewIndex *index = [self _subviewIndexForSortedSubviews:s];
+			NSUInteger zIndexes[SUBVIEW_INDEX_MAX_CANDIDATES];
+			NSUInteger n = index->usable ? TUIViewSubviewIndexCandidates(index, point, zIndexes, SUBVIEW_INDEX_MAX_CANDIDATES) : NSNotFound;
+			if(n != NSNotFound) {
+				for(NSUInteger i = 0; i < n; ++i) {
+					TUIView *v = [s objectAtIndex:zIndexes[i]];
+					TUIView *hit = [v hitTest:[self convertPoint:point toView:v] withEvent:event];
+					if(hit)
+						return hit;
+				}
+				return self; // leaf
+			}
+		}
+		
+		for(NSInteger i = (NSInteger)[s count] - 1; i >= 0; --i) {
+			TUIView *v = [s objectAtIndex:i];
 			TUIView *hit = [v hitTest:[self convertPoint:point toView:v] withEvent:event];
 			if(hit)
 				return hit;
@@ -888,6 +1182,8 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 		[self willMoveToSuperview:nil];
 
 		[superview.subviews removeObjectIdenticalTo:self];
+		[superview _invalidateSortedSubviews];
+		[[TUILayoutManager sharedLayoutManager] subviewsDidChangeInView:superview];
 		[self.layer removeFromSuperlayer];
 		self.nsView = nil;
 
@@ -1171,12 +1467,53 @@ void TUISetCurrentContextDisplayID(CGDirectDisplayID displayID)
 
 - (void)setNeedsDisplay
 {
+	_context.renderGeneration++; // a background render in flight is now stale
+	_context.dirtyRegion.everything = YES;
+	_context.dirtyRegion.count = 0;
 	[self.layer setNeedsDisplay];
 }
 
+static CGFloat TUIViewRectArea(CGRect r)
+{
+	return CGRectIsNull(r) ? 0 : r.size.width * r.size.height;
+}
+
 - (void)setNeedsDisplayInRect:(CGRect)rect
 {
-	_context.dirtyRect = rect;
+	TUIViewDirtyRegion *region = &_context.dirtyRegion;
+	rect = CGRectStandardize(rect);
+	_context.renderGeneration++;
+	
+	if (!region->everything && !CGRectIsEmpty(rect)) {
+		// drop rects the new one covers, bail if one already covers it
+		NSUInteger count = 0;
+		for (NSUInteger i = 0; i < region->count; i++) {
+			if (CGRectContainsRect(region->rects[i], rect)) {
+				return;
+			}
+			if (!CGRectContainsRect(rect, region->rects[i])) {
+				region->rects[count++] = region->rects[i];
+			}
+		}
+		region->count = count;
+		
+		if (count < TUIViewMaximumDirtyRects) {
+			region->rects[region->count++] = rect;
+		} else {
+			// full, merge into whichever rect grows the least
+			NSUInteger best = 0;
+			CGFloat bestGrowth = CGFLOAT_MAX;
+			for (NSUInteger i = 0; i < count; i++) {
+				CGFloat growth = TUIViewRectArea(CGRectUnion(region->rects[i], rect)) - TUIViewRectArea(region->rects[i]);
+				if (growth < bestGrowth) {
+					bestGrowth = growth;
+					best = i;
+				}
+			}
+			region->rects[best] = CGRectUnion(region->rects[best], rect);
+		}
+	}
+	
 	[self.layer setNeedsDisplayInRect:rect];
 }
 
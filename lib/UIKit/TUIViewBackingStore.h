@@ -0,0 +1,51 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+#import <IOSurface/IOSurface.h>
+
+/**
+ A pair of IOSurfaces a view with cachesCGContext draws into, used directly as its layer's contents.
+
+ Drawing goes into the back surface, which then becomes the front one.  The back surface is only behind the front one by what the previous draw touched, so a partial redraw copies those rects over and draws the new dirty rects, instead of snapshotting the whole bitmap into a new CGImage every time.  One draw at a time, from any thread.
+ */
+@interface TUIViewBackingStore : NSObject
+
+/**
+ The surfaces use the color space of TUICurrentContextDisplayID() on the calling thread.
+ */
+- (instancetype)initWithPixelSize:(CGSize)pixelSize opaque:(BOOL)opaque;
+
+@property (nonatomic, readonly) CGSize pixelSize;
+@property (nonatomic, readonly) BOOL opaque;
+@property (nonatomic, readonly) CGDirectDisplayID displayID;
+
+/**
+ YES once a complete drawing has been made, so that a dirty region can be redrawn on top of it.
+ */
+@property (nonatomic, readonly) BOOL hasContents;
+
+/**
+ Returns a context drawing into the back surface, valid until -endDrawing.  @p rects are in pixels with the origin at the bottom left; everything outside them is brought up to date from the front surface first.  Pass a count of 0 to redraw everything.
+ */
+- (CGContextRef)beginDrawingInPixelRects:(const CGRect *)rects count:(NSUInteger)count;
+
+/**
+ Makes the surface just drawn the front one and returns it, for use as CALayer contents.
+ */
+- (IOSurfaceRef)endDrawing;
+
+@end
@@ -0,0 +1,167 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIViewBackingStore.h"
+#import "TUICGAdditions.h"
+#import "TUIView.h"
+#import "TUIView+Private.h"
+
+static IOSurfaceRef TUIViewBackingStoreCreateSurface(size_t width, size_t height)
+{
+	size_t bytesPerRow = IOSurfaceAlignProperty(kIOSurfaceBytesPerRow, width * 4);
+	NSDictionary *properties = @{
+		(id)kIOSurfaceWidth: @(width),
+		(id)kIOSurfaceHeight: @(height),
+		(id)kIOSurfaceBytesPerElement: @4,
+		(id)kIOSurfaceBytesPerRow: @(bytesPerRow),
+		(id)kIOSurfaceAllocSize: @(IOSurfaceAlignProperty(kIOSurfaceAllocSize, bytesPerRow * height)),
+		(id)kIOSurfacePixelFormat: @((uint32_t)'BGRA'),
+	};
+	return IOSurfaceCreate((__bridge CFDictionaryRef)properties);
+}
+
+@implementation TUIViewBackingStore
+{
+	IOSurfaceRef _front;
+	IOSurfaceRef _back;
+	CGColorSpaceRef _colorSpace;
+	CGContextRef _drawingContext;
+
+	// what the back surface is missing compared to the front one: the rects the last draw touched
+	CGRect _staleRects[TUIViewMaximumDirtyRects];
+	NSUInteger _staleRectCount;
+	BOOL _backIsStale; // missing everything
+}
+
+- (instancetype)initWithPixelSize:(CGSize)pixelSize opaque:(BOOL)opaque
+{
+	if((self = [super init])) {
+		_pixelSize = CGSizeMake(MAX(1, floor(pixelSize.width)), MAX(1, floor(pixelSize.height)));
+		_opaque = opaque;
+		_displayID = TUICurrentContextDisplayID();
+		_colorSpace = TUICopyCurrentDisplayColorSpace();
+		_backIsStale = YES;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	if(_drawingContext)
+		CGContextRelease(_drawingContext);
+	if(_front)
+		CFRelease(_front);
+	if(_back)
+		CFRelease(_back);
+	CGColorSpaceRelease(_colorSpace);
+}
+
+- (BOOL)hasContents
+{
+	return _front != NULL;
+}
+
+// rows are stored top down, the rects are bottom up
+- (void)_copyPixelRect:(CGRect)rect fromSurface:(IOSurfaceRef)source toSurface:(IOSurfaceRef)destination
+{
+	rect = CGRectIntersection(CGRectIntegral(rect), CGRectMake(0, 0, _pixelSize.width, _pixelSize.height));
+	if(CGRectIsEmpty(rect))
+		return;
+
+	size_t height = _pixelSize.height;
+	size_t sourceBytesPerRow = IOSurfaceGetBytesPerRow(source);
+	size_t destinationBytesPerRow = IOSurfaceGetBytesPerRow(destination);
+	const uint8_t *sourceBase = IOSurfaceGetBaseAddress(source);
+	uint8_t *destinationBase = IOSurfaceGetBaseAddress(destination);
+
+	size_t firstRow = height - (size_t)CGRectGetMaxY(rect);
+	size_t lastRow = height - (size_t)CGRectGetMinY(rect);
+	size_t offset = (size_t)CGRectGetMinX(rect) * 4;
+	size_t length = (size_t)CGRectGetWidth(rect) * 4;
+	for(size_t row = firstRow; row < lastRow; row++) {
+		memcpy(destinationBase + row * destinationBytesPerRow + offset, sourceBase + row * sourceBytesPerRow + offset, length);
+	}
+}
+
+- (CGContextRef)beginDrawingInPixelRects:(const CGRect *)rects count:(NSUInteger)count
+{
+	NSAssert(_drawingContext == NULL, @"-beginDrawingInPixelRects:count: called twice without -endDrawing");
+
+	size_t width = _pixelSize.width;
+	size_t height = _pixelSize.height;
+
+	// the window server may still be compositing the surface that was on screen before the last swap
+	if(_back && IOSurfaceIsInUse(_back)) {
+		CFRelease(_back);
+		_back = NULL;
+	}
+	if(!_back) {
+		_back = TUIViewBackingStoreCreateSurface(width, height);
+		_backIsStale = YES;
+	}
+	if(!_back)
+		return NULL;
+
+	IOSurfaceLock(_back, 0, NULL);
+
+	if(count > 0 && _front) {
+		IOSurfaceLock(_front, kIOSurfaceLockReadOnly, NULL);
+		if(_backIsStale) {
+			[self _copyPixelRect:CGRectMake(0, 0, width, height) fromSurface:_front toSurface:_back];
+		} else {
+			for(NSUInteger i = 0; i < _staleRectCount; i++) {
+				[self _copyPixelRect:_staleRects[i] fromSurface:_front toSurface:_back];
+			}
+		}
+		IOSurfaceUnlock(_front, kIOSurfaceLockReadOnly, NULL);
+	}
+
+	// after the swap the old front is missing exactly what gets drawn now
+	_backIsStale = (count == 0);
+	_staleRectCount = MIN(count, (NSUInteger)TUIViewMaximumDirtyRects);
+	for(NSUInteger i = 0; i < _staleRectCount; i++) {
+		_staleRects[i] = rects[i];
+	}
+
+	CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Little | (_opaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst);
+	_drawingContext = CGBitmapContextCreate(IOSurfaceGetBaseAddress(_back), width, height, 8, IOSurfaceGetBytesPerRow(_back), _colorSpace, bitmapInfo);
+	if(!_drawingContext) {
+		IOSurfaceUnlock(_back, 0, NULL);
+	}
+	return _drawingContext;
+}
+
+- (IOSurfaceRef)endDrawing
+{
+	if(!_drawingContext)
+		return _front;
+
+	CGContextFlush(_drawingContext);
+	CGContextRelease(_drawingContext);
+	_drawingContext = NULL;
+	IOSurfaceUnlock(_back, 0, NULL);
+
+	IOSurfaceRef drawn = _back;
+	_back = _front;
+	_front = drawn;
+	if(!_back) {
+		// first draw, the next one gets a fresh surface
+		_backIsStale = YES;
+	}
+	return _front;
+}
+
+@end
@@ -0,0 +1,44 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class TUIView;
+
+/**
+ Renders views with drawInBackground off the main thread.
+
+ A view scheduled again before its render starts is only drawn once, with all its invalidations merged.  A view never has more than one render in flight, and a render that finishes after the view was invalidated again is thrown away instead of replacing newer contents.  Views on screen are started before offscreen ones.  Main thread only.
+ */
+@interface TUIViewRenderQueue : NSObject
+
++ (instancetype)sharedQueue;
+
+/**
+ Renders started at once, defaults to the number of active processors.
+ */
+@property (nonatomic, assign) NSUInteger maximumConcurrentRenderCount;
+
+- (void)scheduleRenderForView:(TUIView *)view;
+
+// statistics
+@property (nonatomic, readonly) NSUInteger renderCount;    // renders started
+@property (nonatomic, readonly) NSUInteger coalescedCount; // schedules merged into a pending render
+@property (nonatomic, readonly) NSUInteger discardCount;   // finished renders dropped as stale
+
+- (void)resetStatistics;
+
+@end
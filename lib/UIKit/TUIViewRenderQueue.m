@@ -0,0 +1,162 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIViewRenderQueue.h"
+#import "TUINSView.h"
+#import "TUINSWindow.h"
+#import "TUIView.h"
+#import "TUIView+Private.h"
+
+@interface TUIViewRenderQueue ()
+
+@property (nonatomic, strong) NSMutableOrderedSet *pendingViews;   // waiting for a render, oldest first
+@property (nonatomic, strong) NSMutableSet *renderingViews;        // render in flight
+
+@end
+
+@implementation TUIViewRenderQueue
+
++ (instancetype)sharedQueue
+{
+	static TUIViewRenderQueue *queue = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		queue = [[TUIViewRenderQueue alloc] init];
+	});
+	return queue;
+}
+
+- (instancetype)init
+{
+	if((self = [super init])) {
+		_pendingViews = [[NSMutableOrderedSet alloc] init];
+		_renderingViews = [[NSMutableSet alloc] init];
+		_maximumConcurrentRenderCount = MAX((NSUInteger)1, [[NSProcessInfo processInfo] activeProcessorCount]);
+	}
+	return self;
+}
+
+- (void)setMaximumConcurrentRenderCount:(NSUInteger)count
+{
+	_maximumConcurrentRenderCount = MAX((NSUInteger)1, count);
+	[self _startRenders];
+}
+
+- (void)scheduleRenderForView:(TUIView *)view
+{
+	if(!view)
+		return;
+
+	if([_pendingViews containsObject:view]) {
+		_coalescedCount++; // its dirty region already holds the new invalidation
+		return;
+	}
+
+	[_pendingViews addObject:view];
+	[self _startRenders];
+}
+
+static BOOL TUIViewRenderQueueViewIsVisible(TUIView *view)
+{
+	TUINSView *nsView = view.nsView;
+	if(!nsView || ![nsView.window isVisible] || view.hidden)
+		return NO;
+	return NSIntersectsRect(view.frameInNSView, [nsView visibleRect]);
+}
+
+/**
+ * @brief The first pending view on screen, otherwise the oldest pending one,
+ * skipping views that are still rendering.
+ */
+- (TUIView *)_nextViewToRender:(BOOL *)visible
+{
+	TUIView *fallback = nil;
+	for(TUIView *view in _pendingViews) {
+		if([_renderingViews containsObject:view])
+			continue;
+		if(TUIViewRenderQueueViewIsVisible(view)) {
+			*visible = YES;
+			return view;
+		}
+		if(!fallback)
+			fallback = view;
+	}
+	*visible = NO;
+	return fallback;
+}
+
+- (void)_startRenders
+{
+	while([_renderingViews count] < _maximumConcurrentRenderCount && [_pendingViews count] > 0) {
+		BOOL visible = NO;
+		TUIView *view = [self _nextViewToRender:&visible];
+		if(!view)
+			break;
+
+		[_pendingViews removeObject:view];
+		[self _renderView:view visible:visible];
+	}
+}
+
+- (void)_renderView:(TUIView *)view visible:(BOOL)visible
+{
+	if(![view _drawsContent])
+		return;
+
+	[_renderingViews addObject:view];
+	_renderCount++;
+
+	TUIViewDirtyRegion region = [view _takeDirtyRegion];
+	NSUInteger generation = [view _renderGeneration];
+
+	void (^renderBlock)(void) = ^{
+		id contents = [view _contentsByDrawingDirtyRegion:region];
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[self _finishRenderingView:view contents:contents generation:generation];
+		});
+	};
+
+	if(view.drawQueue != nil) {
+		NSBlockOperation *operation = [NSBlockOperation blockOperationWithBlock:renderBlock];
+		operation.queuePriority = visible ? NSOperationQueuePriorityHigh : NSOperationQueuePriorityLow;
+		[view.drawQueue addOperation:operation];
+	} else {
+		dispatch_queue_t queue = dispatch_get_global_queue(visible ? QOS_CLASS_USER_INITIATED : QOS_CLASS_UTILITY, 0);
+		dispatch_async(queue, renderBlock);
+	}
+}
+
+- (void)_finishRenderingView:(TUIView *)view contents:(id)contents generation:(NSUInteger)generation
+{
+	[_renderingViews removeObject:view];
+
+	if(generation == [view _renderGeneration]) {
+		view.layer.contents = contents;
+	} else {
+		_discardCount++; // invalidated while rendering, a newer render is pending
+	}
+
+	[self _startRenders];
+}
+
+- (void)resetStatistics
+{
+	_renderCount = 0;
+	_coalescedCount = 0;
+	_discardCount = 0;
+}
+
+@end